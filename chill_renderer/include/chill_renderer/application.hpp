@@ -5,6 +5,8 @@
 
 #include "chill_renderer/window.hpp"
 #include "chill_renderer/resource_manager.hpp"
+#include "chill_renderer/job_system.hpp"
+#include "chill_renderer/upload_thread.hpp"
 
 namespace chill_renderer {
 class Application {
@@ -18,6 +20,11 @@ public:
 
 	auto get_win() noexcept -> Window&;
 	auto get_rmanager() noexcept -> ResourceManager&;
+	auto get_jobs() noexcept -> JobSystem&;
+	// Optional, once started ResourceManager creates buffers and textures of async loads on it.
+	auto start_upload_thread() -> void;
+	// Null until start_upload_thread().
+	auto get_uploader() noexcept -> UploadThread*;
 private:
 	Application(int win_width, int win_height, const std::string& win_title, CursorMode win_mode);
 	~Application();
@@ -25,5 +32,7 @@ private:
 private:
 	std::unique_ptr<Window> m_win = nullptr;
 	std::unique_ptr<ResourceManager> m_rmanager = nullptr;
+	std::unique_ptr<JobSystem> m_jobs = nullptr;
+	std::unique_ptr<UploadThread> m_uploader = nullptr;
 }; 
 }
\ No newline at end of file
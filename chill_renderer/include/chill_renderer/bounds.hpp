@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <limits>
+#include <vector>
+#include <cstdint>
+
+namespace chill_renderer {
+struct AABB {
+	auto expand(const glm::vec3& a_point) noexcept -> void;
+	auto expand(const AABB& a_aabb) noexcept -> void;
+	auto transform(const glm::mat4& a_mat) const noexcept -> AABB;
+	auto contains(const AABB& a_aabb) const noexcept -> bool;
+	auto intersects_ray(const glm::vec3& a_origin, const glm::vec3& a_inv_dir, float a_max_dist, float& a_dist) const noexcept -> bool;
+	auto is_valid() const noexcept -> bool;
+	auto get_center() const noexcept -> glm::vec3;
+	auto get_extent() const noexcept -> glm::vec3;
+	auto get_surface_area() const noexcept -> float;
+
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+};
+
+struct BoundingSphere {
+	BoundingSphere() = default;
+	BoundingSphere(const glm::vec3& a_center, float a_radius);
+	BoundingSphere(const AABB& a_aabb);
+
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.f;
+};
+
+// Structure of arrays layout so frustum tests can load whole SIMD lanes.
+class SphereBatch {
+public:
+	auto clear() noexcept -> void;
+	auto reserve(std::size_t a_siz) -> void;
+	auto push(const BoundingSphere& a_sphere) -> void;
+	auto size() const noexcept -> std::size_t;
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> r;
+};
+
+class Frustum {
+public:
+	Frustum() = default;
+	Frustum(const glm::mat4& a_view_proj);
+
+	auto set(const glm::mat4& a_view_proj) noexcept -> void;
+	auto intersects(const BoundingSphere& a_sphere) const noexcept -> bool;
+	auto intersects(const AABB& a_aabb) const noexcept -> bool;
+	auto get_planes() const noexcept -> const std::array<glm::vec4, 6>&;
+
+private:
+	// Normalized planes (normal pointing inside, w = distance) in order: left, right, bottom, top, near, far.
+	std::array<glm::vec4, 6> m_planes{};
+};
+
+struct CullingStats {
+	auto reset() noexcept -> void;
+	auto add(std::size_t a_visible, std::size_t a_total) noexcept -> void;
+
+	std::size_t visible{};
+	std::size_t culled{};
+	std::size_t occluded{}; // Passed frustum test but hidden behind occluders, counted in culled too.
+};
+
+// Tests a_batch against frustum 4 (SSE) or 8 (AVX) spheres at a time. Writes 1 for visible
+// and 0 for culled spheres into a_visible and returns number of visible spheres.
+auto cull_spheres(const Frustum& a_frustum, const SphereBatch& a_batch, std::vector<std::uint8_t>& a_visible) -> std::size_t;
+}
@@ -6,12 +6,15 @@
 
 #include <variant>
 #include <vector>
+#include <deque>
 #include <array>
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <type_traits>
 
 #include "chill_renderer/assert.hpp"
+#include "chill_renderer/handle_pool.hpp"
 
 
 namespace chill_renderer { 
@@ -24,6 +27,12 @@ struct nulldata_t;
 template<typename T>
 constexpr decltype(auto) to_enum_elem_type(T enumerator) noexcept;
 fs::path guess_path(const std::wstring& a_path);
+// Bytes per texel of sized or base internal format, as allocated by most drivers.
+std::size_t get_texel_size(GLenum a_in_format) noexcept;
+// Levels of full mipmap chain, down to 1x1.
+int get_mip_levels(int a_width, int a_height) noexcept;
+// Bytes of a_levels mips of uncompressed storage.
+std::size_t get_storage_size(GLenum a_in_format, int a_width, int a_height, int a_levels) noexcept;
 
 enum class RenderBufferType {
 	COLOR,
@@ -58,6 +67,8 @@ enum class TextureType {
 	DEPTH_STENCIL,
 	NONE,
 };
+// Sized internal format of render target or raw data texture, float data gets half float color.
+auto conv_sized_format(TextureType a_type, GLenum a_data_type) noexcept -> GLenum;
 
 enum class TextureWrap {
 	REPEAT,
@@ -79,6 +90,7 @@ enum class TextureFilter {
 	NONE,
 };
 auto conv_filter(TextureFilter a_filter, GLuint& tex_min, GLuint& tex_mag) noexcept -> void;
+auto is_mipmap_filter(TextureFilter a_filter) noexcept -> bool;
 
 enum class TextureCmpFunc {
 	LEQUAL,
@@ -108,10 +120,63 @@ struct BufferObjects {
 	GLuint VBO_pos = EMPTY_VBO;
 	GLuint VBO_normals = EMPTY_VBO;
 	GLuint EBO = EMPTY_VBO;
+	ResourceHandle handle{};
 private:
 	auto refcnt_dec() -> void;
 };
 
+// Decoded 8 bit image. Decoding doesn't touch OpenGL, so it can run on worker threads.
+struct ImageData {
+	struct Free {
+		auto operator()(unsigned char* a_pixels) const noexcept -> void;
+	};
+
+	auto get_byte_size() const noexcept -> std::size_t;
+	// Size of texture storage holding this image, with or without its full mipmap chain.
+	auto get_gpu_size(bool a_mipmaps) const noexcept -> std::size_t;
+
+	int width{};
+	int height{};
+	int channels{};
+	std::unique_ptr<unsigned char[], Free> pixels{};
+};
+
+enum class BlockFormat {
+	BC1,
+	BC3,
+	BC4,
+	BC5,
+	BC7,
+};
+
+// Block compressed image with its mip chain. Levels are stored back to back in data, largest first.
+struct CompressedImage {
+	struct Level {
+		int width{};
+		int height{};
+		std::size_t offset{};
+		std::size_t size{};
+	};
+
+	auto get_byte_size() const noexcept -> std::size_t;
+	auto get_block_size() const noexcept -> std::size_t;
+	// BC1 and BC3 use S3TC extension formats, supported by every desktop driver.
+	auto get_gl_format(bool a_gamma_corr) const noexcept -> GLenum;
+	auto has_alpha() const noexcept -> bool;
+	auto get_data() const noexcept -> const unsigned char*;
+
+	BlockFormat format{};
+	std::vector<Level> levels{};
+	std::vector<unsigned char> data{};
+	// Set instead of data when blocks live in memory mapped cooked asset, mapping has to outlive image.
+	const unsigned char* mapped = nullptr;
+};
+
+// Rows are flipped by hand, stb_image flip flag is global and not safe to toggle between threads.
+auto load_image(const std::wstring& a_path, bool a_flip) -> ImageData;
+// 1x1 image of a_value in every channel, e.g. placeholder shown until real image is uploaded.
+auto solid_image(int a_channels, unsigned char a_value) -> ImageData;
+
 // Abstract base
 class Texture {
 public:
@@ -135,17 +200,26 @@ public:
 	auto set_type(TextureType a_type) noexcept -> void;
 
 	auto get_id() const noexcept -> GLuint;
+	auto get_handle() const noexcept -> ResourceHandle;
+	auto get_gltype() const noexcept -> GLenum;
 	auto get_type() const noexcept -> TextureType;
 	auto get_wrap() const noexcept -> TextureWrap;
 	auto get_cmp_func() const noexcept -> TextureCmpFunc;
 	auto get_filter() const noexcept -> TextureFilter;
 	auto get_unit_id() const noexcept -> int; 
+	// Mip count of immutable storage, 0 if storage is mutable. Decided before texture is copied, so copies agree.
+	auto get_immutable_levels() const noexcept -> int;
 
 protected:
 	auto refcnt_dec() -> void;
-	auto refcnt_inc() -> void;
+	auto refcnt_init() -> void;
+	auto gen_id() -> void;
+	auto track_memory(std::size_t a_bytes) -> void;
+	// Immutable storage, cubemaps get all six faces. Its size, format and mip count never change.
+	auto allocate_storage(GLenum a_in_format, int a_width, int a_height, int a_levels, int a_depth = 1) -> void;
 
 	GLuint m_id = EMPTY_VBO;
+	ResourceHandle m_handle{};
 	GLenum m_gltype = GL_NONE;
 
 private:
@@ -154,16 +228,30 @@ private:
 	TextureFilter m_filter = TextureFilter::NONE;
 	TextureCmpFunc m_cmp = TextureCmpFunc::NONE;
 	int m_unit_id = 0;
+	int m_immutable_levels = 0;
+};
+
+// Mutable storage is only for placeholders, it's respecified once their image is in.
+enum class TextureStorage {
+	IMMUTABLE,
+	MUTABLE
 };
 
 class Texture2D : public Texture {
 public:
 	Texture2D() = default;
 	Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image, bool a_gamma_correction, GLenum a_data_type = GL_NONE);
+	// a_image was decoded from a_path already or is a placeholder with mutable storage replaced by upload() later.
+	Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image, bool a_gamma_correction, const ImageData& a_image, GLenum a_data_type = GL_NONE, TextureStorage a_storage = TextureStorage::IMMUTABLE);
+	Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image, bool a_gamma_correction, const CompressedImage& a_image);
 	template<typename T = nulldata_t>
 	Texture2D(TextureType a_type, int a_width, int a_height, GLenum a_data_type = DEFAULT_TYPE, const T* a_data = nullptr);
 
 	auto abstract_construct() -> void;
+	// Refills texture of every copy sharing this id, immutable storage has to match a_image size.
+	// Mutable one is respecified with full mipmap chain if filter uses mipmaps, mipmaps are generated here only.
+	auto upload(const ImageData& a_image, GLenum a_data_type = GL_NONE) -> void;
+	auto upload(const CompressedImage& a_image) -> void;
 
 	auto get_filename() const noexcept -> std::wstring;
 	auto get_path() const noexcept -> std::wstring;
@@ -194,15 +282,25 @@ class TextureCubemap : public Texture {
 public:
 	TextureCubemap() = default;
 	TextureCubemap(TextureType a_type, std::vector<std::wstring> a_paths, bool a_flip_images, bool a_gamma_correction, GLenum a_data_type = DEFAULT_TYPE);
+	// Every face shows a_placeholder until upload_face() or TextureStreamer replaces it.
+	TextureCubemap(TextureType a_type, std::vector<std::wstring> a_paths, bool a_flip_images, bool a_gamma_correction, const ImageData& a_placeholder);
 	template<typename T = nulldata_t>
 	TextureCubemap(TextureType a_type, int a_width, int a_height, GLenum a_data_type = DEFAULT_TYPE, const std::array<T*, 6>& a_data = std::array<nulldata_t*, 6>{});
 
 	auto abstract_construct() -> void;
 
+	auto upload_face(int a_face, const ImageData& a_image, GLenum a_data_type = DEFAULT_TYPE) -> void;
+	// Every face has to bring same number of mips.
+	auto upload_face(int a_face, const CompressedImage& a_image) -> void;
+
 	auto get_paths() const noexcept -> std::vector<std::wstring>;
 	auto get_filenames() const noexcept -> std::vector<std::wstring>;
+	auto is_flipped() const noexcept -> bool;
+	auto is_gamma_corr() const noexcept -> bool;
 
 private:
+	auto init(TextureType a_type, const std::vector<std::wstring>& a_paths) -> void;
+
 	std::vector<std::wstring> m_paths{};
 	bool m_flipped = false;
 	bool m_gamma_corr = true;
@@ -240,6 +338,7 @@ private:
 	auto refcnt_dec() -> void;
 
 	GLuint m_rbo = EMPTY_VBO;
+	ResourceHandle m_handle{};
 	RenderBufferType m_type = RenderBufferType::NONE;
 	int m_samples = 1;
 };
@@ -302,6 +401,7 @@ private:
 	int m_height = 0;
 	int m_samples = 1;
 	GLuint m_fbo = EMPTY_VBO;
+	ResourceHandle m_handle{};
 	AttachmentBuffer m_color_attachment{};
 	AttachmentBuffer m_depth_attachment{};
 	AttachmentBuffer m_depth_stencil_attachment{};
@@ -350,7 +450,8 @@ public:
 
 private: 
 	auto refcnt_dec() -> void;
-	auto refcnt_inc() -> void;
+	auto refcnt_init() -> void;
+	auto gen_id() -> void;
 
 	template<typename T>
 	auto get_size_and_base_alignment();
@@ -358,9 +459,82 @@ private:
 	int m_size{}; // bytes
 	int m_binding_point{-1};
 	GLuint m_id{ EMPTY_VBO };
+	ResourceHandle m_handle{};
 	NameUniMap m_elements{};
 }; 
 
+// Ring of staging memory for CPU -> GPU buffer updates. Regions are mapped unsynchronized and either copied
+// on GPU into destination buffer or bound directly, fences only block when ring wraps onto data GPU hasn't used yet.
+class StreamBuffer {
+public:
+	StreamBuffer() = default;
+	StreamBuffer(std::size_t a_capacity);
+	StreamBuffer(const StreamBuffer& a_stream_buf) = delete;
+	StreamBuffer(StreamBuffer&& a_stream_buf) noexcept;
+	~StreamBuffer();
+
+	auto operator=(const StreamBuffer& a_stream_buf) -> StreamBuffer& = delete;
+	auto operator=(StreamBuffer&& a_stream_buf) noexcept -> StreamBuffer&;
+
+	// Copies a_siz bytes of a_data into a_dst_buf at a_dst_offset.
+	auto upload(GLuint a_dst_buf, std::size_t a_dst_offset, const void* a_data, std::size_t a_siz) -> void;
+	// Writes a_data into ring and returns its offset for binding ranges of get_id(). Call fence() after commands reading it.
+	auto write(const void* a_data, std::size_t a_siz, std::size_t a_alignment = 16) -> std::size_t;
+	auto fence() -> void;
+
+	auto get_id() const noexcept -> GLuint;
+	auto get_capacity() const noexcept -> std::size_t;
+
+private:
+	struct Region {
+		std::size_t begin{};
+		std::size_t end{};
+		GLsync fence{};
+	};
+
+	auto reserve(std::size_t a_siz) -> void;
+	auto wait_regions(std::size_t a_begin, std::size_t a_end) -> void;
+	auto release() noexcept -> void;
+
+	std::size_t m_capacity{};
+	std::size_t m_head{};
+	GLuint m_id{ EMPTY_VBO };
+	std::vector<Region> m_regions{};
+};
+
+// Rows of streamed images are copied in strips of about this many bytes.
+inline constexpr std::size_t g_texture_strip_bytes = 1024 * 1024;
+
+// Streams decoded images into textures through StreamBuffer bound as pixel unpack buffer, a few strips
+// of rows per frame, so big textures never stall the driver in one glTexImage2D. Mutable level 0 of placeholder
+// is reallocated once image starts streaming, texture samples black while incomplete and mipmaps are generated at the end.
+class TextureStreamer {
+public:
+	// Copies of textures are held until their image is in.
+	auto push(const Texture2D& a_texture, ImageData&& a_image) -> void;
+	auto push(const TextureCubemap& a_cubemap, int a_face, ImageData&& a_image) -> void;
+	// Streams strips until a_byte_budget is spent, returns streamed bytes.
+	auto update(std::size_t a_byte_budget) -> std::size_t;
+
+	auto get_pending() const noexcept -> std::size_t;
+
+private:
+	struct Upload {
+		std::variant<Texture2D, TextureCubemap> texture{};
+		GLenum target{};
+		unsigned in_format{};
+		unsigned ex_format{};
+		ImageData image{};
+		int next_row = -1; // Storage isn't prepared yet.
+	};
+
+	auto push_upload(Upload&& a_upload, bool a_gamma_corr) -> void;
+	auto finish(const Upload& a_upload) -> void;
+
+	std::deque<Upload> m_uploads{};
+	StreamBuffer m_stream_buf{};
+};
+
 // Template definitions
 #include "buffers_templates.cpp"
 }
@@ -27,22 +27,21 @@ Texture2D::Texture2D(TextureType a_type, int a_width, int a_height, GLenum a_dat
 	m_gltype = GL_TEXTURE_2D;
 	set_type(a_type);
 
-	glGenTextures(1, &m_id);
-	refcnt_inc();
+	gen_id();
+	refcnt_init();
 	glBindTexture(m_gltype, m_id); 
 
-	GLint in_format{};
+	GLenum in_format = conv_sized_format(a_type, a_data_type);
 	GLenum format{}; 
 	if (a_type == TextureType::GENERIC || a_type == TextureType::DIFFUSE || a_type == TextureType::SPECULAR || a_type == TextureType::EMISSION) {
-		in_format = format = GL_RGB;
+		format = GL_RGB;
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
 	}
 	else if (a_type == TextureType::DEPTH) {
-		in_format = format = GL_DEPTH_COMPONENT;
+		format = GL_DEPTH_COMPONENT;
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
 	}
 	else if (a_type == TextureType::DEPTH_STENCIL) {
-		in_format = GL_DEPTH24_STENCIL8;
 		format = GL_DEPTH_STENCIL;
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_INT_24_8 : a_data_type;
 	}
@@ -50,15 +49,17 @@ Texture2D::Texture2D(TextureType a_type, int a_width, int a_height, GLenum a_dat
 		ERROR("[TEXTURE2D::TEXTURE2D] Wrong TextureType.", Error_action::throwing);
 	}
 
-	if constexpr (std::is_same_v<T, nulldata_t>) {
-		glTexImage2D(m_gltype, 0, in_format, a_width, a_height, 0, format, a_data_type, NULL);
-	}
-	else if (cmp_types<T>(a_data_type)){
-		glTexImage2D(m_gltype, 0, in_format, a_width, a_height, 0, format, a_data_type, a_data);
+	if constexpr (!std::is_same_v<T, nulldata_t>) {
+		if (!cmp_types<T>(a_data_type)) {
+			ERROR("[TEXTURE2D::TEXTURE2D] Data pointer doesn't match selected data_type.", Error_action::throwing);
+		}
 	}
-	else {
-		ERROR("[TEXTURE2D::TEXTURE2D] Data pointer doesn't match selected data_type.", Error_action::throwing);
+	// Render targets and data textures have no mipmaps.
+	allocate_storage(in_format, a_width, a_height, 1);
+	if constexpr (!std::is_same_v<T, nulldata_t>) {
+		glTexSubImage2D(m_gltype, 0, 0, 0, a_width, a_height, format, a_data_type, a_data);
 	}
+	track_memory(get_storage_size(in_format, a_width, a_height, 1));
 
 	set_wrap(TextureWrap::CLAMP_EDGE);
 	set_filter(TextureFilter::LINEAR);
@@ -69,8 +70,8 @@ Texture3D::Texture3D(TextureType a_type, int a_width, int a_height, int a_depth,
 	set_type(a_type);
 	m_gltype = GL_TEXTURE_3D;
 
-	glGenTextures(1, &m_id);
-	refcnt_inc();
+	gen_id();
+	refcnt_init();
 	glBindTexture(m_gltype, m_id);
 
 	GLint in_format{};
@@ -86,11 +87,12 @@ Texture3D::Texture3D(TextureType a_type, int a_width, int a_height, int a_depth,
 		case GL_UNSIGNED_INT: in_format = GL_RGBA32UI; break;
 		case GL_UNSIGNED_BYTE: in_format = GL_RGBA8UI; break;
 		case GL_UNSIGNED_SHORT: in_format = GL_RGBA16UI; break;
-		default: in_format = GL_RGBA;
+		default: in_format = GL_RGBA8;
 		}
 	}
 	else if (a_type == TextureType::DEPTH) {
-		in_format = format = GL_DEPTH_COMPONENT;
+		in_format = GL_DEPTH_COMPONENT32F;
+		format = GL_DEPTH_COMPONENT;
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
 	}
 	else if (a_type == TextureType::DEPTH_STENCIL) {
@@ -102,15 +104,16 @@ Texture3D::Texture3D(TextureType a_type, int a_width, int a_height, int a_depth,
 		ERROR("[TEXTURE3D::TEXTURE3D] Wrong TextureType.", Error_action::throwing);
 	} 
 
-	if constexpr (std::is_same_v<T, nulldata_t>) {
-		glTexImage3D(m_gltype, 0, in_format, a_width, a_height, a_depth, 0, format, a_data_type, NULL);
-	} 
-	else if (cmp_types<T>(a_data_type)) {
-		glTexImage3D(m_gltype, 0, in_format, a_width, a_height, a_depth, 0, format, a_data_type, a_data);
+	if constexpr (!std::is_same_v<T, nulldata_t>) {
+		if (!cmp_types<T>(a_data_type)) {
+			ERROR("[TEXTURE3D::TEXTURE3D] Data pointer doesn't match selected data type.", Error_action::throwing);
+		}
 	}
-	else {
-		ERROR("[TEXTURE3D::TEXTURE3D] Data pointer doesn't match selected data type.", Error_action::throwing);
+	allocate_storage(in_format, a_width, a_height, 1, a_depth);
+	if constexpr (!std::is_same_v<T, nulldata_t>) {
+		glTexSubImage3D(m_gltype, 0, 0, 0, 0, a_width, a_height, a_depth, format, a_data_type, a_data);
 	}
+	track_memory(a_depth * get_storage_size(in_format, a_width, a_height, 1));
 
 	set_wrap(TextureWrap::CLAMP_EDGE);
 	set_filter(TextureFilter::LINEAR);
@@ -121,44 +124,43 @@ TextureCubemap::TextureCubemap(TextureType a_type, int a_width, int a_height, GL
 	m_gltype = GL_TEXTURE_CUBE_MAP;
 	set_type(a_type);
 
-	glGenTextures(1, &m_id);
-	refcnt_inc();
+	gen_id();
+	refcnt_init();
 	glBindTexture(m_gltype, m_id); 
 
-	GLint in_format{};
+	GLenum in_format = conv_sized_format(a_type, a_data_type);
 	GLenum format{};
 	if (a_type == TextureType::GENERIC || a_type == TextureType::DIFFUSE || a_type == TextureType::SPECULAR || a_type == TextureType::EMISSION) {
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
-		in_format = GL_RGB;
 		format = GL_RGB;
 	}
 	else if (a_type == TextureType::DEPTH) {
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
-		in_format = GL_DEPTH_COMPONENT;
 		format = GL_DEPTH_COMPONENT;
 	}
 	else if (a_type == TextureType::DEPTH_STENCIL) {
 		a_data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_INT_24_8 : a_data_type;
-		in_format = GL_DEPTH24_STENCIL8;
 		format = GL_DEPTH_STENCIL;
 	} 
 	else {
 		ERROR("[TEXTURECUBEMAP::TEXTURECUBEMAP] Wrong TextureType.", Error_action::throwing);
 	}
 
-	if constexpr (std::is_same_v<T, nulldata_t>) {
-		for (int i = 0; i < 6; ++i) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, in_format, a_width, a_height, 0, format, a_data_type, a_data[i]);
+	if constexpr (!std::is_same_v<T, nulldata_t>) {
+		if (!cmp_types<T>(a_data_type)) {
+			ERROR("[TEXTURECUBEMAP::TEXTURECUBEMAP] Data pointer doesn't match selected data_type.", Error_action::throwing);
 		}
 	}
-	else if(cmp_types<T>(a_data_type)) {
+	// One storage holds all six faces.
+	allocate_storage(in_format, a_width, a_height, 1);
+	if constexpr (!std::is_same_v<T, nulldata_t>) {
 		for (int i = 0; i < 6; ++i) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, in_format, a_width, a_height, 0, format, a_data_type, a_data[i]);
+			if (a_data[i]) {
+				glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, a_width, a_height, format, a_data_type, a_data[i]);
+			}
 		}
 	}
-	else {
-		ERROR("[TEXTURECUBEMAP::TEXTURECUBEMAP] Data pointer doesn't match selected data_type.", Error_action::throwing);
-	}
+	track_memory(6 * get_storage_size(in_format, a_width, a_height, 1));
 
 
 	set_wrap(TextureWrap::CLAMP_EDGE);
@@ -196,8 +198,8 @@ UniformBufferElement& UniformBufferElement::operator=(const T& a_value) {
 template<typename T>
 void UniformBuffer::push_element(const std::string& a_uniform_name) {
 	if (m_id == EMPTY_VBO) {
-		glGenBuffers(1, &m_id);
-		refcnt_inc();
+		gen_id();
+		refcnt_init();
 	}
 
 	auto [size, base_alignment] = get_size_and_base_alignment<T>();
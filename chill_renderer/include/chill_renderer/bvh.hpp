@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "chill_renderer/bounds.hpp"
+
+namespace chill_renderer {
+inline constexpr int g_bvh_null_node = -1;
+
+struct RayHit {
+	std::uint32_t user_data{};
+	float distance{};
+};
+
+// Incremental AABB tree. Leaves store fattened boxes so small movements don't touch the tree,
+// ancestors are refitted and rotated (surface area heuristic) on every insert and remove.
+class DynamicBVH {
+public:
+	DynamicBVH(float a_margin = 0.1f);
+
+	auto create_proxy(const AABB& a_aabb, std::uint32_t a_user_data) -> int;
+	auto destroy_proxy(int a_proxy) -> void;
+	auto move_proxy(int a_proxy, const AABB& a_aabb) -> bool;
+	auto clear() noexcept -> void;
+
+	// Leaves completely inside frustum go to a_inside, leaves crossing frustum planes go to a_intersecting.
+	auto query_frustum(const Frustum& a_frustum, std::vector<std::uint32_t>& a_inside, std::vector<std::uint32_t>& a_intersecting) const -> void;
+	auto query_sphere(const BoundingSphere& a_sphere, std::vector<std::uint32_t>& a_out) const -> void;
+	// Hits are sorted by distance to box entry point.
+	auto query_ray(const glm::vec3& a_origin, const glm::vec3& a_dir, float a_max_dist, std::vector<RayHit>& a_out) const -> void;
+	// Up to a_k leaves nearest to a_point, sorted from nearest.
+	auto query_nearest(const glm::vec3& a_point, std::size_t a_k, float a_max_dist, std::vector<std::uint32_t>& a_out, const std::function<bool(std::uint32_t)>& a_filter = {}) const -> void;
+
+	auto get_user_data(int a_proxy) const noexcept -> std::uint32_t;
+	auto get_fat_aabb(int a_proxy) const noexcept -> const AABB&;
+	auto get_height() const noexcept -> int;
+	auto get_proxy_count() const noexcept -> std::size_t;
+
+private:
+	struct Node {
+		auto is_leaf() const noexcept -> bool;
+
+		AABB aabb{};
+		std::uint32_t user_data{};
+		int parent = g_bvh_null_node; // Next free node when on free list.
+		int child1 = g_bvh_null_node;
+		int child2 = g_bvh_null_node;
+		int height = -1;              // -1 for free nodes, 0 for leaves.
+	};
+
+	auto alloc_node() -> int;
+	auto free_node(int a_node) -> void;
+	auto fatten(const AABB& a_aabb) const noexcept -> AABB;
+	auto insert_leaf(int a_leaf) -> void;
+	auto remove_leaf(int a_leaf) -> void;
+	auto refit(int a_node) -> void;
+	auto rotate(int a_node) -> void;
+
+	float m_margin{};
+	int m_root = g_bvh_null_node;
+	int m_free_list = g_bvh_null_node;
+	std::size_t m_proxy_count{};
+	std::vector<Node> m_nodes{};
+};
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "chill_renderer/model.hpp"
+#include "chill_renderer/shaders.hpp"
+
+namespace chill_renderer {
+// Compact binary stream of program binds, uniform writes and draws. Recording only reads objects and
+// never calls OpenGL, so separate buffers can be recorded on job system in parallel. execute() replays
+// stream on render thread. Uniforms are written to program bound by last use_program().
+class CommandBuffer {
+public:
+	// Binds program and its states, same as ShaderProgram::use().
+	auto use_program(const ShaderProgram& a_shader) -> void;
+	auto set_state(ShaderState a_state, bool a_option) -> void;
+	auto set_uniform(int a_location, int a_value) -> void;
+	auto set_uniform(int a_location, float a_value) -> void;
+	auto set_uniform(int a_location, const glm::vec3& a_value) -> void;
+	auto set_uniform(int a_location, const glm::mat3& a_value) -> void;
+	auto set_uniform(int a_location, const glm::mat4& a_value) -> void;
+	auto set_material(const MaterialMap& a_material, const MaterialLocations& a_locations) -> void;
+	auto bind_texture(const Texture& a_texture) -> void;
+	auto draw(const Mesh& a_mesh) -> void;
+	// Meshes without material maps.
+	auto draw(Model& a_model) -> void;
+	auto draw(Model& a_model, const MaterialLocations& a_locations) -> void;
+
+	auto execute() const -> void;
+	auto clear() noexcept -> void;
+
+	auto is_empty() const noexcept -> bool;
+	auto get_byte_size() const noexcept -> std::size_t;
+
+private:
+	enum class Command : std::uint8_t {
+		USE_PROGRAM,
+		SET_STATE,
+		UNIFORM_INT,
+		UNIFORM_FLOAT,
+		UNIFORM_VEC3,
+		UNIFORM_MAT3,
+		UNIFORM_MAT4,
+		BIND_TEXTURE,
+		DRAW,
+	};
+
+	struct ProgramCmd {
+		GLuint program{};
+		bool depth_test{};
+		bool stencil_test{};
+		bool face_culling{};
+		bool point_size{};
+		bool gamma_corr{};
+	};
+
+	struct StateCmd {
+		GLenum cap{};
+		bool enabled{};
+	};
+
+	template<typename T>
+	struct UniformCmd {
+		int location{};
+		T value{};
+	};
+
+	struct TextureCmd {
+		GLenum unit{};
+		GLenum target{};
+		GLuint id{};
+	};
+
+	struct DrawCmd {
+		GLuint VAO{};
+		GLenum mode{};
+		GLsizei count{};
+		bool indexed{};
+		bool wireframe{};
+	};
+
+	template<typename T>
+	auto push(Command a_cmd, const T& a_payload) -> void;
+	template<typename T>
+	static auto read(const std::byte*& a_pos) noexcept -> T;
+
+	std::vector<std::byte> m_stream{};
+};
+
+template<typename T>
+void CommandBuffer::push(Command a_cmd, const T& a_payload) {
+	std::size_t offset = m_stream.size();
+	m_stream.resize(offset + sizeof(Command) + sizeof(T));
+	std::memcpy(m_stream.data() + offset, &a_cmd, sizeof(Command));
+	std::memcpy(m_stream.data() + offset + sizeof(Command), &a_payload, sizeof(T));
+}
+
+template<typename T>
+T CommandBuffer::read(const std::byte*& a_pos) noexcept {
+	T value;
+	std::memcpy(&value, a_pos, sizeof(T));
+	a_pos += sizeof(T);
+	return value;
+}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <span>
+#include <cstdint>
+
+#include "chill_renderer/model.hpp"
+#include "chill_renderer/meshes.hpp"
+#include "chill_renderer/buffers.hpp"
+#include "chill_renderer/file_manager.hpp"
+
+namespace chill_renderer {
+// Cooked model files written by chill_cook. Everything is stored as uploaded, so loading is mapping the file
+// and handing its ranges to OpenGL. Offsets are from start of file, data blocks are aligned to g_cooked_align.
+inline constexpr std::uint32_t g_cooked_magic = 0x4C4C4843; // "CHLL"
+inline constexpr std::uint32_t g_cooked_version = 1;
+inline constexpr std::uint64_t g_cooked_align = 16;
+inline constexpr const wchar_t* g_cooked_extension = L".chill";
+
+enum CookedFlags : std::uint32_t {
+	COOKED_FLIPPED_UVS = 1 << 0,
+};
+
+struct CookedHeader {
+	std::uint32_t magic{};
+	std::uint32_t version{};
+	std::uint32_t flags{};
+	std::uint32_t mesh_siz{};
+	std::uint32_t material_siz{};
+	std::uint32_t material_texture_siz{};
+	std::uint32_t texture_siz{};
+	std::uint32_t padding{};
+	glm::vec3 bounds_min{};
+	glm::vec3 bounds_max{};
+	std::uint64_t meshes_offset{};
+	std::uint64_t materials_offset{};
+	std::uint64_t material_textures_offset{};
+	std::uint64_t textures_offset{};
+};
+
+// Vertex streams match buffers of Mesh, one per attribute.
+struct CookedMesh {
+	std::uint32_t material_idx{};
+	std::uint32_t position_siz{};
+	std::uint32_t UV_siz{};
+	std::uint32_t normal_siz{};
+	std::uint32_t index_siz{};
+	std::uint32_t padding{};
+	glm::vec3 bounds_min{};
+	glm::vec3 bounds_max{};
+	std::uint64_t positions_offset{};
+	std::uint64_t UVs_offset{};
+	std::uint64_t normals_offset{};
+	std::uint64_t indicies_offset{};
+};
+
+// Range of material textures table.
+struct CookedMaterial {
+	std::uint32_t first_texture{};
+	std::uint32_t texture_siz{};
+};
+
+struct CookedMaterialTexture {
+	std::uint32_t texture_idx{};
+	std::uint32_t type{};
+	std::int32_t unit_id{};
+	std::uint32_t padding{};
+};
+
+// Block compressed image with tightly packed mips. Images which couldn't be compressed have no levels,
+// they're loaded from their source path instead.
+struct CookedTexture {
+	std::uint32_t format{};
+	std::uint32_t level_siz{};
+	std::uint32_t width{};
+	std::uint32_t height{};
+	std::uint64_t data_offset{};
+	std::uint64_t data_siz{};
+	std::uint64_t path_offset{};
+	std::uint64_t path_siz{}; // UTF-8 bytes, source path of image.
+};
+
+static_assert(sizeof(CookedHeader) == 88 && sizeof(CookedMesh) == 80 && sizeof(CookedMaterial) == 8 &&
+	sizeof(CookedMaterialTexture) == 16 && sizeof(CookedTexture) == 48, "Cooked layout is part of file format.");
+
+auto is_cooked_file(const std::wstring& a_path) -> bool;
+// Textures are block compressed with their mips, ones that can't be are referenced by path.
+auto cook_model(const ModelImport& a_import, const fs::path& a_out_path) -> void;
+
+// Validated, memory mapped cooked model. Views returned by it point into mapping.
+class CookedAsset {
+public:
+	CookedAsset(const std::wstring& a_path);
+
+	auto get_mesh_view(const CookedMesh& a_mesh) const -> MeshView;
+	// Image borrows blocks from mapping, it can't outlive this asset.
+	auto get_image(const CookedTexture& a_texture) const -> CompressedImage;
+	auto get_texture_path(const CookedTexture& a_texture) const -> std::wstring;
+
+	auto get_header() const noexcept -> const CookedHeader&;
+	auto get_meshes() const noexcept -> std::span<const CookedMesh>;
+	auto get_materials() const noexcept -> std::span<const CookedMaterial>;
+	auto get_material_textures() const noexcept -> std::span<const CookedMaterialTexture>;
+	auto get_textures() const noexcept -> std::span<const CookedTexture>;
+	auto get_path() const noexcept -> std::wstring;
+	auto get_byte_size() const noexcept -> std::size_t;
+
+private:
+	// Checks range lies in file before viewing it.
+	template<typename T>
+	auto get_array(std::uint64_t a_offset, std::uint64_t a_siz) const -> std::span<const T>;
+
+	std::wstring m_path{};
+	MappedFile m_file{};
+	const CookedHeader* m_header = nullptr;
+};
+}
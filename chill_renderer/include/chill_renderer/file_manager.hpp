@@ -3,6 +3,7 @@
 #include <string>  // wstring
 #include <vector>  // vector
 #include <utility> // pair
+#include <cstddef> // size_t
 
 namespace chill_renderer {
 std::string wstos(const std::wstring& a_ws_src);
@@ -11,4 +12,27 @@ std::wstring basic_file_open(
 	const std::wstring& a_title,
 	const std::vector<std::pair<std::wstring,std::wstring>>& a_save_types
 ); 
+
+// Read only mapping of whole file, pages are read in by OS as they're touched.
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const std::wstring& a_path);
+	MappedFile(const MappedFile& a_file) = delete;
+	MappedFile(MappedFile&& a_file) noexcept;
+	~MappedFile();
+
+	auto operator=(const MappedFile& a_file) -> MappedFile& = delete;
+	auto operator=(MappedFile&& a_file) noexcept -> MappedFile&;
+
+	auto get_data() const noexcept -> const unsigned char*;
+	auto get_size() const noexcept -> std::size_t;
+
+private:
+	auto unmap() noexcept -> void;
+
+	const unsigned char* m_data = nullptr;
+	std::size_t m_size{};
+	void* m_handle = nullptr; // File mapping object on Windows.
+};
 }
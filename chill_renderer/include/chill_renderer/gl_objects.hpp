@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <array>
+#include <deque>
+#include <vector>
+
+namespace chill_renderer {
+// Names generated by single glGen* call once pool of their type runs dry.
+inline constexpr GLsizei g_gl_name_batch = 64;
+
+enum class GLObjectType {
+	BUFFER,
+	VERTEX_ARRAY,
+	TEXTURE,
+	RENDER_BUFFER,
+	FRAME_BUFFER,
+	SHADER,
+	PROGRAM,
+	COUNT,
+};
+
+// GL object names of render thread. Names are generated in batches, released objects are deleted
+// together once fence of frame that released them signals, so destructors never stall on objects GPU still uses.
+class GLObjects {
+public:
+	GLObjects() = default;
+	GLObjects(const GLObjects& a_objects) = delete;
+	// Deletes everything still queued, GPU is done with it or context is going away.
+	~GLObjects();
+
+	auto operator=(const GLObjects& a_objects) -> GLObjects& = delete;
+
+	// Shaders and programs are created by glCreate*, they can only be released here.
+	auto gen(GLObjectType a_type) -> GLuint;
+	auto release(GLObjectType a_type, GLuint a_id) -> void;
+	// Call once per frame on render thread, never blocks. Fences objects released since last call
+	// and deletes ones whose fence signaled.
+	auto end_frame() -> void;
+
+	auto get_pending() const noexcept -> std::size_t;
+
+private:
+	using Names = std::array<std::vector<GLuint>, static_cast<std::size_t>(GLObjectType::COUNT)>;
+
+	struct Frame {
+		GLsync fence{};
+		Names released{};
+	};
+
+	static auto delete_names(Names& a_names) -> void;
+
+	Names m_free{};
+	Names m_released{};
+	std::deque<Frame> m_frames{};
+};
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace chill_renderer {
+inline constexpr std::uint32_t g_empty_handle = ~0u;
+// Slots are allocated in fixed chunks, so they never move while pool grows.
+inline constexpr std::size_t g_handle_chunk_siz = 1024;
+inline constexpr std::size_t g_handle_max_chunks = 1024;
+
+#if defined(CHILL_ATOMIC_REF_COUNTS)
+using RefCount = std::atomic<int>;
+#else
+using RefCount = int;
+#endif
+
+// Slot index and its generation at creation time. Handles of released slots no longer match their slot.
+struct ResourceHandle {
+	auto is_empty() const noexcept -> bool;
+	auto operator==(const ResourceHandle& a_handle) const noexcept -> bool = default;
+
+	std::uint32_t index = g_empty_handle;
+	std::uint32_t generation = 0;
+};
+
+// Dense slots with GL id, inline reference count and GPU memory of one resource type. Slots are acquired and
+// released on render thread. With CHILL_ATOMIC_REF_COUNTS references can be added and dropped from any thread,
+// as long as render thread drops the last one.
+class HandlePool {
+public:
+	HandlePool() = default;
+	HandlePool(const HandlePool& a_pool) = delete;
+
+	auto operator=(const HandlePool& a_pool) -> HandlePool& = delete;
+
+	// New slot starts with one reference.
+	auto acquire(GLuint a_id) -> ResourceHandle;
+	auto release(ResourceHandle a_handle) noexcept -> void;
+	auto inc(ResourceHandle a_handle) noexcept -> void;
+	// Returns count before decrement, only caller that saw 1 releases slot.
+	auto dec(ResourceHandle a_handle) noexcept -> int;
+	// Replaces bytes accounted to slot, they are subtracted from pool total once slot is released.
+	auto set_bytes(ResourceHandle a_handle, std::size_t a_bytes) noexcept -> void;
+	auto touch(ResourceHandle a_handle, std::uint64_t a_frame) noexcept -> void;
+
+	auto is_valid(ResourceHandle a_handle) const noexcept -> bool;
+	auto get_id(ResourceHandle a_handle) const noexcept -> GLuint;
+	auto get_ref_count(ResourceHandle a_handle) const noexcept -> int;
+	auto get_bytes(ResourceHandle a_handle) const noexcept -> std::size_t;
+	auto get_last_used(ResourceHandle a_handle) const noexcept -> std::uint64_t;
+	auto get_total_bytes() const noexcept -> std::size_t;
+	// GL ids and reference counts of live slots.
+	auto get_live() const -> std::vector<std::pair<GLuint, int>>;
+
+private:
+	struct Slot {
+		GLuint id{};
+		std::uint32_t generation{};
+		bool live = false;
+		RefCount refs{};
+		std::size_t bytes{};
+		std::uint64_t last_used{};
+	};
+
+	auto get_slot(std::uint32_t a_idx) const noexcept -> Slot&;
+
+	std::array<std::unique_ptr<Slot[]>, g_handle_max_chunks> m_chunks{};
+	std::uint32_t m_siz{};
+	std::size_t m_bytes{};
+	std::vector<std::uint32_t> m_free{};
+};
+}
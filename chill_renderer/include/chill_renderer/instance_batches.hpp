@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "chill_renderer/model.hpp"
+
+namespace chill_renderer {
+// Batched shaders read entries instance_offset + gl_InstanceID of these storage buffers.
+inline constexpr int g_batch_transforms_binding = 0;
+inline constexpr int g_batch_colors_binding = 1;
+// Smaller groups are drawn one by one with per model uniforms.
+inline constexpr std::size_t g_batch_min_instances = 2;
+
+// Groups draws of models sharing meshes and materials into instanced draws. Collected, built and drawn
+// in every pass, instance data only lives in stream buffer until GPU is done drawing it.
+class InstanceBatches {
+public:
+	auto clear() noexcept -> void;
+	auto push(Model& a_model) -> void;
+	// Color is read by batched shaders at g_batch_colors_binding.
+	auto push(Model& a_model, const glm::vec3& a_color) -> void;
+	// Streams instance data of groups with at least g_batch_min_instances models, other models are appended to a_singles
+	// and their pushed colors to a_single_colors, if given.
+	auto build(std::vector<Model*>& a_singles, std::vector<glm::vec3>* a_single_colors = nullptr) -> void;
+	// Issues one instanced draw per mesh of every group. Caller uses a_shader before.
+	auto draw(ShaderProgram& a_shader, const std::string& a_material_map_uniform_name = "") -> void;
+
+	auto get_batch_count() const noexcept -> std::size_t;
+	auto get_instance_count() const noexcept -> std::size_t;
+
+private:
+	struct Entry {
+		Model* model{};
+		glm::vec4 color{};
+		std::size_t group{};
+	};
+
+	struct Batch {
+		Model* model{};
+		int offset{};
+		int count{};
+	};
+
+	auto push_entry(Model& a_model, const glm::vec4& a_color) -> void;
+	auto make_key(Model& a_model) -> bool;
+
+	bool m_colors_used = false;
+	GLint m_alignment{};
+	std::size_t m_instance_siz{};
+	std::size_t m_transforms_offset{};
+	std::size_t m_colors_offset{};
+	std::vector<std::uint64_t> m_key{};
+	std::map<std::vector<std::uint64_t>, std::size_t> m_groups{};
+	std::vector<std::size_t> m_group_sizes{};
+	std::vector<std::size_t> m_group_batches{};
+	std::vector<Entry> m_entries{};
+	std::vector<Batch> m_batches{};
+	std::vector<std::byte> m_staging{};
+	StreamBuffer m_stream_buf{};
+};
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace chill_renderer {
+// Ranges of parallel_for are split into at most this many chunks per worker, so stealing can even out uneven chunks.
+inline constexpr std::size_t g_jobs_chunks_per_worker = 4;
+
+// Counts unfinished jobs of a group. Waiting on it and continuations scheduled with JobSystem::then() fire when it drops to zero.
+// First exception thrown by its jobs is kept and rethrown by JobSystem::wait().
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter& a_counter) = delete;
+	auto operator=(const JobCounter& a_counter) -> JobCounter& = delete;
+
+	auto is_done() const noexcept -> bool;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> m_pending{};
+	std::mutex m_mutex{};
+	std::exception_ptr m_error{};
+	std::vector<std::function<void()>> m_continuations{};
+};
+
+// Passed to timing hook after every job, times are taken on thread that ran the job.
+struct JobTiming {
+	const char* name{};
+	std::size_t worker{};
+	std::chrono::steady_clock::time_point begin{};
+	std::chrono::steady_clock::time_point end{};
+};
+
+// Job count and time summed per job name. Timings are recorded from any thread, totals are published once per frame.
+class JobProfiler {
+public:
+	struct Entry {
+		std::size_t count{};
+		double ms{};
+	};
+
+	auto record(const JobTiming& a_timing) -> void;
+	// Publishes totals recorded since last call and starts over.
+	auto end_frame() -> void;
+	auto get_frame() const -> std::map<std::string, Entry>;
+
+private:
+	mutable std::mutex m_mutex{};
+	std::map<std::string, Entry> m_recording{};
+	std::map<std::string, Entry> m_frame{};
+};
+
+// Work stealing scheduler sized to hardware concurrency. Every worker owns deque it pops newest jobs from,
+// idle workers steal oldest jobs of others. Thread that created the system is worker 0, it only runs jobs
+// while waiting, so waiting never blocks progress of jobs it depends on.
+class JobSystem {
+public:
+	using Task = std::function<void()>;
+	using TimingHook = std::function<void(const JobTiming&)>;
+
+	// 0 threads means hardware concurrency.
+	JobSystem(std::size_t a_threads_siz = 0);
+	JobSystem(const JobSystem& a_jobs) = delete;
+	~JobSystem();
+
+	auto operator=(const JobSystem& a_jobs) -> JobSystem& = delete;
+
+	// Runs a_task on any worker, a_counter is decremented when it finishes.
+	auto submit(Task a_task, JobCounter* a_counter = nullptr, const char* a_name = "job") -> void;
+	// Low priority jobs like file loads. Only workers left without other jobs take them and wait() never does,
+	// so waiting thread isn't stalled by them. Runs a_task right away if system has no worker threads.
+	auto submit_background(Task a_task, JobCounter* a_counter = nullptr, const char* a_name = "background") -> void;
+	// Submits a_task once all jobs counted by a_dependency finished, immediately if they already did.
+	auto then(JobCounter& a_dependency, Task a_task, JobCounter* a_counter = nullptr, const char* a_name = "continuation") -> void;
+	// Runs other jobs until a_counter drops to zero, then rethrows first exception of its jobs. Counter can be destroyed once this returns.
+	auto wait(JobCounter& a_counter) -> void;
+	// Calls a_func(begin, end) on chunks of [a_begin, a_end) no smaller than a_grain and waits for all of them.
+	// First exception of chunks is rethrown after all of them finished.
+	auto parallel_for(std::size_t a_begin, std::size_t a_end, std::size_t a_grain, const std::function<void(std::size_t, std::size_t)>& a_func, const char* a_name = "parallel_for") -> void;
+	// Set before submitting jobs, hook is called from worker threads.
+	auto set_timing_hook(TimingHook a_hook) -> void;
+
+	auto get_worker_count() const noexcept -> std::size_t;
+	// Index of calling thread, workers_count for threads outside of the system.
+	auto get_worker_idx() const noexcept -> std::size_t;
+
+private:
+	struct Job {
+		Task task{};
+		JobCounter* counter{};
+		const char* name{};
+	};
+
+	struct Worker {
+		std::mutex mutex{};
+		std::deque<Job> jobs{};
+	};
+
+	auto push(Job&& a_job) -> void;
+	auto worker_loop(std::size_t a_idx) -> void;
+	auto try_pop(std::size_t a_idx, Job& a_job) -> bool;
+	auto try_steal(std::size_t a_idx, Job& a_job) -> bool;
+	auto try_pop_background(Job& a_job) -> bool;
+	auto run(Job& a_job, std::size_t a_idx) -> void;
+	auto finish(JobCounter* a_counter, std::exception_ptr a_error) -> void;
+
+	std::atomic<bool> m_stop = false;
+	std::atomic<std::size_t> m_queued{};
+	std::atomic<std::size_t> m_next_victim{};
+	std::mutex m_sleep_mutex{};
+	std::condition_variable m_wake{};
+	TimingHook m_timing_hook{};
+	std::vector<std::unique_ptr<Worker>> m_workers{};
+	std::mutex m_background_mutex{};
+	std::deque<Job> m_background{};
+	std::vector<std::jthread> m_threads{};
+};
+}
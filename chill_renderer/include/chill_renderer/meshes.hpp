@@ -1,10 +1,13 @@
 #pragma once
 #include "glm/glm.hpp"
 
-#include <vector>
+#include <span>
 #include <tuple>
+#include <memory>
+#include <vector>
 
 #include "chill_renderer/buffers.hpp"
+#include "chill_renderer/bounds.hpp"
 
 namespace chill_renderer {
 inline constexpr int g_attrib_pos_location = 0;
@@ -32,9 +35,10 @@ public:
 	auto set_emission_maps(const std::vector<std::tuple<std::wstring,bool,bool>>& a_emission_maps_names) -> void;
 	auto set_shininess(float a_shininess) noexcept -> void;
 
-	auto get_diffuse_maps() const noexcept -> std::vector<Texture2D>;
-	auto get_specular_maps() const noexcept -> std::vector<Texture2D>;
-	auto get_emission_maps() const noexcept -> std::vector<Texture2D>;
+	// References, copying textures touches ResourceManager which isn't safe off render thread.
+	auto get_diffuse_maps() const noexcept -> const std::vector<Texture2D>&;
+	auto get_specular_maps() const noexcept -> const std::vector<Texture2D>&;
+	auto get_emission_maps() const noexcept -> const std::vector<Texture2D>&;
 	auto get_shininess() const noexcept -> float;
 
 private:
@@ -72,10 +76,41 @@ struct BufferData {
 	std::vector<unsigned int> indicies = {};
 };
 
+// Meshes up to this many triangles keep CPU copy of their geometry for software occlusion culling.
+inline constexpr std::size_t g_occluder_max_triangles = 4096;
+
+struct OccluderGeometry {
+	std::vector<glm::vec3> positions = {};
+	std::vector<unsigned int> indicies = {};
+};
+
+// Geometry owned elsewhere, e.g. memory mapped cooked asset. Buffers are filled straight from it.
+struct MeshView {
+	std::span<const glm::vec3> positions{};
+	std::span<const glm::vec2> UVs{};
+	std::span<const glm::vec3> normals{};
+	std::span<const unsigned int> indicies{};
+	AABB aabb{};
+};
+
+// Filled buffers without vertex array, created by Mesh::upload_buffers() on any thread with current context.
+struct MeshBuffers {
+	GLuint VBO_pos = EMPTY_VBO;
+	GLuint VBO_UVs = EMPTY_VBO;
+	GLuint VBO_normals = EMPTY_VBO;
+	GLuint EBO = EMPTY_VBO;
+};
+
 class Mesh {
 public:
 	Mesh() = default;
 	Mesh(const BufferData& a_data, const MaterialMap& a_mat, bool a_wireframe = false);
+	// Takes ownership of a_buffers uploaded from a_data, only vertex array is created.
+	Mesh(const BufferData& a_data, const MeshBuffers& a_buffers, const MaterialMap& a_mat, bool a_wireframe = false);
+	Mesh(const MeshView& a_view, const MaterialMap& a_mat, bool a_wireframe = false);
+
+	// Doesn't touch ResourceManager, so it can run on upload thread.
+	static auto upload_buffers(const BufferData& a_data) -> MeshBuffers;
 
 	auto draw() const -> void;
 	auto draw_instances(int a_instances_siz) const -> void;
@@ -91,18 +126,29 @@ public:
 	auto set_visibility(bool a_option) noexcept -> void;
 
 	auto get_VAO() const noexcept -> GLuint;
+	auto get_handle() const noexcept -> ResourceHandle;
+	auto get_aabb() const noexcept -> const AABB&;
+	auto get_occluder() const noexcept -> const std::shared_ptr<const OccluderGeometry>&;
+	auto get_triangle_count() const noexcept -> std::size_t;
+	// Number of indicies for indexed meshes, verticies otherwise.
+	auto get_element_count() const noexcept -> int;
+	auto is_indexed() const noexcept -> bool;
 	auto get_draw_mode() const noexcept -> BufferDrawType;
 	auto get_wireframe() const noexcept -> bool;
 	auto get_visibility() const noexcept -> bool;
 	auto get_material_map() noexcept -> MaterialMap&;
 
 private:
+	auto set_occluder(std::span<const glm::vec3> a_positions, std::span<const unsigned int> a_indicies) -> void;
+
 	bool m_wireframe = false;
 	bool m_visibility = true;
 	int m_verticies_sum{};
 	int m_indicies_sum{};
 	MaterialMap m_material_map{};
 	BufferObjects m_VBOs{};
+	AABB m_aabb{};
+	std::shared_ptr<const OccluderGeometry> m_occluder{};
 	BufferDataType m_type = BufferDataType::NONE;
 	BufferDrawType m_draw_mode = BufferDrawType::TRIANGLES;
 };
@@ -3,25 +3,68 @@
 #include <assimp/scene.h>
 
 #include <vector>
+#include <memory>
 
 #include "chill_renderer/meshes.hpp"
 #include "chill_renderer/shaders.hpp"
+#include "chill_renderer/transform_batch.hpp"
 
 namespace chill_renderer { 
-inline constexpr int g_attrib_model_mat_arr_location = 4;
-inline constexpr int g_attrib_normal_mat_arr_location = 8;
+// Instanced shaders read compact transforms from storage buffer through index of visible instance.
+inline constexpr int g_attrib_instance_idx_location = 4;
+inline constexpr int g_instance_transforms_binding = 0;
+inline constexpr int g_instance_motions_binding = 1;
+inline constexpr GLuint g_instance_motion_group_siz = 64; // local_size_x of instance_motion.comp
+// Culling spheres of animated instances bound motion over this many seconds, then they're rebuilt.
+inline constexpr float g_motion_sphere_window = 0.5f;
+// Instance buffers grow geometrically starting from this many instances.
+inline constexpr std::size_t g_instance_min_capacity = 64;
+// Dirty ranges this close are uploaded as one copy.
+inline constexpr std::size_t g_instance_merge_gap = 8;
+
+class CookedAsset;
 
 enum class Axis {
 	X, Y, Z
 };
 
+// CPU side of model file. Model::import_file() doesn't touch OpenGL, so it can run on worker threads,
+// Model::build() creates GL resources from it on render thread.
+struct TextureImport {
+	TextureType type{ TextureType::NONE };
+	int unit_id{};
+	std::wstring path{};
+};
+
+struct MeshImport {
+	BufferData data{};
+	std::size_t material_idx{}; // Meshes of same material share its textures.
+};
+
+struct ModelImport {
+	auto get_byte_size() const noexcept -> std::size_t;
+
+	std::wstring path{};
+	bool flip_UVs = false;
+	bool gamma_corr = false;
+	std::vector<std::vector<TextureImport>> materials{};
+	std::vector<MeshImport> meshes{};
+};
+
 class Model {
 public:
 	Model() = default;
 	Model(const std::wstring& a_path, bool a_flip_UVs = false, bool a_gamma_corr = false);
 	Model(const std::vector<Mesh>& a_meshes);
 
+	static auto import_file(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) -> ModelImport;
+
 	auto load_model(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) -> void;
+	// With a_async_textures textures show placeholders until ResourceManager uploads them.
+	// Meshes take ownership of a_buffers already uploaded for them, by index, meshes without ones upload here.
+	auto build(const ModelImport& a_import, bool a_async_textures = false, const std::vector<MeshBuffers>& a_buffers = {}) -> void;
+	// Meshes and compressed textures are uploaded straight from mapped asset, UVs were flipped when it was cooked.
+	auto build(const CookedAsset& a_asset, bool a_gamma_corr) -> void;
 	auto set_pos(const glm::vec3& a_pos) noexcept -> void;
 	auto set_size(float a_size) noexcept -> void;
 	auto set_size(const glm::vec3& a_size) noexcept -> void;
@@ -48,6 +91,9 @@ public:
 	auto get_model_mat() const noexcept -> glm::mat4;
 	auto get_normal_mat() const noexcept -> glm::mat3;
 	auto get_normal_view_mat(const glm::mat4& a_view_mat) const noexcept -> glm::mat3;
+	auto get_aabb() const noexcept -> const AABB&;
+	auto get_world_aabb() const noexcept -> const AABB&;
+	auto get_world_sphere() const noexcept -> const BoundingSphere&;
 	auto get_outline_thickness() const noexcept -> float;
 	auto get_outline_color() const noexcept -> glm::vec3;
 	auto is_outlined() const noexcept -> bool;
@@ -55,9 +101,12 @@ public:
 	auto is_gamma_corr() const noexcept -> bool;
 
 private:
-	auto process_node(aiNode* a_node, const aiScene* a_scene) -> void;
-	auto process_mesh(aiMesh* a_mesh, const aiScene* a_scene) -> Mesh;
-	auto process_texture(std::vector<Texture2D>& a_textures, aiMaterial* a_mat, aiTextureType a_ai_texture_type) -> void;
+	static auto process_node(aiNode* a_node, const aiScene* a_scene, ModelImport& a_import) -> void;
+	static auto process_mesh(aiMesh* a_mesh) -> MeshImport;
+	static auto process_material(aiMaterial* a_mat, const std::wstring& a_dir) -> std::vector<TextureImport>;
+	static auto process_texture(std::vector<TextureImport>& a_textures, aiMaterial* a_mat, aiTextureType a_ai_texture_type, const std::wstring& a_dir) -> void;
+	auto update_bounds() noexcept -> void;
+	auto update_world_bounds() noexcept -> void;
 
 	bool m_flipped_UVs = false;
 	bool m_gamma_corr = false;
@@ -68,6 +117,9 @@ private:
 	glm::mat4 m_transform_scale = 1.0f;
 	glm::mat4 m_transform_rotation = 1.0f;
 	std::vector<Mesh> m_meshes;
+	AABB m_aabb{};
+	AABB m_world_aabb{};
+	BoundingSphere m_world_sphere{};
 	std::wstring m_path = L"";
 	std::wstring m_dir = L"";
 	std::wstring m_filename = L"";
@@ -79,6 +131,18 @@ private:
 	} m_outline;
 }; 
 
+// Orbit around common center evaluated on GPU every frame. Layout matches std430 struct in instance_motion.comp.
+struct InstanceMotion {
+	float radius{};
+	float phase{};         // Radians, also offsets tumble angle.
+	float angular_speed{}; // Radians per second.
+	float height{};
+	glm::vec3 tumble_axis = glm::vec3(0.0f, 1.0f, 0.0f);
+	float tumble_speed{};  // Radians per second.
+	glm::vec3 size = glm::vec3(1.0f);
+	float padding{};
+};
+
 enum class ModelInstancedVecs {
 	POSITIONS,
 	ROTATIONS,
@@ -87,7 +151,7 @@ enum class ModelInstancedVecs {
 
 class ModelInstanced {
 public:
-	using InstVecsMap = std::map<ModelInstancedVecs, std::vector<glm::vec3>>;
+	using InstVecsMap = std::map<ModelInstancedVecs, Vec3Array>;
 
 	ModelInstanced() = default;
 	ModelInstanced(const Model& a_model);
@@ -113,31 +177,60 @@ public:
 	auto insert_rotation(std::size_t idx, const glm::vec3& a_rotation) -> bool;
 	auto insert_size(std::size_t idx, const glm::vec3& a_size) -> bool; 
 	auto populate_model_mat_buffer() -> void;
-	auto populate_normal_mat_buffer() -> void;
+	// Takes transforms composed elsewhere, e.g. on update thread. Position vectors are left as they were.
+	auto set_transforms(const std::vector<InstanceTransform>& a_transforms, const SphereBatch& a_spheres) -> void;
+	// Uploads instances changed since last flush. Called by cull() and draw().
+	auto flush_dirty() -> void;
+	// Switches to GPU animated instances, parameters are uploaded once. populate_model_mat_buffer() switches back.
+	auto set_motions(const std::vector<InstanceMotion>& a_motions, const glm::vec3& a_orbit_center) -> void;
+	// Writes transforms of animated instances for a_time seconds with compute shader built from instance_motion.comp.
+	auto animate(ShaderProgram& a_motion_shader, float a_time) -> void;
+	// Tests instance bounding spheres against frustum and compacts survivors into buffer used by draw().
+	auto cull(const Frustum& a_frustum) -> std::size_t;
 
 	auto get_model_base() noexcept -> Model&;
-	auto get_positions() noexcept -> std::vector<glm::vec3>&;
-	auto get_rotations() noexcept -> std::vector<glm::vec3>&;
-	auto get_size() noexcept -> std::vector<glm::vec3>&;
+	auto get_positions() noexcept -> Vec3Array&;
+	auto get_rotations() noexcept -> Vec3Array&;
+	auto get_size() noexcept -> Vec3Array&;
+	auto get_instance_count() const noexcept -> std::size_t;
+	auto get_visible_count() const noexcept -> std::size_t;
+	auto get_instance_capacity() const noexcept -> std::size_t;
+	auto is_animated() const noexcept -> bool;
 
 private:
-	auto calculate_model_mat(std::size_t idx) noexcept -> glm::mat4;
-	auto calculate_normal_mat(std::size_t idx) noexcept -> glm::mat3;
 	auto calculate_model_mats() noexcept -> void;
-	auto calculate_normal_mats() noexcept -> void;
-	auto create_model_instanced_arr(const std::vector<glm::mat4>& a_model_mats) -> void;
-	auto create_normal_instanced_arr(const std::vector<glm::mat3>& a_normal_mats) -> void;
+	auto reserve_instance_buffers(std::size_t a_siz) -> void;
+	auto create_instance_buffer(GLuint& a_buf_id, ResourceHandle& a_handle, GLenum a_target, std::size_t a_siz) -> void;
+	auto setup_instance_attrib() -> void;
+	auto reset_visible() -> void;
+	auto mark_dirty(std::size_t a_begin, std::size_t a_end) -> void;
+	auto update_motion_spheres(float a_time) -> void;
+	auto release_buffer(GLuint& a_buf_id, ResourceHandle& a_handle) noexcept -> void;
 
 	Model m_model_base{};
 	int m_instances_siz{};
-	GLuint m_model_mat_buf_id = EMPTY_VBO;
-	GLuint m_normal_mat_buf_id = EMPTY_VBO;
+	std::size_t m_visible_siz{};
+	std::size_t m_instance_capacity{};
+	GLuint m_transform_buf_id = EMPTY_VBO;
+	GLuint m_visible_buf_id = EMPTY_VBO;
+	GLuint m_motion_buf_id = EMPTY_VBO;
+	ResourceHandle m_transform_buf_handle{};
+	ResourceHandle m_visible_buf_handle{};
+	ResourceHandle m_motion_buf_handle{};
+	bool m_animated = false;
+	glm::vec3 m_orbit_center = glm::vec3(0.0f);
+	float m_sphere_window = -1.0f; // Start of time window bounded by spheres of animated instances.
+	std::vector<InstanceMotion> m_motions{};
 	InstVecsMap m_instanced_vecs{
-		{ ModelInstancedVecs::POSITIONS, std::vector<glm::vec3>{} },
-		{ ModelInstancedVecs::ROTATIONS, std::vector<glm::vec3>{} },
-		{ ModelInstancedVecs::SIZES, std::vector<glm::vec3>{} },
+		{ ModelInstancedVecs::POSITIONS, Vec3Array{} },
+		{ ModelInstancedVecs::ROTATIONS, Vec3Array{} },
+		{ ModelInstancedVecs::SIZES, Vec3Array{} },
 	}; 
-	std::vector<glm::mat4> m_model_mats{};
-	std::vector<glm::mat3> m_normal_mats{};
+	std::vector<InstanceTransform> m_transforms{};
+	std::vector<GLuint> m_visible_idx{};
+	std::vector<std::uint8_t> m_cull_flags{};
+	SphereBatch m_instance_spheres{};
+	std::vector<std::pair<std::size_t, std::size_t>> m_dirty_ranges{};
+	std::shared_ptr<StreamBuffer> m_stream_buf{}; // Shared by copies, same as instance buffers.
 };
 }
\ No newline at end of file
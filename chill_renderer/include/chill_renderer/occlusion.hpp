@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "chill_renderer/bounds.hpp"
+
+namespace chill_renderer {
+inline constexpr int g_occlusion_tile_siz = 8;
+
+// Low resolution software depth buffer. Occluder triangles are rasterized 4 pixels at a time, then every
+// 8x8 tile keeps its farthest depth so most box tests are answered without touching pixels (hierarchical Z).
+// Depth is NDC z remapped to [0, 1], cleared to far plane.
+class OcclusionBuffer {
+public:
+	OcclusionBuffer(int a_width = 256, int a_height = 128);
+
+	auto resize(int a_width, int a_height) -> void;
+	auto clear() -> void;
+	auto set_view_proj(const glm::mat4& a_view_proj) noexcept -> void;
+	// Transforms and stores triangles, rasterization is deferred to rasterize().
+	auto add_occluder(const glm::mat4& a_model_mat, const std::vector<glm::vec3>& a_positions, const std::vector<unsigned int>& a_indicies) -> void;
+	auto rasterize() -> void;
+	// Returns false only when box is certainly hidden behind occluders.
+	auto test_aabb(const AABB& a_aabb) const -> bool;
+
+	auto get_width() const noexcept -> int;
+	auto get_height() const noexcept -> int;
+	auto get_triangle_count() const noexcept -> std::size_t;
+	auto get_depth() const noexcept -> const std::vector<float>&;
+
+private:
+	struct Triangle {
+		glm::vec3 v0; // x, y in pixels, z depth
+		glm::vec3 v1;
+		glm::vec3 v2;
+	};
+
+	auto rasterize_rows(int a_row_begin, int a_row_end) -> void;
+
+	int m_width{};
+	int m_height{};
+	int m_tiles_x{};
+	int m_tiles_y{};
+	glm::mat4 m_view_proj = glm::mat4(1.0f);
+	std::vector<Triangle> m_triangles{};
+	std::vector<float> m_depth{};
+	std::vector<float> m_tile_max_depth{};
+};
+}
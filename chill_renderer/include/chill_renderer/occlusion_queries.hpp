@@ -0,0 +1,49 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <vector>
+
+namespace chill_renderer {
+// Frames an object found visible by its last query is drawn without being queried again.
+inline constexpr int g_query_visible_frames = 8;
+
+// One GPU occlusion query per object. Draws are made conditional on result of the query issued in
+// previous frame with GL_QUERY_NO_WAIT, so pending results never stall and unknown means visible.
+// Finished results are polled without waiting to skip re-querying objects known to be visible.
+class OcclusionQueries {
+public:
+	OcclusionQueries() = default;
+	OcclusionQueries(const OcclusionQueries& a_queries) = delete;
+	OcclusionQueries(OcclusionQueries&& a_queries) noexcept;
+	~OcclusionQueries();
+
+	auto operator=(const OcclusionQueries& a_queries) -> OcclusionQueries& = delete;
+	auto operator=(OcclusionQueries&& a_queries) noexcept -> OcclusionQueries&;
+
+	// Resets all queries when object count changed, then polls available results.
+	auto begin_frame(std::size_t a_siz) -> void;
+	// Forget last result, e.g. object was culled or camera is inside of its box.
+	auto invalidate(std::size_t a_idx) noexcept -> void;
+	auto needs_query(std::size_t a_idx) const noexcept -> bool;
+	auto begin_query(std::size_t a_idx) -> void;
+	auto end_query() -> void;
+	auto begin_conditional(std::size_t a_idx) -> void;
+	auto end_conditional() -> void;
+
+	auto get_size() const noexcept -> std::size_t;
+
+private:
+	struct Query {
+		GLuint id{};
+		bool issued = false;	// Holds result of previous frame usable for conditional render.
+		bool pending = false;	// Result not read back yet.
+		int visible_frames{};
+	};
+
+	auto release() noexcept -> void;
+
+	bool m_conditional = false;
+	std::vector<Query> m_queries{};
+};
+}
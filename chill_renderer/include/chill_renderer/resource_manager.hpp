@@ -1,12 +1,28 @@
 #pragma once
 
 #include <map>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <variant>
+#include <unordered_map>
 
 #include "chill_renderer/model.hpp"
 #include "chill_renderer/buffers.hpp"
 #include "chill_renderer/shaders.hpp"
+#include "chill_renderer/handle_pool.hpp"
+#include "chill_renderer/gl_objects.hpp"
+#include "chill_renderer/cooked_asset.hpp"
 
 namespace chill_renderer {
+// Finished async loads are uploaded until one of these is spent, at least one per frame.
+inline constexpr std::size_t g_upload_byte_budget = 16 * 1024 * 1024;
+inline constexpr double g_upload_ms_budget = 2.0;
+// Textures loaded asynchronously show this grey until their image is uploaded.
+inline constexpr unsigned char g_placeholder_texel = 128;
+// Unreferenced cached models and textures are evicted once GPU memory of live resources exceeds this.
+inline constexpr std::size_t g_vram_budget = 1024ull * 1024 * 1024;
+
 enum class ResourceType {
 	TEXTURES,
 	SHADER_SRCS,
@@ -16,33 +32,127 @@ enum class ResourceType {
 	UNIFORM_BUFFERS,
 	MESHES,
 	INSTANCED_ARRAYS,
+	COUNT,
+};
+
+struct MemoryStats {
+	std::size_t current{};
+	std::size_t peak{};
+	std::size_t budget{};
+	std::array<std::size_t, static_cast<std::size_t>(ResourceType::COUNT)> per_type{};
 };
 
 class ResourceManager {
 public:
 	static auto dialog_import_model() -> std::wstring;
 
-	auto inc_ref_count(ResourceType a_res_type, GLuint a_id) noexcept -> void;
-	auto dec_ref_count(ResourceType a_res_type, GLuint a_id) noexcept -> void;
-	auto chk_ref_count(ResourceType a_res_type, GLuint a_id) -> bool;
+	// Registers freshly created GL object, returned handle holds its first reference.
+	auto new_handle(ResourceType a_res_type, GLuint a_id) -> ResourceHandle;
+	auto inc_ref_count(ResourceType a_res_type, ResourceHandle a_handle) noexcept -> void;
+	// Returns references left, pass them to chk_ref_count() so only one owner releases handle.
+	auto dec_ref_count(ResourceType a_res_type, ResourceHandle a_handle) noexcept -> int;
+	auto chk_ref_count(ResourceType a_res_type, ResourceHandle a_handle, int a_ref_count) -> bool;
+	// Bytes of GPU storage owned by resource, replaces value tracked before.
+	auto track_memory(ResourceType a_res_type, ResourceHandle a_handle, std::size_t a_bytes) noexcept -> void;
+	auto set_memory_budget(std::size_t a_bytes) noexcept -> void;
+	auto get_memory_stats() const noexcept -> MemoryStats;
 
 	auto new_shader(const ShaderSrc& a_vertex_shader, const ShaderSrc& a_fragment_shader, const ShaderSrc& a_geometry_shader = ShaderSrc{}) -> ShaderProgram;
+	auto new_shader(const ShaderSrc& a_compute_shader) -> ShaderProgram;
 
+	// Cooked files (see chill_cook) are mapped instead of imported, a_flip_UVs was applied when cooking them.
 	auto load_model(const std::wstring& a_dir, bool a_flip_UVs, bool a_gamma_corr) -> Model;
+	// File read and Assimp import run on job system, GL buffers are created by process_uploads().
+	// Cooked files are only mapped there and uploaded from mapping.
+	auto load_model_async(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) -> std::shared_future<Model>;
 	auto create_model(const std::vector<Mesh>& a_meshes) -> Model;
 
 	auto load_texture(TextureType a_type, const std::wstring& a_path, bool a_flip_image, bool a_gamma_corr) -> Texture2D;
+	// Returned texture shows placeholder until its image is decoded on job system and uploaded by process_uploads().
+	// Image already in memory, e.g. in cooked asset. Texture cached under same path is reused without touching image.
+	auto load_texture(TextureType a_type, const std::wstring& a_path, bool a_gamma_corr, const CompressedImage& a_image) -> Texture2D;
+	auto load_texture_async(TextureType a_type, const std::wstring& a_path, bool a_flip_image, bool a_gamma_corr) -> Texture2D;
 	auto load_cubemap(TextureType a_type, const std::vector<std::wstring>& a_paths, bool a_flip_images, bool a_gamma_corr) -> TextureCubemap;
+	// Faces are decoded on job system and streamed by process_uploads(), returned cubemap shows placeholder until then.
+	auto load_cubemap_async(TextureType a_type, const std::vector<std::wstring>& a_paths, bool a_flip_images, bool a_gamma_corr) -> TextureCubemap;
 
 	auto create_render_buffer(int a_width, int a_height, RenderBufferType a_type) -> RenderBuffer;
 
+	// Call once per frame on render thread. Decoded images are streamed into textures a few rows at a time,
+	// unless upload thread is started, then loads are uploaded there and only published here.
+	// Evicts least recently used cached resources when over memory budget and deletes released GL objects GPU is done with.
+	auto process_uploads(std::size_t a_byte_budget = g_upload_byte_budget, double a_ms_budget = g_upload_ms_budget) -> void;
+	auto get_pending_loads() const noexcept -> std::size_t;
+
+	// PNG/JPG textures loaded afterwards are block compressed and cached on disk, see load_texture_image().
+	auto set_texture_compression(bool a_compress) noexcept -> void;
+	auto is_compressing_textures() const noexcept -> bool;
+
 	auto debug(ResourceType a_type) -> void;
+	// Pooled names and deferred deletion of GL objects, render thread only.
+	auto get_gl_objects() noexcept -> GLObjects&;
 
 private:
-	std::map<GLuint, std::unique_ptr<ShaderProgram>> m_shaders_cached;
-	std::map<GLuint, std::unique_ptr<Texture2D>> m_textures_cached;
-	std::map<std::wstring, std::unique_ptr<Model>> m_models_cached;
+	// Produced by worker threads, holds no GL objects.
+	struct LoadResult {
+		std::uint64_t id{};
+		std::uint64_t content_hash{}; // Hash of decoded or compressed image, zero for models.
+		std::variant<ImageData, CompressedImage, ModelImport, std::shared_ptr<const CookedAsset>> data{};
+		std::exception_ptr error{};
+	};
+
+	struct PendingModel {
+		std::uint64_t key{};
+		bool flip_UVs = false;
+		bool gamma_corr = false;
+		std::promise<Model> promise{};
+		std::shared_future<Model> future{};
+	};
+
+	auto get_pool(ResourceType a_res_type) noexcept -> HandlePool&;
+	auto get_memory_usage() const noexcept -> std::size_t;
+	auto update_residency() -> void;
+	auto find_cached_texture(std::unordered_map<std::uint64_t, ResourceHandle>& a_index, std::uint64_t a_key) -> Texture2D*;
+	auto find_cached_shader(std::uint64_t a_key) -> ShaderProgram*;
+	auto cache_texture(const Texture2D& a_texture, std::uint64_t a_key) -> Texture2D&;
+	auto cache_model(std::uint64_t a_key, std::unique_ptr<Model> a_model) -> Model&;
+	// Copies of cached model alive outside of cache. Every copy holds all its meshes, so first one counts them.
+	auto get_model_ref_count(Model& a_model) noexcept -> int;
+	// Unlinks model from caches and reverse index, then destroys it.
+	auto evict_model(std::uint64_t a_key) -> void;
+	auto cached_texture_copy(const Texture2D& a_texture, TextureType a_type) -> Texture2D;
+	auto push_result(LoadResult&& a_result) -> void;
+	auto submit_image_load(std::uint64_t a_id, const std::wstring& a_path, bool a_flip_image) -> void;
+	auto finish_load(LoadResult& a_result) -> std::size_t;
+	auto publish_model(PendingModel& a_pending, const ModelImport& a_import, const std::vector<MeshBuffers>& a_buffers) -> void;
+
+	// First, so cached resources released by later members still find their handles.
+	std::array<HandlePool, static_cast<std::size_t>(ResourceType::COUNT)> m_handle_pools;
+	GLObjects m_gl_objects;
+
+	std::uint64_t m_next_load_id = 1;
+	std::map<std::uint64_t, Texture2D> m_pending_textures;
+	std::map<std::uint64_t, PendingModel> m_pending_models;
+	std::map<std::uint64_t, std::pair<TextureCubemap, int>> m_pending_faces;
+	TextureStreamer m_texture_streamer;
+	std::mutex m_results_mutex;
+	std::deque<LoadResult> m_results;
+
+	std::unordered_map<GLuint, std::unique_ptr<ShaderProgram>> m_shaders_cached;
+	std::unordered_map<GLuint, std::unique_ptr<Texture2D>> m_textures_cached;
+	std::unordered_map<std::uint64_t, std::unique_ptr<Model>> m_models_cached;
+	// Mesh VAO to key of cached model owning it, so releasing mesh finds its model without scanning the cache.
+	std::unordered_map<GLuint, std::uint64_t> m_mesh_owners;
+	// Keyed by hash of canonical paths and load flags. Handles tell apart released entries whose GL id was reused.
+	std::unordered_map<std::uint64_t, ResourceHandle> m_shader_index;
+	std::unordered_map<std::uint64_t, ResourceHandle> m_texture_index;
+	// Keyed by hash of decoded pixels, same image under different paths shares one texture.
+	std::unordered_map<std::uint64_t, ResourceHandle> m_texture_contents;
 
-	std::map<ResourceType, std::map<GLuint, int>> m_ref_counter;
+	// Residency, last used frames are stored in handle slots.
+	std::uint64_t m_frame{};
+	std::size_t m_memory_budget = g_vram_budget;
+	std::size_t m_memory_peak{};
+	bool m_compress_textures = false;
 }; 
 }
\ No newline at end of file
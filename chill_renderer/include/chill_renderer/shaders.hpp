@@ -5,6 +5,7 @@
 #include <type_traits>
 
 #include <map>
+#include <array>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,7 @@ enum class ShaderType {
 	VERTEX,
 	FRAGMENT,
 	GEOMETRY,
+	COMPUTE,
 	NONE,
 };
 
@@ -35,6 +37,7 @@ public:
 	Uniform(const std::string& a_name, int a_location, GLuint a_program);
 
 	auto get_name() const noexcept -> std::string;
+	auto get_location() const noexcept -> int;
 
 	template<typename T>
 	auto operator=(const T& val) -> Uniform&;
@@ -45,6 +48,14 @@ private:
 	std::string m_name = "";
 };
 
+// Locations of material struct members, -1 for ones shader doesn't use. Sampler arrays are as big as in shaders.
+struct MaterialLocations {
+	int shininess = -1;
+	std::array<int, g_diffuse_sampler_siz> diffuse_maps{};
+	std::array<int, g_specular_sampler_siz> specular_maps{};
+	std::array<int, g_emission_sampler_siz> emission_maps{};
+};
+
 class ShaderSrc {
 public:
 	ShaderSrc() = default;
@@ -64,12 +75,14 @@ private:
 	ShaderType m_type = ShaderType::NONE;
 	std::wstring m_path = L"";
 	GLuint m_id = EMPTY_VBO;
+	ResourceHandle m_handle{};
 };
 
 class ShaderProgram {
 public:
 	ShaderProgram() = default;
 	ShaderProgram(const ShaderSrc& a_vertex_shader, const ShaderSrc& a_fragment_shader, const ShaderSrc& a_geometry_shader = ShaderSrc{});
+	ShaderProgram(const ShaderSrc& a_compute_shader);
 	ShaderProgram(const ShaderProgram& a_shader_program);
 	ShaderProgram(ShaderProgram&& a_shader_program) noexcept;
 	~ShaderProgram();
@@ -84,12 +97,18 @@ public:
 	auto set_uniform(const std::string& a_spotlight_name, const SpotLight& a_light) -> void;
 	auto set_uniform(const std::string& a_material_name, const MaterialMap& a_material) -> void;
 	auto set_binding_point(const std::string& a_uniform_block_name, int a_binding_point) noexcept -> void;
+	// Resolved once on render thread, so material uniforms can be recorded into CommandBuffer without GL.
+	auto get_material_locations(const std::string& a_material_name) const -> MaterialLocations;
 	auto use() -> void;
+	// Caller issues memory barrier matching how results are read.
+	auto dispatch(GLuint a_groups_x, GLuint a_groups_y = 1, GLuint a_groups_z = 1) -> void;
 
 	auto get_id() const noexcept -> GLuint;
+	auto get_handle() const noexcept -> ResourceHandle;
 	auto get_vert_shader() const noexcept -> ShaderSrc;
 	auto get_frag_shader() const noexcept -> ShaderSrc;
 	auto get_geom_shader() const noexcept -> ShaderSrc;
+	auto get_comp_shader() const noexcept -> ShaderSrc;
 	auto is_state(ShaderState a_state) const noexcept -> bool;
 
 private:
@@ -100,9 +119,11 @@ private:
 	auto push_uniform_struct(const std::string& a_uniform_var, const Container& a_mamber_list) -> void;
 
 	GLuint m_id = EMPTY_VBO;
+	ResourceHandle m_handle{};
 	ShaderSrc m_vertex_sh = ShaderSrc{};
 	ShaderSrc m_fragment_sh = ShaderSrc{};
 	ShaderSrc m_geometry_sh = ShaderSrc{};
+	ShaderSrc m_compute_sh = ShaderSrc{};
 	std::map<std::string, Uniform> m_uniforms;
 	std::map<ShaderState, bool> m_states{
 		{ ShaderState::DEPTH_TEST,   true },
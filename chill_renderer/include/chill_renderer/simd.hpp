@@ -0,0 +1,22 @@
+#pragma once
+
+// x86-64 always has SSE2, 32-bit MSVC builds report it through _M_IX86_FP.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CHILL_SIMD_SSE 1
+	#include <immintrin.h>
+#endif
+
+// Enabled with CHILL_RENDERER_AVX cmake option.
+#if defined(CHILL_SIMD_SSE) && defined(__AVX__)
+	#define CHILL_SIMD_AVX 1
+#endif
+
+namespace chill_renderer {
+#if defined(CHILL_SIMD_AVX)
+inline constexpr int g_simd_width = 8;
+#elif defined(CHILL_SIMD_SSE)
+inline constexpr int g_simd_width = 4;
+#else
+inline constexpr int g_simd_width = 1;
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <variant>
+
+#include "chill_renderer/buffers.hpp"
+
+namespace chill_renderer {
+// Block compressed copies of PNG/JPG sources are cached here, relative to working directory.
+inline constexpr const wchar_t* g_texture_cache_dir = L"cache/textures";
+// Rows of 4x4 blocks encoded by single job.
+inline constexpr std::size_t g_bc_rows_per_job = 16;
+// Largest side of block compressed image read from file.
+inline constexpr int g_max_block_image_siz = 16384;
+
+using TextureImage = std::variant<ImageData, CompressedImage>;
+
+// Fills level offsets and sizes of tightly packed mip chain, returns bytes of whole chain.
+auto set_block_levels(CompressedImage& a_image, int a_width, int a_height, int a_levels) -> std::size_t;
+// Sides in 1..g_max_block_image_siz and at most full mip chain, checked before set_block_levels() on file data.
+auto is_valid_block_levels(int a_width, int a_height, int a_levels) noexcept -> bool;
+// True for .dds and .ktx2 files.
+auto is_compressed_file(const std::wstring& a_path) -> bool;
+// 2D BC1, BC3, BC4, BC5 and BC7 images with their mips. Cubemaps are loaded face by face, supercompressed KTX2 isn't supported.
+auto load_compressed_image(const std::wstring& a_path, bool a_flip) -> CompressedImage;
+auto save_dds(const fs::path& a_path, const CompressedImage& a_image) -> void;
+// Encodes image and its box filtered mip chain. Single channel images become BC4, RGB(A) ones BC1 or BC3 if any texel
+// is translucent. Rows of blocks are spread over job system, so it can be called from jobs too.
+auto compress_image(const ImageData& a_image) -> CompressedImage;
+// Compressed files are loaded as they are. Other images are decoded, with a_compress they're block compressed
+// on first load and read back from g_texture_cache_dir as long as cached file is newer than its source.
+auto load_texture_image(const std::wstring& a_path, bool a_flip, bool a_compress) -> TextureImage;
+}
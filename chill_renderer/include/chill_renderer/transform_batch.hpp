@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+#include "chill_renderer/bounds.hpp"
+
+namespace chill_renderer {
+// Batches at least this big are composed on several threads.
+inline constexpr std::size_t g_transform_parallel_min = 16384;
+
+// Structure of arrays layout of vec3, SIMD code loads same component of several elements at once.
+struct Vec3Array {
+	auto push_back(const glm::vec3& a_vec) -> void;
+	auto assign(const std::vector<glm::vec3>& a_vecs) -> void;
+	auto resize(std::size_t a_siz, const glm::vec3& a_value) -> void;
+	auto clear() noexcept -> void;
+	auto set(std::size_t a_idx, const glm::vec3& a_vec) noexcept -> void;
+	auto get(std::size_t a_idx) const noexcept -> glm::vec3;
+	auto size() const noexcept -> std::size_t;
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+};
+
+// Compact instance transform, 32 bytes instead of model and normal matrix. Layout matches std430
+// struct in instanced shaders, which rebuild translate * rotate * scale from it.
+struct InstanceTransform {
+	glm::vec3 position{};
+	std::uint32_t rotation_xy{}; // Quaternion components packed as snorm16 pairs.
+	glm::vec3 scale = glm::vec3(1.0f);
+	std::uint32_t rotation_zw{ 0x7fff0000 };
+};
+static_assert(sizeof(InstanceTransform) == 32);
+
+// For every element writes compact form of translate * rotate_x * rotate_y * rotate_z * scale (rotations in degrees)
+// and world sphere of a_local_sphere. Arrays must have equal sizes, a_transforms is sized by caller.
+auto compose_transforms(const Vec3Array& a_positions, const Vec3Array& a_rotations, const Vec3Array& a_sizes, const BoundingSphere& a_local_sphere,
+	InstanceTransform* a_transforms, SphereBatch& a_spheres) -> void;
+// Compact form of translate * rotate * scale matrix with positive scale.
+auto to_instance_transform(const glm::mat4& a_model_mat) -> InstanceTransform;
+// Same as compose_transforms for single element, a_spheres has to be already sized.
+auto compose_transform(const Vec3Array& a_positions, const Vec3Array& a_rotations, const Vec3Array& a_sizes, const BoundingSphere& a_local_sphere,
+	std::size_t a_idx, InstanceTransform* a_transforms, SphereBatch& a_spheres) -> void;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace chill_renderer {
+// Lock free mailbox between one writer and one reader thread. Writer fills its slot and publishes it,
+// reader takes the latest published slot. Neither waits for the other, stale values are skipped.
+template<typename T>
+class TripleBuffer {
+public:
+	TripleBuffer() = default;
+	TripleBuffer(const TripleBuffer& a_buf) = delete;
+
+	auto operator=(const TripleBuffer& a_buf) -> TripleBuffer& = delete;
+
+	// Writer side, slot keeps its old contents, so containers can be reused without allocations.
+	auto get_write() noexcept -> T&;
+	auto publish() noexcept -> void;
+	// Reader side, returns true if newer value was published since last call.
+	auto consume() noexcept -> bool;
+	auto get_read() const noexcept -> const T&;
+
+private:
+	// Index of shared slot in low bits, set fresh bit means reader hasn't taken it yet.
+	static constexpr std::uint8_t s_fresh_bit = 4;
+	static constexpr std::uint8_t s_idx_mask = 3;
+
+	std::array<T, 3> m_slots{};
+	std::uint8_t m_write_idx = 0;
+	std::uint8_t m_read_idx = 1;
+	std::atomic<std::uint8_t> m_shared{ 2 };
+};
+
+template<typename T>
+T& TripleBuffer<T>::get_write() noexcept {
+	return m_slots[m_write_idx];
+}
+
+template<typename T>
+void TripleBuffer<T>::publish() noexcept {
+	std::uint8_t prev = m_shared.exchange(m_write_idx | s_fresh_bit, std::memory_order_acq_rel);
+	m_write_idx = prev & s_idx_mask;
+}
+
+template<typename T>
+bool TripleBuffer<T>::consume() noexcept {
+	if (!(m_shared.load(std::memory_order_relaxed) & s_fresh_bit))
+		return false;
+
+	std::uint8_t prev = m_shared.exchange(m_read_idx, std::memory_order_acq_rel);
+	m_read_idx = prev & s_idx_mask;
+	return true;
+}
+
+template<typename T>
+const T& TripleBuffer<T>::get_read() const noexcept {
+	return m_slots[m_read_idx];
+}
+}
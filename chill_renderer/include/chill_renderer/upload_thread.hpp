@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace chill_renderer {
+// Dedicated thread with hidden context shared with render window. Every upload is followed by fence and
+// its publish callback runs on render thread from poll() once fence is signaled, so render thread never
+// waits for glBufferData or glTexImage2D. Vertex arrays aren't shared between contexts, publish creates them.
+class UploadThread {
+public:
+	using Task = std::function<void()>;
+
+	// Call on main thread, GLFW windows can't be created anywhere else.
+	UploadThread(GLFWwindow* a_share_window);
+	UploadThread(const UploadThread& a_uploader) = delete;
+	~UploadThread();
+
+	auto operator=(const UploadThread& a_uploader) -> UploadThread& = delete;
+
+	// a_upload runs on upload thread and must not create or destroy ref counted objects,
+	// a_publish runs on render thread after GPU finished a_upload.
+	auto submit(Task a_upload, Task a_publish) -> void;
+	// Call once per frame on render thread, never blocks. Returns number of published uploads.
+	auto poll() -> std::size_t;
+
+	auto get_pending() const noexcept -> std::size_t;
+
+private:
+	struct Upload {
+		Task upload{};
+		Task publish{};
+		GLsync fence{};
+	};
+
+	auto thread_loop(std::stop_token a_stop) -> void;
+
+	GLFWwindow* m_context = nullptr;
+	std::mutex m_mutex{};
+	std::condition_variable_any m_wake{};
+	std::deque<Upload> m_queued{};
+	std::deque<Upload> m_fenced{};
+	std::atomic<std::size_t> m_pending{};
+	std::jthread m_thread{};
+};
+}
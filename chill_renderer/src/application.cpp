@@ -21,7 +21,7 @@ void Application::shutdown() {
 }
 
 Application::Application(int win_width, int win_height, const std::string& win_title, CursorMode win_mode)
-	:m_win{ new Window(win_width, win_height, win_title, win_mode) }, m_rmanager{ new ResourceManager() } { }
+	:m_win{ new Window(win_width, win_height, win_title, win_mode) }, m_rmanager{ new ResourceManager() }, m_jobs{ new JobSystem() } { }
 
 Application::~Application() {
 	delete& get_instance();
@@ -34,4 +34,17 @@ Window& Application::get_win() noexcept {
 ResourceManager& Application::get_rmanager() noexcept {
 	return *m_rmanager;
 } 
+
+JobSystem& Application::get_jobs() noexcept {
+	return *m_jobs;
+}
+
+void Application::start_upload_thread() {
+	if (!m_uploader)
+		m_uploader.reset(new UploadThread(m_win->get_obj()));
+}
+
+UploadThread* Application::get_uploader() noexcept {
+	return m_uploader.get();
+}
 }
\ No newline at end of file
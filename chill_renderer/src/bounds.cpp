@@ -0,0 +1,234 @@
+#include "chill_renderer/bounds.hpp"
+#include "chill_renderer/simd.hpp"
+
+#include <bit>
+#include <cmath>
+
+namespace chill_renderer {
+void AABB::expand(const glm::vec3& a_point) noexcept {
+	min = glm::min(min, a_point);
+	max = glm::max(max, a_point);
+}
+
+void AABB::expand(const AABB& a_aabb) noexcept {
+	if (!a_aabb.is_valid())
+		return;
+	min = glm::min(min, a_aabb.min);
+	max = glm::max(max, a_aabb.max);
+}
+
+// Transform center and project extents onto new axes (Arvo), cheaper than transforming 8 corners.
+AABB AABB::transform(const glm::mat4& a_mat) const noexcept {
+	if (!is_valid())
+		return AABB();
+
+	glm::vec3 center = glm::vec3(a_mat * glm::vec4(get_center(), 1.0f));
+	glm::vec3 extent = get_extent();
+	glm::vec3 new_extent{};
+	for (int i = 0; i < 3; ++i) {
+		new_extent[i] = std::abs(a_mat[0][i]) * extent.x + std::abs(a_mat[1][i]) * extent.y + std::abs(a_mat[2][i]) * extent.z;
+	}
+
+	AABB ret;
+	ret.min = center - new_extent;
+	ret.max = center + new_extent;
+	return ret;
+}
+
+bool AABB::contains(const AABB& a_aabb) const noexcept {
+	return min.x <= a_aabb.min.x && min.y <= a_aabb.min.y && min.z <= a_aabb.min.z &&
+		   max.x >= a_aabb.max.x && max.y >= a_aabb.max.y && max.z >= a_aabb.max.z;
+}
+
+// Slab test, a_inv_dir is 1/direction. a_dist is distance to entry point (0 when origin is inside).
+bool AABB::intersects_ray(const glm::vec3& a_origin, const glm::vec3& a_inv_dir, float a_max_dist, float& a_dist) const noexcept {
+	glm::vec3 t1 = (min - a_origin) * a_inv_dir;
+	glm::vec3 t2 = (max - a_origin) * a_inv_dir;
+	glm::vec3 tnear = glm::min(t1, t2);
+	glm::vec3 tfar = glm::max(t1, t2);
+	float tmin = glm::max(glm::max(tnear.x, tnear.y), glm::max(tnear.z, 0.f));
+	float tmax = glm::min(glm::min(tfar.x, tfar.y), glm::min(tfar.z, a_max_dist));
+	a_dist = tmin;
+	return tmin <= tmax;
+}
+
+bool AABB::is_valid() const noexcept {
+	return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+}
+
+glm::vec3 AABB::get_center() const noexcept {
+	return (min + max) * 0.5f;
+}
+
+glm::vec3 AABB::get_extent() const noexcept {
+	return (max - min) * 0.5f;
+}
+
+float AABB::get_surface_area() const noexcept {
+	glm::vec3 d = max - min;
+	return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+BoundingSphere::BoundingSphere(const glm::vec3& a_center, float a_radius)
+	:center{ a_center }, radius{ a_radius }
+{ }
+
+BoundingSphere::BoundingSphere(const AABB& a_aabb) {
+	if (a_aabb.is_valid()) {
+		center = a_aabb.get_center();
+		radius = glm::length(a_aabb.get_extent());
+	}
+}
+
+void SphereBatch::clear() noexcept {
+	x.clear();
+	y.clear();
+	z.clear();
+	r.clear();
+}
+
+void SphereBatch::reserve(std::size_t a_siz) {
+	x.reserve(a_siz);
+	y.reserve(a_siz);
+	z.reserve(a_siz);
+	r.reserve(a_siz);
+}
+
+void SphereBatch::push(const BoundingSphere& a_sphere) {
+	x.push_back(a_sphere.center.x);
+	y.push_back(a_sphere.center.y);
+	z.push_back(a_sphere.center.z);
+	r.push_back(a_sphere.radius);
+}
+
+std::size_t SphereBatch::size() const noexcept {
+	return r.size();
+}
+
+Frustum::Frustum(const glm::mat4& a_view_proj) {
+	set(a_view_proj);
+}
+
+// Gribb-Hartmann plane extraction. glm is column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+void Frustum::set(const glm::mat4& a_view_proj) noexcept {
+	auto row = [&a_view_proj](int i) {
+			return glm::vec4(a_view_proj[0][i], a_view_proj[1][i], a_view_proj[2][i], a_view_proj[3][i]);
+		};
+
+	m_planes[0] = row(3) + row(0);
+	m_planes[1] = row(3) - row(0);
+	m_planes[2] = row(3) + row(1);
+	m_planes[3] = row(3) - row(1);
+	m_planes[4] = row(3) + row(2);
+	m_planes[5] = row(3) - row(2);
+
+	for (auto& plane : m_planes) {
+		float len = glm::length(glm::vec3(plane));
+		if (len > 0.f)
+			plane /= len;
+	}
+}
+
+bool Frustum::intersects(const BoundingSphere& a_sphere) const noexcept {
+	for (const auto& plane : m_planes) {
+		if (glm::dot(glm::vec3(plane), a_sphere.center) + plane.w < -a_sphere.radius)
+			return false;
+	}
+	return true;
+}
+
+// Test only the box corner furthest along plane normal.
+bool Frustum::intersects(const AABB& a_aabb) const noexcept {
+	if (!a_aabb.is_valid())
+		return false;
+
+	for (const auto& plane : m_planes) {
+		glm::vec3 p_vertex{
+			(plane.x >= 0.f) ? a_aabb.max.x : a_aabb.min.x,
+			(plane.y >= 0.f) ? a_aabb.max.y : a_aabb.min.y,
+			(plane.z >= 0.f) ? a_aabb.max.z : a_aabb.min.z,
+		};
+		if (glm::dot(glm::vec3(plane), p_vertex) + plane.w < 0.f)
+			return false;
+	}
+	return true;
+}
+
+const std::array<glm::vec4, 6>& Frustum::get_planes() const noexcept {
+	return m_planes;
+}
+
+void CullingStats::reset() noexcept {
+	visible = 0;
+	culled = 0;
+	occluded = 0;
+}
+
+void CullingStats::add(std::size_t a_visible, std::size_t a_total) noexcept {
+	visible += a_visible;
+	culled += a_total - a_visible;
+}
+
+std::size_t cull_spheres(const Frustum& a_frustum, const SphereBatch& a_batch, std::vector<std::uint8_t>& a_visible) {
+	const std::size_t siz = a_batch.size();
+	const auto& planes = a_frustum.get_planes();
+	a_visible.resize(siz);
+
+	std::size_t i = 0;
+	std::size_t visible_siz = 0;
+
+#if defined(CHILL_SIMD_AVX)
+	for (; i + 8 <= siz; i += 8) {
+		__m256 x = _mm256_loadu_ps(&a_batch.x[i]);
+		__m256 y = _mm256_loadu_ps(&a_batch.y[i]);
+		__m256 z = _mm256_loadu_ps(&a_batch.z[i]);
+		__m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&a_batch.r[i]));
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (const auto& plane : planes) {
+			__m256 dist = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(y, _mm256_set1_ps(plane.y)));
+			dist = _mm256_add_ps(dist, _mm256_mul_ps(z, _mm256_set1_ps(plane.z)));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, neg_r, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (int lane = 0; lane < 8; ++lane) {
+			a_visible[i + lane] = (mask >> lane) & 1;
+		}
+		visible_siz += std::popcount(static_cast<unsigned>(mask));
+	}
+#endif
+
+#if defined(CHILL_SIMD_SSE)
+	for (; i + 4 <= siz; i += 4) {
+		__m128 x = _mm_loadu_ps(&a_batch.x[i]);
+		__m128 y = _mm_loadu_ps(&a_batch.y[i]);
+		__m128 z = _mm_loadu_ps(&a_batch.z[i]);
+		__m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&a_batch.r[i]));
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (const auto& plane : planes) {
+			__m128 dist = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+			dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+			dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, neg_r));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (int lane = 0; lane < 4; ++lane) {
+			a_visible[i + lane] = (mask >> lane) & 1;
+		}
+		visible_siz += std::popcount(static_cast<unsigned>(mask));
+	}
+#endif
+
+	// Scalar tail
+	for (; i < siz; ++i) {
+		a_visible[i] = a_frustum.intersects(BoundingSphere(glm::vec3(a_batch.x[i], a_batch.y[i], a_batch.z[i]), a_batch.r[i]));
+		visible_siz += a_visible[i];
+	}
+
+	return visible_siz;
+}
+}
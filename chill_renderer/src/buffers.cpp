@@ -1,15 +1,25 @@
 #define STB_IMAGE_IMPLEMENTATION 
 #include <stb_image/stb_image.h>
 
-#include <iostream>
+#include <bit>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
 #include "chill_renderer/buffers.hpp"
+#include "chill_renderer/texture_compression.hpp"
 #include "chill_renderer/file_manager.hpp"
 #include "chill_renderer/application.hpp"
 
 namespace chill_renderer { 
 namespace fs = std::filesystem;
 
+// EXT_texture_compression_s3tc and EXT_texture_sRGB, not part of core profile headers.
+static constexpr GLenum g_gl_compressed_rgba_s3tc_dxt1 = 0x83F1;
+static constexpr GLenum g_gl_compressed_rgba_s3tc_dxt5 = 0x83F3;
+static constexpr GLenum g_gl_compressed_srgb_alpha_s3tc_dxt1 = 0x8C4D;
+static constexpr GLenum g_gl_compressed_srgb_alpha_s3tc_dxt5 = 0x8C4F;
+
 fs::path guess_path(const std::wstring& a_path) {
 	// Guess project directory
 	fs::path guessed_proj_dir = fs::current_path();
@@ -28,6 +38,47 @@ fs::path guess_path(const std::wstring& a_path) {
 	return fs::canonical(ret_path);
 }
 
+std::size_t get_texel_size(GLenum a_in_format) noexcept {
+	switch (a_in_format) {
+	case GL_RED: case GL_R8: return 1;
+	case GL_RG: case GL_RG8: return 2;
+	case GL_RGB: case GL_RGB8: case GL_SRGB: case GL_SRGB8: return 3;
+	case GL_RGB16F: return 6;
+	case GL_RGBA16F: case GL_RGBA16I: case GL_RGBA16UI: return 8;
+	case GL_RGB32F: return 12;
+	case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI: return 16;
+	// RGBA8, depth and packed depth stencil formats.
+	default: return 4;
+	}
+}
+
+int get_mip_levels(int a_width, int a_height) noexcept {
+	return std::bit_width(static_cast<unsigned>(std::max({ a_width, a_height, 1 })));
+}
+
+// Texels of first a_levels mips, each one halves both sides.
+static std::size_t mip_chain_texels(int a_width, int a_height, int a_levels) noexcept {
+	std::size_t texels{};
+	for (int i = 0; i < a_levels; ++i) {
+		texels += static_cast<std::size_t>(std::max(a_width >> i, 1)) * std::max(a_height >> i, 1);
+	}
+	return texels;
+}
+
+std::size_t get_storage_size(GLenum a_in_format, int a_width, int a_height, int a_levels) noexcept {
+	return mip_chain_texels(a_width, a_height, a_levels) * get_texel_size(a_in_format);
+}
+
+GLenum conv_sized_format(TextureType a_type, GLenum a_data_type) noexcept {
+	switch (a_type) {
+	case TextureType::GENERIC: case TextureType::DIFFUSE: case TextureType::SPECULAR: case TextureType::EMISSION:
+		return (a_data_type == GL_FLOAT || a_data_type == GL_HALF_FLOAT) ? GL_RGB16F : GL_RGB8;
+	case TextureType::DEPTH:         return GL_DEPTH_COMPONENT32F;
+	case TextureType::DEPTH_STENCIL: return GL_DEPTH24_STENCIL8;
+	default:                         return GL_NONE;
+	}
+}
+
 GLenum conv_wrap(TextureWrap a_wrap) noexcept {
 	switch (a_wrap) {
 	case TextureWrap::REPEAT: return GL_REPEAT;
@@ -63,6 +114,10 @@ void conv_filter(TextureFilter a_filter, GLuint& tex_min, GLuint& tex_mag) noexc
 	}
 }
 
+bool is_mipmap_filter(TextureFilter a_filter) noexcept {
+	return a_filter == TextureFilter::MIPMAP_LINEAR || a_filter == TextureFilter::MIPMAP_NEAREST;
+}
+
 GLuint conv_cmp_func(TextureCmpFunc a_cmp) noexcept {
 	switch (a_cmp) {
 	case TextureCmpFunc::LESS:     return GL_LESS;
@@ -78,9 +133,10 @@ GLuint conv_cmp_func(TextureCmpFunc a_cmp) noexcept {
 }
 
 BufferObjects::BufferObjects(const BufferObjects& a_obj) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::MESHES, a_obj.VAO);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::MESHES, a_obj.handle);
 
 	VAO = a_obj.VAO;
+	handle = a_obj.handle;
 	EBO = a_obj.EBO;
 	VBO_UVs = a_obj.VBO_UVs;
 	VBO_pos = a_obj.VBO_pos;
@@ -89,12 +145,14 @@ BufferObjects::BufferObjects(const BufferObjects& a_obj) {
 
 BufferObjects::BufferObjects(BufferObjects&& a_obj) noexcept {
 	VAO = a_obj.VAO;
+	handle = a_obj.handle;
 	EBO = a_obj.EBO;
 	VBO_UVs = a_obj.VBO_UVs;
 	VBO_pos = a_obj.VBO_pos;
 	VBO_normals = a_obj.VBO_normals;
 
 	a_obj.VAO = EMPTY_VBO;
+	a_obj.handle = {};
 	a_obj.VBO_UVs = EMPTY_VBO;
 	a_obj.VBO_pos = EMPTY_VBO;
 	a_obj.VBO_normals = EMPTY_VBO;
@@ -102,12 +160,13 @@ BufferObjects::BufferObjects(BufferObjects&& a_obj) noexcept {
 }
 
 BufferObjects& BufferObjects::operator=(const BufferObjects& a_obj) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::MESHES, a_obj.VAO); 
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::MESHES, a_obj.handle); 
 
 	if (a_obj.VAO != VAO) {
 		refcnt_dec();
 	} 
 	VAO = a_obj.VAO;
+	handle = a_obj.handle;
 	VBO_UVs = a_obj.VBO_UVs;
 	VBO_pos = a_obj.VBO_pos;
 	VBO_normals = a_obj.VBO_normals;
@@ -121,6 +180,7 @@ BufferObjects& BufferObjects::operator=(BufferObjects&& a_obj) noexcept {
 		refcnt_dec();
 	} 
 	VAO = a_obj.VAO;
+	handle = a_obj.handle;
 	EBO = a_obj.EBO;
 	VBO_UVs = a_obj.VBO_UVs;
 	VBO_pos = a_obj.VBO_pos;
@@ -128,6 +188,7 @@ BufferObjects& BufferObjects::operator=(BufferObjects&& a_obj) noexcept {
 
 	a_obj.EBO = EMPTY_VBO;
 	a_obj.VAO = EMPTY_VBO;
+	a_obj.handle = {};
 	a_obj.VBO_UVs = EMPTY_VBO;
 	a_obj.VBO_pos = EMPTY_VBO;
 	a_obj.VBO_normals = EMPTY_VBO;
@@ -141,13 +202,14 @@ BufferObjects::~BufferObjects() {
 
 void BufferObjects::refcnt_dec() { 
 	if (VAO != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::MESHES, VAO);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::MESHES, VAO)) {
-			glDeleteVertexArrays(1, &VAO);
-			glDeleteBuffers(1, &VBO_pos);
-			glDeleteBuffers(1, &VBO_normals);
-			glDeleteBuffers(1, &VBO_UVs);
-			glDeleteBuffers(1, &EBO);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::MESHES, handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::MESHES, handle, refs)) {
+			GLObjects& gl_objects = Application::get_instance().get_rmanager().get_gl_objects();
+			gl_objects.release(GLObjectType::VERTEX_ARRAY, VAO);
+			gl_objects.release(GLObjectType::BUFFER, VBO_pos);
+			gl_objects.release(GLObjectType::BUFFER, VBO_normals);
+			gl_objects.release(GLObjectType::BUFFER, VBO_UVs);
+			gl_objects.release(GLObjectType::BUFFER, EBO);
 		}
 	}
 }
@@ -158,44 +220,51 @@ void TextureCubemap::abstract_construct() { }
 void TextureMSAA::abstract_construct() { }
 
 Texture::Texture(const Texture& a_texture) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, a_texture.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, a_texture.m_handle);
 
 	m_id = a_texture.m_id;
+	m_handle = a_texture.m_handle;
 	m_gltype = a_texture.m_gltype;
 	m_type = a_texture.m_type;
 	m_wrap = a_texture.m_wrap;
 	m_filter = a_texture.m_filter;
 	m_cmp = a_texture.m_cmp;
 	m_unit_id = a_texture.m_unit_id;
+	m_immutable_levels = a_texture.m_immutable_levels;
 }
 
 // When moving an object, reference count shouldn't increment.
 Texture::Texture(Texture&& a_texture) noexcept {
 	m_id = a_texture.m_id;
+	m_handle = a_texture.m_handle;
 	m_gltype = a_texture.m_gltype;
 	m_type = a_texture.m_type;
 	m_wrap = a_texture.m_wrap;
 	m_filter = a_texture.m_filter;
 	m_cmp = a_texture.m_cmp;
 	m_unit_id = a_texture.m_unit_id;
+	m_immutable_levels = a_texture.m_immutable_levels;
 
 	a_texture.m_id = EMPTY_VBO;
+	a_texture.m_handle = {};
 	a_texture.m_gltype = GL_NONE;
 }
 
 Texture& Texture::operator=(const Texture& a_texture) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, a_texture.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, a_texture.m_handle);
 
 	if (m_id != a_texture.m_id) {
 		refcnt_dec();
 	}
 	m_id = a_texture.m_id;
+	m_handle = a_texture.m_handle;
 	m_gltype = a_texture.m_gltype;
 	m_type = a_texture.m_type;
 	m_wrap = a_texture.m_wrap;
 	m_filter = a_texture.m_filter;
 	m_cmp = a_texture.m_cmp;
 	m_unit_id = a_texture.m_unit_id;
+	m_immutable_levels = a_texture.m_immutable_levels;
 
 	return *this;
 }
@@ -206,14 +275,17 @@ Texture& Texture::operator=(Texture&& a_texture) noexcept {
 		refcnt_dec();
 	}
 	m_id = a_texture.m_id;
+	m_handle = a_texture.m_handle;
 	m_gltype = a_texture.m_gltype;
 	m_type = a_texture.m_type;
 	m_wrap = a_texture.m_wrap;
 	m_filter = a_texture.m_filter;
 	m_cmp = a_texture.m_cmp;
 	m_unit_id = a_texture.m_unit_id;
+	m_immutable_levels = a_texture.m_immutable_levels;
 
 	a_texture.m_id = EMPTY_VBO;
+	a_texture.m_handle = {};
 	a_texture.m_gltype = GL_NONE;
 
 	return *this;
@@ -223,16 +295,34 @@ Texture::~Texture() {
 	refcnt_dec();
 }
 
-void Texture::refcnt_inc() {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, m_id);
+void Texture::refcnt_init() {
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::TEXTURES, m_id);
+}
+
+void Texture::gen_id() {
+	m_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::TEXTURE);
+}
+
+void Texture::track_memory(std::size_t a_bytes) {
+	Application::get_instance().get_rmanager().track_memory(ResourceType::TEXTURES, m_handle, a_bytes);
+}
+
+void Texture::allocate_storage(GLenum a_in_format, int a_width, int a_height, int a_levels, int a_depth) {
+	glBindTexture(m_gltype, m_id);
+	if (m_gltype == GL_TEXTURE_3D) {
+		glTexStorage3D(m_gltype, a_levels, a_in_format, a_width, a_height, a_depth);
+	}
+	else {
+		glTexStorage2D(m_gltype, a_levels, a_in_format, a_width, a_height);
+	}
+	m_immutable_levels = a_levels;
 }
 
 void Texture::refcnt_dec() {
 	if (m_id != EMPTY_VBO && m_type != TextureType::NONE) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::TEXTURES, m_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::TEXTURES, m_id)) {
-			std::cout << "DELETING TEXTURE OBJ: ID: " << m_id << std::endl;
-			glDeleteTextures(1, &m_id);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::TEXTURES, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::TEXTURES, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::TEXTURE, m_id);
 		}
 	} 
 }
@@ -288,9 +378,6 @@ void Texture::set_filter(TextureFilter a_filter) {
 	glBindTexture(m_gltype, m_id); 
 	glTexParameteri(m_gltype, GL_TEXTURE_MIN_FILTER, tex_min);
 	glTexParameteri(m_gltype, GL_TEXTURE_MAG_FILTER, tex_mag);
-	if (a_filter == TextureFilter::MIPMAP_LINEAR || a_filter == TextureFilter::MIPMAP_NEAREST) {
-		glGenerateMipmap(m_gltype);
-	}
 }
 
 void Texture::set_cmp_func(TextureCmpFunc a_cmp_func) {
@@ -326,10 +413,22 @@ GLuint Texture::get_id() const noexcept {
 	return m_id;
 }
 
+ResourceHandle Texture::get_handle() const noexcept {
+	return m_handle;
+}
+
+GLenum Texture::get_gltype() const noexcept {
+	return m_gltype;
+}
+
 int Texture::get_unit_id() const noexcept {
 	return m_unit_id;
 }
 
+int Texture::get_immutable_levels() const noexcept {
+	return m_immutable_levels;
+}
+
 TextureType Texture::get_type() const noexcept {
 	return m_type;
 }
@@ -346,7 +445,119 @@ TextureFilter Texture::get_filter() const noexcept {
 	return m_filter;
 }
 
+// Internal and external formats of 8 bit image, GL_NONE if channel count is unsupported.
+static void image_formats(const ImageData& a_image, bool a_gamma_corr, unsigned& a_in_format, unsigned& a_ex_format) {
+	a_in_format = a_ex_format = GL_NONE;
+	if (a_image.channels == 1) {
+		a_in_format = GL_R8;
+		a_ex_format = GL_RED;
+	}
+	else if (a_image.channels == 3) {
+		a_in_format = (a_gamma_corr) ? GL_SRGB8 : GL_RGB8;
+		a_ex_format = GL_RGB;
+	}
+	else if (a_image.channels == 4) {
+		a_in_format = (a_gamma_corr) ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		a_ex_format = GL_RGBA;
+	}
+}
+
+// Faces of immutable cubemap share storage, so their format, size and level count have to match.
+static bool same_face_layout(const TextureImage& a_lhs, const TextureImage& a_rhs) noexcept {
+	if (a_lhs.index() != a_rhs.index())
+		return false;
+
+	if (const auto* decoded = std::get_if<ImageData>(&a_lhs)) {
+		const auto& other = std::get<ImageData>(a_rhs);
+		return decoded->width == other.width && decoded->height == other.height && decoded->channels == other.channels;
+	}
+
+	const auto& compressed = std::get<CompressedImage>(a_lhs);
+	const auto& other = std::get<CompressedImage>(a_rhs);
+	return compressed.format == other.format && compressed.levels.size() == other.levels.size()
+		&& (compressed.levels.empty() || (compressed.levels[0].width == other.levels[0].width && compressed.levels[0].height == other.levels[0].height));
+}
+
+void ImageData::Free::operator()(unsigned char* a_pixels) const noexcept {
+	stbi_image_free(a_pixels);
+}
+
+std::size_t ImageData::get_byte_size() const noexcept {
+	return static_cast<std::size_t>(width) * height * channels;
+}
+
+std::size_t ImageData::get_gpu_size(bool a_mipmaps) const noexcept {
+	return mip_chain_texels(width, height, a_mipmaps ? get_mip_levels(width, height) : 1) * channels;
+}
+
+std::size_t CompressedImage::get_byte_size() const noexcept {
+	return levels.empty() ? 0 : levels.back().offset + levels.back().size;
+}
+
+std::size_t CompressedImage::get_block_size() const noexcept {
+	return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+// BC4 and BC5 hold data rather than colors, they're never gamma corrected.
+GLenum CompressedImage::get_gl_format(bool a_gamma_corr) const noexcept {
+	switch (format) {
+	case BlockFormat::BC1: return a_gamma_corr ? g_gl_compressed_srgb_alpha_s3tc_dxt1 : g_gl_compressed_rgba_s3tc_dxt1;
+	case BlockFormat::BC3: return a_gamma_corr ? g_gl_compressed_srgb_alpha_s3tc_dxt5 : g_gl_compressed_rgba_s3tc_dxt5;
+	case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case BlockFormat::BC7: return a_gamma_corr ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return GL_NONE;
+}
+
+bool CompressedImage::has_alpha() const noexcept {
+	return format == BlockFormat::BC3 || format == BlockFormat::BC7;
+}
+
+const unsigned char* CompressedImage::get_data() const noexcept {
+	return mapped ? mapped : data.data();
+}
+
+ImageData load_image(const std::wstring& a_path, bool a_flip) {
+	fs::path p = guess_path(a_path);
+	if (p == fs::path()) {
+		ERROR(std::format("[LOAD_IMAGE] Bad image path: {}", wstos(a_path)), Error_action::throwing);
+	}
+
+	ImageData image;
+	image.pixels.reset(stbi_load(wstos(p.wstring()).c_str(), &image.width, &image.height, &image.channels, 0));
+	if (!image.pixels) {
+		ERROR(std::format("[LOAD_IMAGE] Couldn't load image data at path {}", wstos(p.wstring())), Error_action::throwing);
+	}
+
+	if (a_flip) {
+		std::size_t row_siz = static_cast<std::size_t>(image.width) * image.channels;
+		std::vector<unsigned char> row(row_siz);
+		for (int y = 0; y < image.height / 2; ++y) {
+			unsigned char* top = image.pixels.get() + y * row_siz;
+			unsigned char* bottom = image.pixels.get() + (image.height - 1 - y) * row_siz;
+			std::memcpy(row.data(), top, row_siz);
+			std::memcpy(top, bottom, row_siz);
+			std::memcpy(bottom, row.data(), row_siz);
+		}
+	}
+	return image;
+}
+
+ImageData solid_image(int a_channels, unsigned char a_value) {
+	ImageData image;
+	image.width = image.height = 1;
+	image.channels = a_channels;
+	// Released by stbi_image_free, which is free().
+	image.pixels.reset(static_cast<unsigned char*>(std::malloc(a_channels)));
+	std::memset(image.pixels.get(), a_value, a_channels);
+	return image;
+}
+
 Texture2D::Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image, bool a_gamma_corr, GLenum a_data_type)
+	:Texture2D(a_type, a_path, a_flip_image, a_gamma_corr, load_image(a_path, a_flip_image), a_data_type) { }
+
+Texture2D::Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image, bool a_gamma_corr, const ImageData& a_image, GLenum a_data_type, TextureStorage a_storage)
 	:m_flipped{ a_flip_image }, m_gamma_corr{ a_gamma_corr }
 {
 	m_gltype = GL_TEXTURE_2D;
@@ -359,46 +570,90 @@ Texture2D::Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image,
 
 	m_path = p.wstring();
 
-	glGenTextures(1, &m_id);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, m_id);
-	glBindTexture(m_gltype, m_id);
+	m_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::TEXTURE);
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::TEXTURES, m_id);
 
-	int nrChannels{};
-	int width{};
-	int height{};
-	stbi_set_flip_vertically_on_load(a_flip_image);
-	unsigned char* data = stbi_load(wstos(m_path).c_str(), &width, &height, &nrChannels, 0);
+	// Filter is set first, mutable storage sizes its mipmap chain by it.
+	set_wrap(TextureWrap::CLAMP_EDGE);
+	set_filter(TextureFilter::MIPMAP_LINEAR);
+	if (a_storage == TextureStorage::IMMUTABLE) {
+		unsigned in_format = GL_NONE;
+		unsigned ex_format = GL_NONE;
+		image_formats(a_image, m_gamma_corr, in_format, ex_format);
+		if (in_format == GL_NONE) {
+			ERROR(std::format("[TEXTURE2D::TEXTURE2D] Unsupported texture format {} with {} number of channels.", wstos(m_path), a_image.channels), Error_action::throwing);
+		}
+		allocate_storage(in_format, a_image.width, a_image.height, get_mip_levels(a_image.width, a_image.height));
+	}
+	upload(a_image, a_data_type);
+	track_memory(a_image.get_gpu_size(true));
+}
+
+Texture2D::Texture2D(TextureType a_type, std::wstring a_path, bool a_flip_image, bool a_gamma_corr, const CompressedImage& a_image)
+	:m_flipped{ a_flip_image }, m_gamma_corr{ a_gamma_corr }
+{
+	m_gltype = GL_TEXTURE_2D;
+	set_type(a_type);
 
+	// Image may come from cooked asset shipped without its source, then path only names texture.
+	fs::path p = guess_path(a_path);
+	m_path = p.empty() ? a_path : p.wstring();
+
+	gen_id();
+	refcnt_init();
+
+	if (!a_image.levels.empty()) {
+		allocate_storage(a_image.get_gl_format(m_gamma_corr), a_image.levels[0].width, a_image.levels[0].height, static_cast<int>(a_image.levels.size()));
+	}
+	upload(a_image);
+	set_wrap(TextureWrap::CLAMP_EDGE);
+	set_filter(a_image.levels.size() > 1 ? TextureFilter::MIPMAP_LINEAR : TextureFilter::LINEAR);
+	track_memory(a_image.get_byte_size());
+}
+
+void Texture2D::upload(const CompressedImage& a_image) {
+	GLenum format = a_image.get_gl_format(m_gamma_corr);
+
+	glBindTexture(m_gltype, m_id);
+	bool immutable = get_immutable_levels() > 0;
+	for (std::size_t i = 0; i < a_image.levels.size(); ++i) {
+		const auto& level = a_image.levels[i];
+		if (immutable) {
+			glCompressedTexSubImage2D(m_gltype, static_cast<GLint>(i), 0, 0, level.width, level.height, format, static_cast<GLsizei>(level.size), a_image.get_data() + level.offset);
+		}
+		else {
+			glCompressedTexImage2D(m_gltype, static_cast<GLint>(i), format, level.width, level.height, 0, static_cast<GLsizei>(level.size), a_image.get_data() + level.offset);
+		}
+	}
+	// Levels missing in file would leave mipmapped placeholder incomplete.
+	if (!immutable) {
+		glTexParameteri(m_gltype, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(a_image.levels.size()) - 1);
+	}
+}
+
+void Texture2D::upload(const ImageData& a_image, GLenum a_data_type) {
 	unsigned in_format = GL_NONE;
 	unsigned ex_format = GL_NONE;
-	if (nrChannels == 1) {
-		in_format = ex_format = GL_RED;
-	}
-	else if (nrChannels == 3) {
-		in_format = (a_gamma_corr) ? GL_SRGB : GL_RGB;
-		ex_format = GL_RGB;
+	image_formats(a_image, m_gamma_corr, in_format, ex_format);
+	if (in_format == GL_NONE) {
+		ERROR(std::format("[TEXTURE2D::UPLOAD] Unsupported texture format {} with {} number of channels.", wstos(m_path), a_image.channels), Error_action::throwing);
 	}
-	else if (nrChannels == 4) {
-		in_format = (a_gamma_corr) ? GL_SRGB_ALPHA : GL_RGBA;
-		ex_format = GL_RGBA;
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLenum data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
+	glBindTexture(m_gltype, m_id);
+	GLint levels = get_immutable_levels();
+	if (levels > 0) {
+		glTexSubImage2D(m_gltype, 0, 0, 0, a_image.width, a_image.height, ex_format, data_type, a_image.pixels.get());
 	}
 	else {
-		ERROR(std::format("[TEXTURE::TEXTURE] Unsupported texture format {} with {} number of channels.", wstos(m_path), nrChannels), Error_action::throwing);
+		levels = is_mipmap_filter(get_filter()) ? get_mip_levels(a_image.width, a_image.height) : 1;
+		glTexImage2D(m_gltype, 0, in_format, a_image.width, a_image.height, 0, ex_format, data_type, a_image.pixels.get());
+		glTexParameteri(m_gltype, GL_TEXTURE_MAX_LEVEL, levels - 1);
 	}
 
-	if (data) {
-		glTexImage2D(m_gltype, 0, in_format, width, height, 0, ex_format, (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type, data);
-		stbi_image_free(data);
+	if (levels > 1) {
+		glGenerateMipmap(m_gltype);
 	}
-	else {
-		ERROR(std::format("[TEXTURE::TEXTURE] Couldn't load texture data at path {}", wstos(m_path)), Error_action::throwing);
-	} 
-
-	set_wrap(TextureWrap::CLAMP_EDGE);
-	set_filter(TextureFilter::MIPMAP_LINEAR);
 }
 
 std::wstring Texture2D::get_filename() const noexcept {
@@ -420,6 +675,63 @@ bool Texture2D::is_gamma_corr() const noexcept {
 TextureCubemap::TextureCubemap(TextureType a_type, std::vector<std::wstring> a_paths, bool a_flipped, bool a_gamma_corr, GLenum a_data_type)
 	:m_flipped{ a_flipped }, m_gamma_corr{ a_gamma_corr }
 {
+	init(a_type, a_paths);
+	bool compress = Application::get_instance().get_rmanager().is_compressing_textures();
+	// Storage is sized by first face, all faces are loaded and checked against it before anything is uploaded.
+	std::vector<TextureImage> images;
+	images.reserve(6);
+	for (int i = 0; i < 6; ++i) {
+		images.push_back(load_texture_image(m_paths[i], a_flipped, compress));
+		if (i > 0 && !same_face_layout(images[0], images[i])) {
+			ERROR(std::format("[TEXTURECUBEMAP::TEXTURECUBEMAP] Face {} doesn't match format, size or mip levels of {}.", wstos(m_paths[i]), wstos(m_paths[0])), Error_action::throwing);
+		}
+	}
+
+	if (auto* decoded = std::get_if<ImageData>(&images[0])) {
+		unsigned in_format = GL_NONE;
+		unsigned ex_format = GL_NONE;
+		image_formats(*decoded, m_gamma_corr, in_format, ex_format);
+		if (decoded->channels == 1 || in_format == GL_NONE) {
+			ERROR(std::format("[TEXTURECUBEMAP::TEXTURECUBEMAP] Unsupported texture format {} with {} number of channels.", wstos(m_paths[0]), decoded->channels), Error_action::throwing);
+		}
+		allocate_storage(in_format, decoded->width, decoded->height, 1);
+	}
+	else if (const auto& compressed = std::get<CompressedImage>(images[0]); !compressed.levels.empty()) {
+		allocate_storage(compressed.get_gl_format(m_gamma_corr), compressed.levels[0].width, compressed.levels[0].height, static_cast<int>(compressed.levels.size()));
+	}
+
+	std::size_t bytes{};
+	for (int i = 0; i < 6; ++i) {
+		if (auto* decoded = std::get_if<ImageData>(&images[i])) {
+			bytes += decoded->get_gpu_size(false);
+			upload_face(i, *decoded, a_data_type);
+		}
+		else {
+			const auto& compressed = std::get<CompressedImage>(images[i]);
+			bytes += compressed.get_byte_size();
+			upload_face(i, compressed);
+		}
+	}
+	track_memory(bytes);
+
+	set_wrap(TextureWrap::CLAMP_EDGE);
+	set_filter(TextureFilter::LINEAR);
+}
+
+TextureCubemap::TextureCubemap(TextureType a_type, std::vector<std::wstring> a_paths, bool a_flipped, bool a_gamma_corr, const ImageData& a_placeholder)
+	:m_flipped{ a_flipped }, m_gamma_corr{ a_gamma_corr }
+{
+	init(a_type, a_paths);
+	for (int i = 0; i < 6; ++i) {
+		upload_face(i, a_placeholder);
+	}
+	track_memory(6 * a_placeholder.get_gpu_size(false));
+
+	set_wrap(TextureWrap::CLAMP_EDGE);
+	set_filter(TextureFilter::LINEAR);
+}
+
+void TextureCubemap::init(TextureType a_type, const std::vector<std::wstring>& a_paths) {
 	// Each cubemap face has to be a single texture
 	if (a_paths.size() != 6)
 		ERROR("[TEXTURECUBEMAP::TEXTURECUBEMAP] Wrong amount of textures to create a cubemap.", Error_action::throwing); 
@@ -449,45 +761,56 @@ TextureCubemap::TextureCubemap(TextureType a_type, std::vector<std::wstring> a_p
 		m_paths.push_back(p.wstring());
 	}
 
-	glGenTextures(1, &m_id);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, m_id);
-	glBindTexture(m_gltype, m_id);
+	m_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::TEXTURE);
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::TEXTURES, m_id);
+}
 
-	stbi_set_flip_vertically_on_load(a_flipped);
-	for (size_t i = 0; i < 6; ++i) {
-		int nrChannels{};
-		int width{};
-		int height{};
-		unsigned char* data = stbi_load(wstos(m_paths[i]).c_str(), &width, &height, &nrChannels, 0);
+void TextureCubemap::upload_face(int a_face, const ImageData& a_image, GLenum a_data_type) {
+	unsigned in_format = GL_NONE;
+	unsigned ex_format = GL_NONE;
+	image_formats(a_image, m_gamma_corr, in_format, ex_format);
+	if (a_image.channels == 1 || in_format == GL_NONE) {
+		ERROR(std::format("[TEXTURECUBEMAP::UPLOAD_FACE] Unsupported texture format {} with {} number of channels.", wstos(m_paths[a_face]), a_image.channels), Error_action::throwing);
+	}
 
-		unsigned in_format = GL_NONE;
-		unsigned ex_format = GL_NONE;
-		if (nrChannels == 3) {
-			in_format = a_gamma_corr ? GL_SRGB : GL_RGB;
-			ex_format = GL_RGB;
-		}
-		else if (nrChannels == 4) {
-			in_format = a_gamma_corr ? GL_SRGB_ALPHA : GL_RGBA;
-			ex_format = GL_RGBA;
+	GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + a_face;
+	GLenum data_type = (a_data_type == DEFAULT_TYPE) ? GL_UNSIGNED_BYTE : a_data_type;
+	glBindTexture(m_gltype, m_id);
+	if (get_immutable_levels() > 0) {
+		glTexSubImage2D(target, 0, 0, 0, a_image.width, a_image.height, ex_format, data_type, a_image.pixels.get());
+	}
+	else {
+		glTexImage2D(target, 0, in_format, a_image.width, a_image.height, 0, ex_format, data_type, a_image.pixels.get());
+		glTexParameteri(m_gltype, GL_TEXTURE_MAX_LEVEL, 0);
+	}
+}
 
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		}
-		else {
-			ERROR(std::format("[TEXTURECUBEMAP::TEXTURECUBEMAP] Unsupported texture format {} with {} number of channels.", wstos(m_paths[i]), nrChannels), Error_action::throwing);
-		}
+void TextureCubemap::upload_face(int a_face, const CompressedImage& a_image) {
+	GLenum format = a_image.get_gl_format(m_gamma_corr);
+	GLenum target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + a_face;
 
-		if (data) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, in_format, width, height, 0, ex_format, a_data_type == DEFAULT_TYPE ? GL_UNSIGNED_BYTE : a_data_type, data);
-			stbi_image_free(data); 
+	glBindTexture(m_gltype, m_id);
+	bool immutable = get_immutable_levels() > 0;
+	for (std::size_t i = 0; i < a_image.levels.size(); ++i) {
+		const auto& level = a_image.levels[i];
+		if (immutable) {
+			glCompressedTexSubImage2D(target, static_cast<GLint>(i), 0, 0, level.width, level.height, format, static_cast<GLsizei>(level.size), a_image.get_data() + level.offset);
 		}
 		else {
-			ERROR(std::format("[TEXTURECUBEMAP::TEXTURECUBEMAP] Couldn't load texture data at path {}", wstos(m_paths[i])), Error_action::throwing);
+			glCompressedTexImage2D(target, static_cast<GLint>(i), format, level.width, level.height, 0, static_cast<GLsizei>(level.size), a_image.get_data() + level.offset);
 		}
 	}
+	if (!immutable) {
+		glTexParameteri(m_gltype, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(a_image.levels.size()) - 1);
+	}
+}
 
-	set_wrap(TextureWrap::CLAMP_EDGE);
-	set_filter(TextureFilter::LINEAR);
+bool TextureCubemap::is_flipped() const noexcept {
+	return m_flipped;
+}
+
+bool TextureCubemap::is_gamma_corr() const noexcept {
+	return m_gamma_corr;
 }
 
 std::vector<std::wstring> TextureCubemap::get_paths() const noexcept {
@@ -509,22 +832,16 @@ TextureMSAA::TextureMSAA(TextureType a_type, int a_width, int a_height, int a_sa
 	m_gltype = GL_TEXTURE_2D_MULTISAMPLE;
 	set_type(a_type);
 
-	glGenTextures(1, &m_id);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::TEXTURES, m_id); 
+	m_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::TEXTURE);
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::TEXTURES, m_id);
 	glBindTexture(m_gltype, m_id); 
 
-	if (a_type == TextureType::GENERIC || a_type == TextureType::DIFFUSE || a_type == TextureType::SPECULAR || a_type == TextureType::EMISSION) {
-		glTexImage2DMultisample(m_gltype, a_samples, GL_RGB, a_width, a_height, GL_TRUE);
-	}
-	else if (a_type == TextureType::DEPTH) {
-		glTexImage2DMultisample(m_gltype, a_samples, GL_DEPTH_COMPONENT, a_width, a_height, GL_TRUE);
-	}
-	else if (a_type == TextureType::DEPTH_STENCIL) {
-		glTexImage2DMultisample(m_gltype, a_samples, GL_DEPTH24_STENCIL8, a_width, a_height, GL_TRUE);
-	} 
-	else {
+	GLenum in_format = conv_sized_format(a_type, DEFAULT_TYPE);
+	if (in_format == GL_NONE) {
 		ERROR("[TEXTUREMSAA::TEXTUREMSAA] Wrong TextureType.", Error_action::throwing);
 	}
+	glTexStorage2DMultisample(m_gltype, a_samples, in_format, a_width, a_height, GL_TRUE);
+	track_memory(static_cast<std::size_t>(a_width) * a_height * a_samples * get_texel_size(in_format));
 
 	//set_wrap(TextureWrap::CLAMP_EDGE);
 	//set_filter(TextureFilter::LINEAR);
@@ -534,19 +851,26 @@ int TextureMSAA::get_samples() const noexcept {
 	return m_samples;
 }
 
+static GLenum renderbuffer_format(RenderBufferType a_type) noexcept {
+	switch (a_type) {
+	case RenderBufferType::COLOR:         return GL_RGB8;
+	case RenderBufferType::DEPTH:         return GL_DEPTH_COMPONENT32F;
+	case RenderBufferType::DEPTH_STENCIL: return GL_DEPTH24_STENCIL8;
+	default:                              return GL_NONE;
+	}
+}
+
 RenderBuffer::RenderBuffer(int a_width, int a_height, RenderBufferType a_type) :m_type{ a_type } {
 	if (a_type != RenderBufferType::COLOR && a_type != RenderBufferType::DEPTH && a_type != RenderBufferType::DEPTH_STENCIL)
 		ERROR("[RENDERBUFFER::RENDERBUFFER] Bad renderbuffer type.", Error_action::throwing);
 
-	glGenRenderbuffers(1, &m_rbo);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::RENDER_BUFFERS, m_rbo);
+	m_rbo = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::RENDER_BUFFER);
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::RENDER_BUFFERS, m_rbo);
 	glBindRenderbuffer(GL_RENDERBUFFER, m_rbo);
 
-	switch (a_type) {
-	case RenderBufferType::COLOR:         glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB, a_width, a_height); break;
-	case RenderBufferType::DEPTH:         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, a_width, a_height); break;
-	case RenderBufferType::DEPTH_STENCIL: glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, a_width, a_height); break;
-	}
+	GLenum in_format = renderbuffer_format(a_type);
+	glRenderbufferStorage(GL_RENDERBUFFER, in_format, a_width, a_height);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::RENDER_BUFFERS, m_handle, static_cast<std::size_t>(a_width) * a_height * get_texel_size(in_format));
 
 	glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
@@ -557,41 +881,43 @@ RenderBuffer::RenderBuffer(int a_width, int a_height, int a_samples, RenderBuffe
 	if (a_type != RenderBufferType::COLOR && a_type != RenderBufferType::DEPTH && a_type != RenderBufferType::DEPTH_STENCIL)
 		ERROR("[RENDERBUFFER::RENDERBUFFER] Bad MSAA renderbuffer type.", Error_action::throwing);
 
-	glGenRenderbuffers(1, &m_rbo);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::RENDER_BUFFERS, m_rbo);
+	m_rbo = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::RENDER_BUFFER);
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::RENDER_BUFFERS, m_rbo);
 	glBindRenderbuffer(GL_RENDERBUFFER, m_rbo); 
 
-	switch (a_type) {
-	case RenderBufferType::COLOR:         glRenderbufferStorageMultisample(GL_RENDERBUFFER, a_samples, GL_RGB, a_width, a_height); break;
-	case RenderBufferType::DEPTH:         glRenderbufferStorageMultisample(GL_RENDERBUFFER, a_samples, GL_DEPTH_COMPONENT, a_width, a_height); break;
-	case RenderBufferType::DEPTH_STENCIL: glRenderbufferStorageMultisample(GL_RENDERBUFFER, a_samples, GL_DEPTH24_STENCIL8, a_width, a_height); break;
-	}
+	GLenum in_format = renderbuffer_format(a_type);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, a_samples, in_format, a_width, a_height);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::RENDER_BUFFERS, m_handle, static_cast<std::size_t>(a_width) * a_height * a_samples * get_texel_size(in_format));
 
 	glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
 RenderBuffer::RenderBuffer(const RenderBuffer& a_ren_buf) {
-	Application::get_instance().get_instance().get_rmanager().inc_ref_count(ResourceType::RENDER_BUFFERS, a_ren_buf.get_id());
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::RENDER_BUFFERS, a_ren_buf.m_handle);
 
 	m_rbo = a_ren_buf.m_rbo;
+	m_handle = a_ren_buf.m_handle;
 	m_type = a_ren_buf.m_type;
 }
 
 RenderBuffer::RenderBuffer(RenderBuffer&& a_ren_buf) noexcept {
 	m_rbo = a_ren_buf.m_rbo;
+	m_handle = a_ren_buf.m_handle;
 	m_type = a_ren_buf.m_type;
 
 	a_ren_buf.m_rbo = EMPTY_VBO;
+	a_ren_buf.m_handle = {};
 	a_ren_buf.m_type = RenderBufferType::NONE;
 }
 
 RenderBuffer& RenderBuffer::operator=(const RenderBuffer& a_ren_buf) {
-	Application::get_instance().get_instance().get_rmanager().inc_ref_count(ResourceType::RENDER_BUFFERS, a_ren_buf.get_id());
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::RENDER_BUFFERS, a_ren_buf.m_handle);
 
 	if (m_rbo != a_ren_buf.m_rbo) {
 		refcnt_dec();
 	}
 	m_rbo = a_ren_buf.m_rbo;
+	m_handle = a_ren_buf.m_handle;
 	m_type = a_ren_buf.m_type;
 
 	return *this;
@@ -602,9 +928,11 @@ RenderBuffer& RenderBuffer::operator=(RenderBuffer&& a_ren_buf) noexcept {
 		refcnt_dec();
 	}
 	m_rbo = a_ren_buf.m_rbo;
+	m_handle = a_ren_buf.m_handle;
 	m_type = a_ren_buf.m_type;
 
 	a_ren_buf.m_rbo = EMPTY_VBO;
+	a_ren_buf.m_handle = {};
 	a_ren_buf.m_type = RenderBufferType::NONE;
 
 	return *this;
@@ -616,9 +944,9 @@ RenderBuffer::~RenderBuffer() {
 
 void RenderBuffer::refcnt_dec() {
 	if (m_rbo != EMPTY_VBO && m_type != RenderBufferType::NONE) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::RENDER_BUFFERS, m_rbo);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::RENDER_BUFFERS, m_rbo)) {
-			glDeleteRenderbuffers(1, &m_rbo);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::RENDER_BUFFERS, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::RENDER_BUFFERS, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::RENDER_BUFFER, m_rbo);
 		}
 	} 
 }
@@ -702,12 +1030,13 @@ std::variant<uPtrTex, uPtrRen>& AttachmentBuffer::get_attachment() noexcept {
 }
 
 FrameBuffer::FrameBuffer(int a_width, int a_height) :m_width{ a_width }, m_height{ a_height } {
-	glGenFramebuffers(1, &m_fbo);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::FRAME_BUFFERS, m_fbo);
+	m_fbo = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::FRAME_BUFFER);
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::FRAME_BUFFERS, m_fbo);
 }
 
 FrameBuffer::FrameBuffer(FrameBuffer&& a_frame_buf) noexcept {
 	m_fbo = a_frame_buf.m_fbo;
+	m_handle = a_frame_buf.m_handle;
 	m_width = a_frame_buf.m_width;
 	m_height = a_frame_buf.m_height;
 	m_samples = a_frame_buf.m_samples;
@@ -716,6 +1045,7 @@ FrameBuffer::FrameBuffer(FrameBuffer&& a_frame_buf) noexcept {
 	m_depth_stencil_attachment = std::move(a_frame_buf.m_depth_stencil_attachment);
 
 	a_frame_buf.m_fbo = EMPTY_VBO;
+	a_frame_buf.m_handle = {};
 }
 
 FrameBuffer& FrameBuffer::operator=(FrameBuffer&& a_frame_buf) noexcept {
@@ -723,6 +1053,7 @@ FrameBuffer& FrameBuffer::operator=(FrameBuffer&& a_frame_buf) noexcept {
 		refcnt_dec();
 	}
 	m_fbo = a_frame_buf.m_fbo;
+	m_handle = a_frame_buf.m_handle;
 	m_width = a_frame_buf.m_width;
 	m_height = a_frame_buf.m_height;
 	m_samples = a_frame_buf.m_samples;
@@ -731,6 +1062,7 @@ FrameBuffer& FrameBuffer::operator=(FrameBuffer&& a_frame_buf) noexcept {
 	m_depth_stencil_attachment = std::move(a_frame_buf.m_depth_stencil_attachment);
 
 	a_frame_buf.m_fbo = EMPTY_VBO;
+	a_frame_buf.m_handle = {};
 
 	return *this;
 }
@@ -741,9 +1073,9 @@ FrameBuffer::~FrameBuffer() {
 
 void FrameBuffer::refcnt_dec() {
 	if (m_fbo != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::FRAME_BUFFERS, m_fbo);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::FRAME_BUFFERS, m_fbo)) {
-			glDeleteFramebuffers(1, &m_fbo);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::FRAME_BUFFERS, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::FRAME_BUFFERS, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::FRAME_BUFFER, m_fbo);
 		}
 	} 
 }
@@ -756,8 +1088,8 @@ void FrameBuffer::attach(AttachmentType a_attach_type, AttachmentBufferType a_bu
 
 	m_samples = a_samples; 
 	if (m_fbo == EMPTY_VBO) {
-		glGenFramebuffers(1, &m_fbo);
-		Application::get_instance().get_rmanager().inc_ref_count(ResourceType::FRAME_BUFFERS, m_fbo);
+		m_fbo = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::FRAME_BUFFER);
+		m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::FRAME_BUFFERS, m_fbo);
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo); 
@@ -818,8 +1150,8 @@ void FrameBuffer::attach(AttachmentType a_attach_type, AttachmentBufferType a_bu
 
 void FrameBuffer::attach_cubemap_face(GLenum a_cubemap_face) { 
 	if (m_fbo == EMPTY_VBO) {
-		glGenFramebuffers(1, &m_fbo);
-		Application::get_instance().get_rmanager().inc_ref_count(ResourceType::FRAME_BUFFERS, m_fbo);
+		m_fbo = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::FRAME_BUFFER);
+		m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::FRAME_BUFFERS, m_fbo);
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
@@ -943,9 +1275,10 @@ int FrameBuffer::get_samples() const noexcept {
 }
 
 UniformBuffer::UniformBuffer(const UniformBuffer& a_uni_buf) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::UNIFORM_BUFFERS, a_uni_buf.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::UNIFORM_BUFFERS, a_uni_buf.m_handle);
 
 	m_id = a_uni_buf.m_id;
+	m_handle = a_uni_buf.m_handle;
 	m_size = a_uni_buf.m_size;
 	m_elements = a_uni_buf.m_elements;
 	m_binding_point = a_uni_buf.m_binding_point; 
@@ -953,11 +1286,13 @@ UniformBuffer::UniformBuffer(const UniformBuffer& a_uni_buf) {
 
 UniformBuffer::UniformBuffer(UniformBuffer&& a_uni_buf) noexcept {
 	m_id = a_uni_buf.m_id;
+	m_handle = a_uni_buf.m_handle;
 	m_size = a_uni_buf.m_size;
 	m_elements = std::move(a_uni_buf.m_elements);
 	m_binding_point = a_uni_buf.m_binding_point;
 
 	a_uni_buf.m_id = EMPTY_VBO; 
+	a_uni_buf.m_handle = {};
 }
 
 UniformBuffer::~UniformBuffer() {
@@ -966,24 +1301,29 @@ UniformBuffer::~UniformBuffer() {
 
 void UniformBuffer::refcnt_dec() {
 	if (m_id != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::UNIFORM_BUFFERS, m_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::UNIFORM_BUFFERS, m_id)) {
-			glDeleteFramebuffers(1, &m_id);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::UNIFORM_BUFFERS, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::UNIFORM_BUFFERS, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::BUFFER, m_id);
 		}
 	} 
 }
 
-void UniformBuffer::refcnt_inc() {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::UNIFORM_BUFFERS, m_id);
+void UniformBuffer::refcnt_init() {
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::UNIFORM_BUFFERS, m_id);
+}
+
+void UniformBuffer::gen_id() {
+	m_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
 }
 
 UniformBuffer& UniformBuffer::operator=(const UniformBuffer& a_uni_buf) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::UNIFORM_BUFFERS, a_uni_buf.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::UNIFORM_BUFFERS, a_uni_buf.m_handle);
 
 	if (m_id != a_uni_buf.m_id) { 
 		refcnt_dec();
 	}
 	m_id = a_uni_buf.m_id;
+	m_handle = a_uni_buf.m_handle;
 	m_size = a_uni_buf.m_size;
 	m_elements = a_uni_buf.m_elements;
 	m_binding_point = a_uni_buf.m_binding_point;
@@ -996,11 +1336,13 @@ UniformBuffer& UniformBuffer::operator=(UniformBuffer&& a_uni_buf) noexcept {
 		refcnt_dec();
 	}
 	m_id = a_uni_buf.m_id;
+	m_handle = a_uni_buf.m_handle;
 	m_size = a_uni_buf.m_size;
 	m_elements = std::move(a_uni_buf.m_elements);
 	m_binding_point = a_uni_buf.m_binding_point;
 
 	a_uni_buf.m_id = EMPTY_VBO;
+	a_uni_buf.m_handle = {};
 
 	return *this; 
 }
@@ -1020,13 +1362,14 @@ bool UniformBuffer::check_status() const noexcept {
 
 void UniformBuffer::create_buffer() noexcept {
 	if (m_id == EMPTY_VBO) {
-		glGenBuffers(1, &m_id);
-		Application::get_instance().get_rmanager().inc_ref_count(ResourceType::UNIFORM_BUFFERS, m_id);
+		m_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
+		m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::UNIFORM_BUFFERS, m_id);
 	}
 
 	glBindBuffer(GL_UNIFORM_BUFFER, m_id);
 	glBufferData(GL_UNIFORM_BUFFER, m_size, NULL, GL_STATIC_DRAW);
 	glBindBuffer(GL_UNIFORM_BUFFER, 0); 
+	Application::get_instance().get_rmanager().track_memory(ResourceType::UNIFORM_BUFFERS, m_handle, m_size);
 }
 
 void UniformBuffer::set_binding_point(int a_binding_point) noexcept {
@@ -1037,15 +1380,232 @@ void UniformBuffer::set_binding_point(int a_binding_point) noexcept {
 void UniformBuffer::clear() {
 	m_elements.clear();
 	if (m_id != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::UNIFORM_BUFFERS, m_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::UNIFORM_BUFFERS, m_id)) {
-			glDeleteFramebuffers(1, &m_id);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::UNIFORM_BUFFERS, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::UNIFORM_BUFFERS, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::BUFFER, m_id);
 		}
 		m_id = EMPTY_VBO;
+		m_handle = {};
 	} 
 }
 
 UniformBuffer::NameUniMap UniformBuffer::get_elements() const noexcept {
 	return m_elements; 
 } 
+
+StreamBuffer::StreamBuffer(std::size_t a_capacity) {
+	reserve(a_capacity);
+}
+
+StreamBuffer::StreamBuffer(StreamBuffer&& a_stream_buf) noexcept {
+	m_capacity = a_stream_buf.m_capacity;
+	m_head = a_stream_buf.m_head;
+	m_id = a_stream_buf.m_id;
+	m_regions = std::move(a_stream_buf.m_regions);
+
+	a_stream_buf.m_id = EMPTY_VBO;
+	a_stream_buf.m_capacity = 0;
+	a_stream_buf.m_regions.clear();
+}
+
+StreamBuffer& StreamBuffer::operator=(StreamBuffer&& a_stream_buf) noexcept {
+	if (this != &a_stream_buf) {
+		release();
+		m_capacity = a_stream_buf.m_capacity;
+		m_head = a_stream_buf.m_head;
+		m_id = a_stream_buf.m_id;
+		m_regions = std::move(a_stream_buf.m_regions);
+
+		a_stream_buf.m_id = EMPTY_VBO;
+		a_stream_buf.m_capacity = 0;
+		a_stream_buf.m_regions.clear();
+	}
+	return *this;
+}
+
+StreamBuffer::~StreamBuffer() {
+	release();
+}
+
+void StreamBuffer::release() noexcept {
+	for (const auto& region : m_regions) {
+		if (region.fence)
+			glDeleteSync(region.fence);
+	}
+	m_regions.clear();
+	if (m_id != EMPTY_VBO) {
+		glDeleteBuffers(1, &m_id);
+		m_id = EMPTY_VBO;
+	}
+	m_capacity = 0;
+	m_head = 0;
+}
+
+// Orphans old storage, so pending copies from it don't need to be waited on.
+void StreamBuffer::reserve(std::size_t a_siz) {
+	for (const auto& region : m_regions) {
+		if (region.fence)
+			glDeleteSync(region.fence);
+	}
+	m_regions.clear();
+
+	if (m_id == EMPTY_VBO)
+		glGenBuffers(1, &m_id);
+	m_capacity = a_siz;
+	m_head = 0;
+	glBindBuffer(GL_COPY_READ_BUFFER, m_id);
+	glBufferData(GL_COPY_READ_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+}
+
+void StreamBuffer::wait_regions(std::size_t a_begin, std::size_t a_end) {
+	std::erase_if(m_regions, [a_begin, a_end](Region& a_region) {
+		GLuint64 timeout = 0;
+		if (a_region.begin < a_end && a_begin < a_region.end) {
+			timeout = GL_TIMEOUT_IGNORED;
+			// Commands reading region were already issued if it's about to be overwritten.
+			if (!a_region.fence)
+				a_region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		else if (!a_region.fence) {
+			return false;
+		}
+		// Overlapping regions block, others are only dropped once GPU is done with them.
+		GLenum status = glClientWaitSync(a_region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if (status == GL_TIMEOUT_EXPIRED)
+			return false;
+
+		glDeleteSync(a_region.fence);
+		return true;
+		});
+}
+
+std::size_t StreamBuffer::write(const void* a_data, std::size_t a_siz, std::size_t a_alignment) {
+	// Keep at least few frames of uploads in flight.
+	if (a_siz + a_alignment > m_capacity)
+		reserve(std::max((a_siz + a_alignment) * 3, m_capacity * 2));
+	m_head = (m_head + a_alignment - 1) / a_alignment * a_alignment;
+	if (m_head + a_siz > m_capacity)
+		m_head = 0;
+	wait_regions(m_head, m_head + a_siz);
+
+	std::size_t offset = m_head;
+	glBindBuffer(GL_COPY_READ_BUFFER, m_id);
+	void* dst = glMapBufferRange(GL_COPY_READ_BUFFER, offset, a_siz, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (!dst) {
+		ERROR(std::format("[STREAMBUFFER::WRITE] Couldn't map {} bytes of stream buffer {}.", a_siz, m_id), Error_action::logging);
+		return offset;
+	}
+	std::memcpy(dst, a_data, a_siz);
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+	m_regions.push_back({ offset, offset + a_siz, nullptr });
+	m_head = offset + a_siz;
+	return offset;
+}
+
+void StreamBuffer::fence() {
+	for (auto& region : m_regions) {
+		if (!region.fence)
+			region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+void StreamBuffer::upload(GLuint a_dst_buf, std::size_t a_dst_offset, const void* a_data, std::size_t a_siz) {
+	if (a_siz == 0)
+		return;
+
+	std::size_t offset = write(a_data, a_siz);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_id);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, a_dst_buf);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, a_dst_offset, a_siz);
+	m_regions.back().fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLuint StreamBuffer::get_id() const noexcept {
+	return m_id;
+}
+
+std::size_t StreamBuffer::get_capacity() const noexcept {
+	return m_capacity;
+}
+void TextureStreamer::push(const Texture2D& a_texture, ImageData&& a_image) {
+	push_upload({ a_texture, GL_TEXTURE_2D, GL_NONE, GL_NONE, std::move(a_image) }, a_texture.is_gamma_corr());
+}
+
+void TextureStreamer::push(const TextureCubemap& a_cubemap, int a_face, ImageData&& a_image) {
+	push_upload({ a_cubemap, static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + a_face), GL_NONE, GL_NONE, std::move(a_image) }, a_cubemap.is_gamma_corr());
+}
+
+void TextureStreamer::push_upload(Upload&& a_upload, bool a_gamma_corr) {
+	image_formats(a_upload.image, a_gamma_corr, a_upload.in_format, a_upload.ex_format);
+	if (a_upload.in_format == GL_NONE || !a_upload.image.pixels) {
+		ERROR(std::format("[TEXTURESTREAMER::PUSH] Unsupported image with {} number of channels.", a_upload.image.channels), Error_action::throwing);
+	}
+	m_uploads.push_back(std::move(a_upload));
+}
+
+std::size_t TextureStreamer::update(std::size_t a_byte_budget) {
+	std::size_t bytes{};
+	while (!m_uploads.empty() && bytes < a_byte_budget) {
+		Upload& upload = m_uploads.front();
+		const Texture& texture = std::visit([](const auto& a_texture) -> const Texture& { return a_texture; }, upload.texture);
+		const ImageData& image = upload.image;
+		GLenum gltype = std::holds_alternative<Texture2D>(upload.texture) ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+		glBindTexture(gltype, texture.get_id());
+
+		// Immutable storage only gets refilled, mutable placeholder is reallocated to image size.
+		if (upload.next_row < 0) {
+			if (texture.get_immutable_levels() == 0) {
+				glTexImage2D(upload.target, 0, upload.in_format, image.width, image.height, 0, upload.ex_format, GL_UNSIGNED_BYTE, NULL);
+				glTexParameteri(gltype, GL_TEXTURE_MAX_LEVEL, is_mipmap_filter(texture.get_filter()) ? get_mip_levels(image.width, image.height) - 1 : 0);
+			}
+			upload.next_row = 0;
+		}
+
+		const std::size_t row_siz = static_cast<std::size_t>(image.width) * image.channels;
+		int rows = static_cast<int>(std::clamp<std::size_t>(g_texture_strip_bytes / row_siz, 1, image.height - upload.next_row));
+		std::size_t strip_siz = rows * row_siz;
+		std::size_t offset = m_stream_buf.write(image.pixels.get() + upload.next_row * row_siz, strip_siz);
+
+		// Rows of 1 and 3 channel images are tightly packed.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stream_buf.get_id());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(upload.target, 0, 0, upload.next_row, image.width, rows, upload.ex_format, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		bytes += strip_siz;
+		upload.next_row += rows;
+		if (upload.next_row == image.height) {
+			finish(upload);
+			m_uploads.pop_front();
+		}
+	}
+
+	if (bytes > 0)
+		m_stream_buf.fence();
+	return bytes;
+}
+
+// Mipmaps are generated once the last image of texture is in, e.g. last cubemap face.
+void TextureStreamer::finish(const Upload& a_upload) {
+	const Texture& texture = std::visit([](const auto& a_texture) -> const Texture& { return a_texture; }, a_upload.texture);
+	GLuint id = texture.get_id();
+	bool last = std::none_of(m_uploads.begin() + 1, m_uploads.end(), [id](const Upload& a_other) {
+			return std::visit([](const auto& a_texture) { return a_texture.get_id(); }, a_other.texture) == id;
+		});
+
+	bool mipmaps = is_mipmap_filter(texture.get_filter());
+	if (last && mipmaps) {
+		glGenerateMipmap(std::holds_alternative<Texture2D>(a_upload.texture) ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP);
+	}
+
+	// Faces of a cubemap are assumed to share one size.
+	std::size_t faces = std::holds_alternative<Texture2D>(a_upload.texture) ? 1 : 6;
+	Application::get_instance().get_rmanager().track_memory(ResourceType::TEXTURES, texture.get_handle(), faces * a_upload.image.get_gpu_size(mipmaps));
+}
+
+std::size_t TextureStreamer::get_pending() const noexcept {
+	return m_uploads.size();
+}
 }
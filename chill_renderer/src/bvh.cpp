@@ -0,0 +1,443 @@
+#include <format>
+#include <algorithm>
+#include <queue>
+#include <utility>
+
+#include "chill_renderer/bvh.hpp"
+#include "chill_renderer/assert.hpp"
+
+namespace chill_renderer {
+static AABB merge(const AABB& a_aabb1, const AABB& a_aabb2) {
+	AABB ret = a_aabb1;
+	ret.expand(a_aabb2);
+	return ret;
+}
+
+static float distance2(const AABB& a_aabb, const glm::vec3& a_point) {
+	glm::vec3 d = glm::max(glm::max(a_aabb.min - a_point, a_point - a_aabb.max), glm::vec3(0.0f));
+	return glm::dot(d, d);
+}
+
+bool DynamicBVH::Node::is_leaf() const noexcept {
+	return child1 == g_bvh_null_node;
+}
+
+DynamicBVH::DynamicBVH(float a_margin)
+	:m_margin{ a_margin }
+{ }
+
+int DynamicBVH::create_proxy(const AABB& a_aabb, std::uint32_t a_user_data) {
+	int proxy = alloc_node();
+	m_nodes[proxy].aabb = fatten(a_aabb);
+	m_nodes[proxy].user_data = a_user_data;
+	m_nodes[proxy].height = 0;
+	insert_leaf(proxy);
+	m_proxy_count++;
+	return proxy;
+}
+
+void DynamicBVH::destroy_proxy(int a_proxy) {
+	if (a_proxy < 0 || a_proxy >= static_cast<int>(m_nodes.size()) || !m_nodes[a_proxy].is_leaf() || m_nodes[a_proxy].height < 0)
+		ERROR(std::format("[DYNAMICBVH::DESTROY_PROXY] Bad proxy id: {}", a_proxy), Error_action::throwing);
+
+	remove_leaf(a_proxy);
+	free_node(a_proxy);
+	m_proxy_count--;
+}
+
+// Returns true if proxy had to be reinserted.
+bool DynamicBVH::move_proxy(int a_proxy, const AABB& a_aabb) {
+	const AABB& fat_aabb = m_nodes[a_proxy].aabb;
+	if (fat_aabb.contains(a_aabb)) {
+		// Reinsert anyway when stored box became much larger than the object, otherwise queries get sloppy.
+		AABB huge_aabb = a_aabb;
+		glm::vec3 huge_margin = glm::vec3(4.f * m_margin) + a_aabb.get_extent() * 0.4f;
+		huge_aabb.min -= huge_margin;
+		huge_aabb.max += huge_margin;
+		if (huge_aabb.contains(fat_aabb))
+			return false;
+	}
+
+	remove_leaf(a_proxy);
+	m_nodes[a_proxy].aabb = fatten(a_aabb);
+	insert_leaf(a_proxy);
+	return true;
+}
+
+void DynamicBVH::clear() noexcept {
+	m_nodes.clear();
+	m_root = g_bvh_null_node;
+	m_free_list = g_bvh_null_node;
+	m_proxy_count = 0;
+}
+
+void DynamicBVH::query_frustum(const Frustum& a_frustum, std::vector<std::uint32_t>& a_inside, std::vector<std::uint32_t>& a_intersecting) const {
+	a_inside.clear();
+	a_intersecting.clear();
+	if (m_root == g_bvh_null_node)
+		return;
+
+	const auto& planes = a_frustum.get_planes();
+	constexpr unsigned all_planes = (1u << 6) - 1;
+
+	// Second member is mask of planes the node still straddles. Children of a node inside a plane skip that plane.
+	std::vector<std::pair<int, unsigned>> stack;
+	stack.reserve(64);
+	stack.emplace_back(m_root, all_planes);
+
+	while (!stack.empty()) {
+		auto [node_id, mask] = stack.back();
+		stack.pop_back();
+		const Node& node = m_nodes[node_id];
+
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; ++i) {
+			if (!(mask & (1u << i)))
+				continue;
+			const auto& plane = planes[i];
+			glm::vec3 p_vertex{
+				(plane.x >= 0.f) ? node.aabb.max.x : node.aabb.min.x,
+				(plane.y >= 0.f) ? node.aabb.max.y : node.aabb.min.y,
+				(plane.z >= 0.f) ? node.aabb.max.z : node.aabb.min.z,
+			};
+			glm::vec3 n_vertex{
+				(plane.x >= 0.f) ? node.aabb.min.x : node.aabb.max.x,
+				(plane.y >= 0.f) ? node.aabb.min.y : node.aabb.max.y,
+				(plane.z >= 0.f) ? node.aabb.min.z : node.aabb.max.z,
+			};
+			if (glm::dot(glm::vec3(plane), p_vertex) + plane.w < 0.f)
+				outside = true;
+			else if (glm::dot(glm::vec3(plane), n_vertex) + plane.w >= 0.f)
+				mask &= ~(1u << i);
+		}
+		if (outside)
+			continue;
+
+		if (node.is_leaf()) {
+			if (mask == 0)
+				a_inside.push_back(node.user_data);
+			else
+				a_intersecting.push_back(node.user_data);
+			continue;
+		}
+
+		if (mask == 0) {
+			// Whole subtree is visible, no more plane tests needed.
+			std::vector<int> sub_stack{ node_id };
+			while (!sub_stack.empty()) {
+				const Node& sub_node = m_nodes[sub_stack.back()];
+				sub_stack.pop_back();
+				if (sub_node.is_leaf()) {
+					a_inside.push_back(sub_node.user_data);
+				}
+				else {
+					sub_stack.push_back(sub_node.child1);
+					sub_stack.push_back(sub_node.child2);
+				}
+			}
+			continue;
+		}
+
+		stack.emplace_back(node.child1, mask);
+		stack.emplace_back(node.child2, mask);
+	}
+}
+
+void DynamicBVH::query_sphere(const BoundingSphere& a_sphere, std::vector<std::uint32_t>& a_out) const {
+	a_out.clear();
+	if (m_root == g_bvh_null_node)
+		return;
+
+	const float radius2 = a_sphere.radius * a_sphere.radius;
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(m_root);
+
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (distance2(node.aabb, a_sphere.center) > radius2)
+			continue;
+
+		if (node.is_leaf()) {
+			a_out.push_back(node.user_data);
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+void DynamicBVH::query_ray(const glm::vec3& a_origin, const glm::vec3& a_dir, float a_max_dist, std::vector<RayHit>& a_out) const {
+	a_out.clear();
+	if (m_root == g_bvh_null_node)
+		return;
+
+	// Division by zero gives infinities which slab test handles fine.
+	glm::vec3 inv_dir = 1.0f / a_dir;
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(m_root);
+
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		float tmin{};
+		if (!node.aabb.intersects_ray(a_origin, inv_dir, a_max_dist, tmin))
+			continue;
+
+		if (node.is_leaf()) {
+			a_out.push_back(RayHit{ node.user_data, tmin });
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+
+	std::sort(a_out.begin(), a_out.end(), [](const RayHit& a_hit1, const RayHit& a_hit2) {
+		return a_hit1.distance < a_hit2.distance;
+		});
+}
+
+// Best first search, nodes are visited in order of distance from a_point to their box.
+void DynamicBVH::query_nearest(const glm::vec3& a_point, std::size_t a_k, float a_max_dist, std::vector<std::uint32_t>& a_out, const std::function<bool(std::uint32_t)>& a_filter) const {
+	a_out.clear();
+	if (m_root == g_bvh_null_node || a_k == 0)
+		return;
+
+	using Entry = std::pair<float, int>;
+	const float max_dist2 = a_max_dist * a_max_dist;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	queue.emplace(distance2(m_nodes[m_root].aabb, a_point), m_root);
+
+	while (!queue.empty() && a_out.size() < a_k) {
+		auto [dist2, node_id] = queue.top();
+		queue.pop();
+		if (dist2 > max_dist2)
+			break;
+
+		const Node& node = m_nodes[node_id];
+		if (node.is_leaf()) {
+			if (!a_filter || a_filter(node.user_data))
+				a_out.push_back(node.user_data);
+		}
+		else {
+			queue.emplace(distance2(m_nodes[node.child1].aabb, a_point), node.child1);
+			queue.emplace(distance2(m_nodes[node.child2].aabb, a_point), node.child2);
+		}
+	}
+}
+
+std::uint32_t DynamicBVH::get_user_data(int a_proxy) const noexcept {
+	return m_nodes[a_proxy].user_data;
+}
+
+const AABB& DynamicBVH::get_fat_aabb(int a_proxy) const noexcept {
+	return m_nodes[a_proxy].aabb;
+}
+
+int DynamicBVH::get_height() const noexcept {
+	return (m_root == g_bvh_null_node) ? 0 : m_nodes[m_root].height;
+}
+
+std::size_t DynamicBVH::get_proxy_count() const noexcept {
+	return m_proxy_count;
+}
+
+int DynamicBVH::alloc_node() {
+	if (m_free_list == g_bvh_null_node) {
+		m_nodes.emplace_back();
+		return static_cast<int>(m_nodes.size()) - 1;
+	}
+
+	int node_id = m_free_list;
+	m_free_list = m_nodes[node_id].parent;
+	m_nodes[node_id] = Node();
+	return node_id;
+}
+
+void DynamicBVH::free_node(int a_node) {
+	m_nodes[a_node].parent = m_free_list;
+	m_nodes[a_node].child1 = g_bvh_null_node;
+	m_nodes[a_node].child2 = g_bvh_null_node;
+	m_nodes[a_node].height = -1;
+	m_free_list = a_node;
+}
+
+AABB DynamicBVH::fatten(const AABB& a_aabb) const noexcept {
+	AABB ret = a_aabb;
+	glm::vec3 margin = glm::vec3(m_margin) + a_aabb.get_extent() * 0.1f;
+	ret.min -= margin;
+	ret.max += margin;
+	return ret;
+}
+
+// Walk down choosing the child with smaller cost increase until creating a new parent here is cheaper.
+void DynamicBVH::insert_leaf(int a_leaf) {
+	if (m_root == g_bvh_null_node) {
+		m_root = a_leaf;
+		m_nodes[a_leaf].parent = g_bvh_null_node;
+		return;
+	}
+
+	const AABB leaf_aabb = m_nodes[a_leaf].aabb;
+	int sibling = m_root;
+	while (!m_nodes[sibling].is_leaf()) {
+		const Node& node = m_nodes[sibling];
+		float area = node.aabb.get_surface_area();
+		float combined_area = merge(node.aabb, leaf_aabb).get_surface_area();
+
+		float cost = 2.f * combined_area;
+		float inheritance_cost = 2.f * (combined_area - area);
+
+		auto child_cost = [&](int a_child) {
+				const Node& child = m_nodes[a_child];
+				float new_area = merge(child.aabb, leaf_aabb).get_surface_area();
+				if (child.is_leaf())
+					return new_area + inheritance_cost;
+				return new_area - child.aabb.get_surface_area() + inheritance_cost;
+			};
+		float cost1 = child_cost(node.child1);
+		float cost2 = child_cost(node.child2);
+
+		if (cost < cost1 && cost < cost2)
+			break;
+		sibling = (cost1 < cost2) ? node.child1 : node.child2;
+	}
+
+	int old_parent = m_nodes[sibling].parent;
+	int new_parent = alloc_node();
+	m_nodes[new_parent].parent = old_parent;
+	m_nodes[new_parent].aabb = merge(leaf_aabb, m_nodes[sibling].aabb);
+	m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+	m_nodes[new_parent].child1 = sibling;
+	m_nodes[new_parent].child2 = a_leaf;
+	m_nodes[sibling].parent = new_parent;
+	m_nodes[a_leaf].parent = new_parent;
+
+	if (old_parent == g_bvh_null_node) {
+		m_root = new_parent;
+	}
+	else {
+		if (m_nodes[old_parent].child1 == sibling)
+			m_nodes[old_parent].child1 = new_parent;
+		else
+			m_nodes[old_parent].child2 = new_parent;
+	}
+
+	refit(new_parent);
+}
+
+void DynamicBVH::remove_leaf(int a_leaf) {
+	if (a_leaf == m_root) {
+		m_root = g_bvh_null_node;
+		return;
+	}
+
+	int parent = m_nodes[a_leaf].parent;
+	int grand_parent = m_nodes[parent].parent;
+	int sibling = (m_nodes[parent].child1 == a_leaf) ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	if (grand_parent == g_bvh_null_node) {
+		m_root = sibling;
+		m_nodes[sibling].parent = g_bvh_null_node;
+		free_node(parent);
+		return;
+	}
+
+	if (m_nodes[grand_parent].child1 == parent)
+		m_nodes[grand_parent].child1 = sibling;
+	else
+		m_nodes[grand_parent].child2 = sibling;
+	m_nodes[sibling].parent = grand_parent;
+	free_node(parent);
+
+	refit(grand_parent);
+}
+
+void DynamicBVH::refit(int a_node) {
+	while (a_node != g_bvh_null_node) {
+		Node& node = m_nodes[a_node];
+		const Node& child1 = m_nodes[node.child1];
+		const Node& child2 = m_nodes[node.child2];
+		node.aabb = merge(child1.aabb, child2.aabb);
+		node.height = 1 + std::max(child1.height, child2.height);
+
+		rotate(a_node);
+		a_node = m_nodes[a_node].parent;
+	}
+}
+
+// Swap a child with one of its grandchildren across the tree when it shrinks the surface area of the
+// inner node whose box changes. Box of a_node stays the same, only its subtree layout is improved.
+void DynamicBVH::rotate(int a_node) {
+	Node& A = m_nodes[a_node];
+	if (A.height < 2)
+		return;
+
+	int iB = A.child1;
+	int iC = A.child2;
+	Node& B = m_nodes[iB];
+	Node& C = m_nodes[iC];
+
+	enum class Rotation { NONE, B_F, B_G, C_D, C_E } best = Rotation::NONE;
+	float best_cost = 0.f;
+
+	if (!C.is_leaf()) {
+		float area_C = C.aabb.get_surface_area();
+		const AABB& F = m_nodes[C.child1].aabb;
+		const AABB& G = m_nodes[C.child2].aabb;
+
+		if (float cost = merge(B.aabb, G).get_surface_area() - area_C; cost < best_cost) {
+			best_cost = cost;
+			best = Rotation::B_F;
+		}
+		if (float cost = merge(B.aabb, F).get_surface_area() - area_C; cost < best_cost) {
+			best_cost = cost;
+			best = Rotation::B_G;
+		}
+	}
+
+	if (!B.is_leaf()) {
+		float area_B = B.aabb.get_surface_area();
+		const AABB& D = m_nodes[B.child1].aabb;
+		const AABB& E = m_nodes[B.child2].aabb;
+
+		if (float cost = merge(C.aabb, E).get_surface_area() - area_B; cost < best_cost) {
+			best_cost = cost;
+			best = Rotation::C_D;
+		}
+		if (float cost = merge(C.aabb, D).get_surface_area() - area_B; cost < best_cost) {
+			best_cost = cost;
+			best = Rotation::C_E;
+		}
+	}
+
+	auto swap_child = [this](Node& a_parent, int a_parent_id, int& a_slot, int a_inner_id, int& a_inner_slot) {
+			// a_slot (child of a_parent) <-> a_inner_slot (grandchild through a_inner_id)
+			int outer = a_slot;
+			int inner = a_inner_slot;
+			a_slot = inner;
+			a_inner_slot = outer;
+			m_nodes[inner].parent = a_parent_id;
+			m_nodes[outer].parent = a_inner_id;
+
+			Node& inner_node = m_nodes[a_inner_id];
+			inner_node.aabb = merge(m_nodes[inner_node.child1].aabb, m_nodes[inner_node.child2].aabb);
+			inner_node.height = 1 + std::max(m_nodes[inner_node.child1].height, m_nodes[inner_node.child2].height);
+			a_parent.height = 1 + std::max(m_nodes[a_parent.child1].height, m_nodes[a_parent.child2].height);
+		};
+
+	switch (best) {
+	case Rotation::NONE: break;
+	case Rotation::B_F: swap_child(A, a_node, A.child1, iC, C.child1); break;
+	case Rotation::B_G: swap_child(A, a_node, A.child1, iC, C.child2); break;
+	case Rotation::C_D: swap_child(A, a_node, A.child2, iB, B.child1); break;
+	case Rotation::C_E: swap_child(A, a_node, A.child2, iB, B.child2); break;
+	}
+}
+}
@@ -0,0 +1,165 @@
+#include <glm/gtc/type_ptr.hpp>
+
+#include "chill_renderer/command_buffer.hpp"
+
+namespace chill_renderer {
+static void set_cap(GLenum a_cap, bool a_enabled) {
+	if (a_enabled)
+		glEnable(a_cap);
+	else
+		glDisable(a_cap);
+}
+
+void CommandBuffer::use_program(const ShaderProgram& a_shader) {
+	push(Command::USE_PROGRAM, ProgramCmd{ a_shader.get_id(),
+		a_shader.is_state(ShaderState::DEPTH_TEST), a_shader.is_state(ShaderState::STENCIL_TEST), a_shader.is_state(ShaderState::FACE_CULLING),
+		a_shader.is_state(ShaderState::POINT_SIZE), a_shader.is_state(ShaderState::GAMMA_CORRECTION) });
+}
+
+void CommandBuffer::set_state(ShaderState a_state, bool a_option) {
+	switch (a_state) {
+	case ShaderState::DEPTH_TEST:   push(Command::SET_STATE, StateCmd{ GL_DEPTH_TEST, a_option }); break;
+	case ShaderState::STENCIL_TEST: push(Command::SET_STATE, StateCmd{ GL_STENCIL_TEST, a_option }); break;
+	case ShaderState::FACE_CULLING: push(Command::SET_STATE, StateCmd{ GL_CULL_FACE, a_option }); break;
+	case ShaderState::POINT_SIZE:   push(Command::SET_STATE, StateCmd{ GL_PROGRAM_POINT_SIZE, a_option }); break;
+	case ShaderState::GAMMA_CORRECTION: push(Command::SET_STATE, StateCmd{ GL_FRAMEBUFFER_SRGB, a_option }); break;
+	}
+}
+
+void CommandBuffer::set_uniform(int a_location, int a_value) {
+	push(Command::UNIFORM_INT, UniformCmd<int>{ a_location, a_value });
+}
+
+void CommandBuffer::set_uniform(int a_location, float a_value) {
+	push(Command::UNIFORM_FLOAT, UniformCmd<float>{ a_location, a_value });
+}
+
+void CommandBuffer::set_uniform(int a_location, const glm::vec3& a_value) {
+	push(Command::UNIFORM_VEC3, UniformCmd<glm::vec3>{ a_location, a_value });
+}
+
+void CommandBuffer::set_uniform(int a_location, const glm::mat3& a_value) {
+	push(Command::UNIFORM_MAT3, UniformCmd<glm::mat3>{ a_location, a_value });
+}
+
+void CommandBuffer::set_uniform(int a_location, const glm::mat4& a_value) {
+	push(Command::UNIFORM_MAT4, UniformCmd<glm::mat4>{ a_location, a_value });
+}
+
+// Same as ShaderProgram::set_uniform(), samplers of missing maps keep their previous units.
+void CommandBuffer::set_material(const MaterialMap& a_material, const MaterialLocations& a_locations) {
+	auto set_maps = [this](const std::vector<Texture2D>& a_maps, const auto& a_map_locations) {
+		for (std::size_t i = 0; i < a_maps.size(); ++i) {
+			bind_texture(a_maps[i]);
+			if (i < a_map_locations.size())
+				set_uniform(a_map_locations[i], a_maps[i].get_unit_id());
+		}
+	};
+
+	set_maps(a_material.get_diffuse_maps(), a_locations.diffuse_maps);
+	set_maps(a_material.get_specular_maps(), a_locations.specular_maps);
+	set_maps(a_material.get_emission_maps(), a_locations.emission_maps);
+	set_uniform(a_locations.shininess, a_material.get_shininess());
+}
+
+void CommandBuffer::bind_texture(const Texture& a_texture) {
+	if (a_texture.get_type() != TextureType::NONE)
+		push(Command::BIND_TEXTURE, TextureCmd{ static_cast<GLenum>(GL_TEXTURE0 + a_texture.get_unit_id()), a_texture.get_gltype(), a_texture.get_id() });
+}
+
+void CommandBuffer::draw(const Mesh& a_mesh) {
+	if (a_mesh.get_visibility())
+		push(Command::DRAW, DrawCmd{ a_mesh.get_VAO(), static_cast<GLenum>(GL_POINTS + to_enum_elem_type(a_mesh.get_draw_mode())), a_mesh.get_element_count(), a_mesh.is_indexed(), a_mesh.get_wireframe() });
+}
+
+void CommandBuffer::draw(Model& a_model) {
+	for (const auto& mesh : a_model.get_meshes()) {
+		draw(mesh);
+	}
+}
+
+void CommandBuffer::draw(Model& a_model, const MaterialLocations& a_locations) {
+	for (auto& mesh : a_model.get_meshes()) {
+		set_material(mesh.get_material_map(), a_locations);
+		draw(mesh);
+	}
+}
+
+void CommandBuffer::execute() const {
+	const std::byte* pos = m_stream.data();
+	const std::byte* end = pos + m_stream.size();
+	while (pos < end) {
+		switch (read<Command>(pos)) {
+		case Command::USE_PROGRAM: {
+			auto cmd = read<ProgramCmd>(pos);
+			glUseProgram(cmd.program);
+			set_cap(GL_DEPTH_TEST, cmd.depth_test);
+			set_cap(GL_STENCIL_TEST, cmd.stencil_test);
+			set_cap(GL_CULL_FACE, cmd.face_culling);
+			set_cap(GL_PROGRAM_POINT_SIZE, cmd.point_size);
+			set_cap(GL_FRAMEBUFFER_SRGB, cmd.gamma_corr);
+			break;
+		}
+		case Command::SET_STATE: {
+			auto cmd = read<StateCmd>(pos);
+			set_cap(cmd.cap, cmd.enabled);
+			break;
+		}
+		case Command::UNIFORM_INT: {
+			auto cmd = read<UniformCmd<int>>(pos);
+			glUniform1i(cmd.location, cmd.value);
+			break;
+		}
+		case Command::UNIFORM_FLOAT: {
+			auto cmd = read<UniformCmd<float>>(pos);
+			glUniform1f(cmd.location, cmd.value);
+			break;
+		}
+		case Command::UNIFORM_VEC3: {
+			auto cmd = read<UniformCmd<glm::vec3>>(pos);
+			glUniform3fv(cmd.location, 1, glm::value_ptr(cmd.value));
+			break;
+		}
+		case Command::UNIFORM_MAT3: {
+			auto cmd = read<UniformCmd<glm::mat3>>(pos);
+			glUniformMatrix3fv(cmd.location, 1, GL_FALSE, glm::value_ptr(cmd.value));
+			break;
+		}
+		case Command::UNIFORM_MAT4: {
+			auto cmd = read<UniformCmd<glm::mat4>>(pos);
+			glUniformMatrix4fv(cmd.location, 1, GL_FALSE, glm::value_ptr(cmd.value));
+			break;
+		}
+		case Command::BIND_TEXTURE: {
+			auto cmd = read<TextureCmd>(pos);
+			glActiveTexture(cmd.unit);
+			glBindTexture(cmd.target, cmd.id);
+			break;
+		}
+		case Command::DRAW: {
+			auto cmd = read<DrawCmd>(pos);
+			glBindVertexArray(cmd.VAO);
+			glPolygonMode(GL_FRONT_AND_BACK, cmd.wireframe ? GL_LINE : GL_FILL);
+			if (cmd.indexed)
+				glDrawElements(cmd.mode, cmd.count, GL_UNSIGNED_INT, 0);
+			else
+				glDrawArrays(cmd.mode, 0, cmd.count);
+			break;
+		}
+		}
+	}
+	glBindVertexArray(0);
+}
+
+void CommandBuffer::clear() noexcept {
+	m_stream.clear();
+}
+
+bool CommandBuffer::is_empty() const noexcept {
+	return m_stream.empty();
+}
+
+std::size_t CommandBuffer::get_byte_size() const noexcept {
+	return m_stream.size();
+}
+}
@@ -0,0 +1,243 @@
+#include "chill_renderer/cooked_asset.hpp"
+#include "chill_renderer/texture_compression.hpp"
+#include "chill_renderer/file_manager.hpp"
+
+#include <map>
+#include <cwctype>
+#include <format>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+namespace chill_renderer {
+namespace fs = std::filesystem;
+
+static std::uint64_t align_up(std::uint64_t a_offset) {
+	return (a_offset + g_cooked_align - 1) & ~(g_cooked_align - 1);
+}
+
+bool is_cooked_file(const std::wstring& a_path) {
+	std::wstring ext = fs::path(a_path).extension().wstring();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+	return ext == g_cooked_extension;
+}
+
+void cook_model(const ModelImport& a_import, const fs::path& a_out_path) {
+	// Data blocks, offsets are relative to its start until tables are laid out.
+	std::vector<unsigned char> blob;
+	auto append = [&blob](const void* a_data, std::size_t a_siz) {
+		blob.resize(align_up(blob.size()));
+		std::uint64_t offset = blob.size();
+		const auto* bytes = static_cast<const unsigned char*>(a_data);
+		blob.insert(blob.end(), bytes, bytes + a_siz);
+		return offset;
+	};
+
+	CookedHeader header;
+	header.magic = g_cooked_magic;
+	header.version = g_cooked_version;
+	header.flags = a_import.flip_UVs ? static_cast<std::uint32_t>(COOKED_FLIPPED_UVS) : 0u;
+
+	AABB bounds;
+	std::vector<CookedMesh> meshes;
+	for (const auto& mesh_import : a_import.meshes) {
+		const BufferData& data = mesh_import.data;
+		AABB aabb;
+		for (const auto& pos : data.positions) {
+			aabb.expand(pos);
+		}
+		bounds.expand(aabb);
+
+		CookedMesh mesh;
+		mesh.material_idx = static_cast<std::uint32_t>(mesh_import.material_idx);
+		mesh.position_siz = static_cast<std::uint32_t>(data.positions.size());
+		mesh.UV_siz = static_cast<std::uint32_t>(data.UVs.size());
+		mesh.normal_siz = static_cast<std::uint32_t>(data.normals.size());
+		mesh.index_siz = static_cast<std::uint32_t>(data.indicies.size());
+		mesh.bounds_min = aabb.min;
+		mesh.bounds_max = aabb.max;
+		mesh.positions_offset = append(data.positions.data(), data.positions.size() * sizeof(glm::vec3));
+		mesh.UVs_offset = append(data.UVs.data(), data.UVs.size() * sizeof(glm::vec2));
+		mesh.normals_offset = append(data.normals.data(), data.normals.size() * sizeof(glm::vec3));
+		mesh.indicies_offset = append(data.indicies.data(), data.indicies.size() * sizeof(unsigned int));
+		meshes.push_back(mesh);
+	}
+	if (bounds.is_valid()) {
+		header.bounds_min = bounds.min;
+		header.bounds_max = bounds.max;
+	}
+
+	// Materials sharing image share its texture entry.
+	std::vector<CookedTexture> textures;
+	std::vector<CookedMaterial> materials;
+	std::vector<CookedMaterialTexture> material_textures;
+	std::map<std::wstring, std::uint32_t> texture_indicies;
+	for (const auto& tex_imports : a_import.materials) {
+		materials.push_back({ static_cast<std::uint32_t>(material_textures.size()), static_cast<std::uint32_t>(tex_imports.size()) });
+		for (const auto& tex_import : tex_imports) {
+			auto [it, inserted] = texture_indicies.try_emplace(tex_import.path, static_cast<std::uint32_t>(textures.size()));
+			material_textures.push_back({ it->second, static_cast<std::uint32_t>(tex_import.type), tex_import.unit_id, 0 });
+			if (!inserted)
+				continue;
+
+			CookedTexture texture;
+			std::u8string path = fs::path(tex_import.path).u8string();
+			texture.path_offset = append(path.data(), path.size());
+			texture.path_siz = path.size();
+
+			// Same flags as Model::build() loads textures with.
+			TextureImage image = load_texture_image(tex_import.path, false, true);
+			if (auto* compressed = std::get_if<CompressedImage>(&image)) {
+				texture.format = static_cast<std::uint32_t>(compressed->format);
+				texture.level_siz = static_cast<std::uint32_t>(compressed->levels.size());
+				texture.width = static_cast<std::uint32_t>(compressed->levels[0].width);
+				texture.height = static_cast<std::uint32_t>(compressed->levels[0].height);
+				texture.data_siz = compressed->get_byte_size();
+				texture.data_offset = append(compressed->get_data(), compressed->get_byte_size());
+			}
+			else {
+				ERROR(std::format("[COOK_MODEL] {} can't be block compressed, it's referenced by path.", wstos(tex_import.path)), Error_action::logging);
+			}
+			textures.push_back(texture);
+		}
+	}
+
+	header.mesh_siz = static_cast<std::uint32_t>(meshes.size());
+	header.material_siz = static_cast<std::uint32_t>(materials.size());
+	header.material_texture_siz = static_cast<std::uint32_t>(material_textures.size());
+	header.texture_siz = static_cast<std::uint32_t>(textures.size());
+	header.meshes_offset = align_up(sizeof(header));
+	header.materials_offset = align_up(header.meshes_offset + meshes.size() * sizeof(CookedMesh));
+	header.material_textures_offset = align_up(header.materials_offset + materials.size() * sizeof(CookedMaterial));
+	header.textures_offset = align_up(header.material_textures_offset + material_textures.size() * sizeof(CookedMaterialTexture));
+	std::uint64_t blob_offset = align_up(header.textures_offset + textures.size() * sizeof(CookedTexture));
+
+	for (auto& mesh : meshes) {
+		mesh.positions_offset += blob_offset;
+		mesh.UVs_offset += blob_offset;
+		mesh.normals_offset += blob_offset;
+		mesh.indicies_offset += blob_offset;
+	}
+	for (auto& texture : textures) {
+		texture.path_offset += blob_offset;
+		if (texture.level_siz > 0)
+			texture.data_offset += blob_offset;
+	}
+
+	std::vector<unsigned char> file(blob_offset);
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + header.meshes_offset, meshes.data(), meshes.size() * sizeof(CookedMesh));
+	std::memcpy(file.data() + header.materials_offset, materials.data(), materials.size() * sizeof(CookedMaterial));
+	std::memcpy(file.data() + header.material_textures_offset, material_textures.data(), material_textures.size() * sizeof(CookedMaterialTexture));
+	std::memcpy(file.data() + header.textures_offset, textures.data(), textures.size() * sizeof(CookedTexture));
+
+	std::ofstream out(a_out_path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+	out.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+	if (!out) {
+		ERROR(std::format("[COOK_MODEL] Couldn't write {}", wstos(a_out_path.wstring())), Error_action::throwing);
+	}
+}
+
+CookedAsset::CookedAsset(const std::wstring& a_path) {
+	fs::path p = guess_path(a_path);
+	if (p == fs::path()) {
+		ERROR(std::format("[COOKEDASSET::COOKEDASSET] Bad cooked asset path: {}", wstos(a_path)), Error_action::throwing);
+	}
+
+	m_path = p.wstring();
+	m_file = MappedFile(m_path);
+	if (m_file.get_size() < sizeof(CookedHeader)) {
+		ERROR(std::format("[COOKEDASSET::COOKEDASSET] {} is truncated.", wstos(m_path)), Error_action::throwing);
+	}
+
+	m_header = reinterpret_cast<const CookedHeader*>(m_file.get_data());
+	if (m_header->magic != g_cooked_magic || m_header->version != g_cooked_version) {
+		ERROR(std::format("[COOKEDASSET::COOKEDASSET] {} isn't cooked asset of version {}, cook it again.", wstos(m_path), g_cooked_version), Error_action::throwing);
+	}
+
+	// Tables are checked once here, their accessors trust them afterwards.
+	get_array<CookedMesh>(m_header->meshes_offset, m_header->mesh_siz);
+	get_array<CookedTexture>(m_header->textures_offset, m_header->texture_siz);
+	for (const auto& material : get_array<CookedMaterial>(m_header->materials_offset, m_header->material_siz)) {
+		if (static_cast<std::uint64_t>(material.first_texture) + material.texture_siz > m_header->material_texture_siz) {
+			ERROR(std::format("[COOKEDASSET::COOKEDASSET] {} has bad material.", wstos(m_path)), Error_action::throwing);
+		}
+	}
+	for (const auto& texture : get_array<CookedMaterialTexture>(m_header->material_textures_offset, m_header->material_texture_siz)) {
+		if (texture.texture_idx >= m_header->texture_siz) {
+			ERROR(std::format("[COOKEDASSET::COOKEDASSET] {} has bad material texture.", wstos(m_path)), Error_action::throwing);
+		}
+	}
+}
+
+template<typename T>
+std::span<const T> CookedAsset::get_array(std::uint64_t a_offset, std::uint64_t a_siz) const {
+	if (a_offset % alignof(T) != 0 || a_offset > m_file.get_size() || a_siz > (m_file.get_size() - a_offset) / sizeof(T)) {
+		ERROR(std::format("[COOKEDASSET::GET_ARRAY] {} has range out of file bounds.", wstos(m_path)), Error_action::throwing);
+	}
+	return { reinterpret_cast<const T*>(m_file.get_data() + a_offset), static_cast<std::size_t>(a_siz) };
+}
+
+MeshView CookedAsset::get_mesh_view(const CookedMesh& a_mesh) const {
+	MeshView view;
+	view.positions = get_array<glm::vec3>(a_mesh.positions_offset, a_mesh.position_siz);
+	view.UVs = get_array<glm::vec2>(a_mesh.UVs_offset, a_mesh.UV_siz);
+	view.normals = get_array<glm::vec3>(a_mesh.normals_offset, a_mesh.normal_siz);
+	view.indicies = get_array<unsigned int>(a_mesh.indicies_offset, a_mesh.index_siz);
+	if (!view.positions.empty())
+		view.aabb = AABB{ a_mesh.bounds_min, a_mesh.bounds_max };
+	return view;
+}
+
+CompressedImage CookedAsset::get_image(const CookedTexture& a_texture) const {
+	int width = static_cast<int>(a_texture.width);
+	int height = static_cast<int>(a_texture.height);
+	int levels = static_cast<int>(a_texture.level_siz);
+	if (a_texture.format > static_cast<std::uint32_t>(BlockFormat::BC7) || !is_valid_block_levels(width, height, levels)) {
+		ERROR(std::format("[COOKEDASSET::GET_IMAGE] {} has bad texture.", wstos(m_path)), Error_action::throwing);
+	}
+
+	CompressedImage image;
+	image.format = static_cast<BlockFormat>(a_texture.format);
+	std::size_t bytes = set_block_levels(image, width, height, levels);
+	if (bytes != a_texture.data_siz) {
+		ERROR(std::format("[COOKEDASSET::GET_IMAGE] {} has texture of unexpected size.", wstos(m_path)), Error_action::throwing);
+	}
+	image.mapped = get_array<unsigned char>(a_texture.data_offset, a_texture.data_siz).data();
+	return image;
+}
+
+std::wstring CookedAsset::get_texture_path(const CookedTexture& a_texture) const {
+	auto bytes = get_array<char>(a_texture.path_offset, a_texture.path_siz);
+	return fs::path(std::u8string(reinterpret_cast<const char8_t*>(bytes.data()), bytes.size())).wstring();
+}
+
+const CookedHeader& CookedAsset::get_header() const noexcept {
+	return *m_header;
+}
+
+std::span<const CookedMesh> CookedAsset::get_meshes() const noexcept {
+	return { reinterpret_cast<const CookedMesh*>(m_file.get_data() + m_header->meshes_offset), m_header->mesh_siz };
+}
+
+std::span<const CookedMaterial> CookedAsset::get_materials() const noexcept {
+	return { reinterpret_cast<const CookedMaterial*>(m_file.get_data() + m_header->materials_offset), m_header->material_siz };
+}
+
+std::span<const CookedMaterialTexture> CookedAsset::get_material_textures() const noexcept {
+	return { reinterpret_cast<const CookedMaterialTexture*>(m_file.get_data() + m_header->material_textures_offset), m_header->material_texture_siz };
+}
+
+std::span<const CookedTexture> CookedAsset::get_textures() const noexcept {
+	return { reinterpret_cast<const CookedTexture*>(m_file.get_data() + m_header->textures_offset), m_header->texture_siz };
+}
+
+std::wstring CookedAsset::get_path() const noexcept {
+	return m_path;
+}
+
+std::size_t CookedAsset::get_byte_size() const noexcept {
+	return m_file.get_size();
+}
+}
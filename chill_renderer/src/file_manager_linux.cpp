@@ -3,6 +3,11 @@
 #include <utility> // pair
 #include <filesystem>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "chill_renderer/file_manager.hpp"
 #include "chill_renderer/assert.hpp" // GenericException
 
@@ -16,4 +21,69 @@ std::wstring basic_file_open(const std::wstring& a_title, const std::vector<std:
 	throw GenericException("LINUX FILE DIALOG IMPLEMENTATION IS NOT READY.\n");
 	return L"";
 } 
+
+MappedFile::MappedFile(const std::wstring& a_path) {
+	std::string path = wstos(a_path);
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Couldn't open " + path);
+
+	struct stat info{};
+	if (fstat(fd, &info) == -1 || info.st_size == 0) {
+		close(fd);
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Empty or unreadable file " + path);
+	}
+
+	void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// Mapping keeps file referenced.
+	close(fd);
+	if (data == MAP_FAILED)
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Couldn't map " + path);
+
+	// Whole file is uploaded right away, read ahead instead of faulting page by page.
+	madvise(data, info.st_size, MADV_WILLNEED);
+	m_data = static_cast<const unsigned char*>(data);
+	m_size = static_cast<std::size_t>(info.st_size);
+}
+
+MappedFile::MappedFile(MappedFile&& a_file) noexcept
+	:m_data{ a_file.m_data }, m_size{ a_file.m_size }, m_handle{ a_file.m_handle }
+{
+	a_file.m_data = nullptr;
+	a_file.m_size = 0;
+	a_file.m_handle = nullptr;
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& a_file) noexcept {
+	if (this == &a_file)
+		return *this;
+
+	unmap();
+	m_data = a_file.m_data;
+	m_size = a_file.m_size;
+	m_handle = a_file.m_handle;
+	a_file.m_data = nullptr;
+	a_file.m_size = 0;
+	a_file.m_handle = nullptr;
+	return *this;
+}
+
+const unsigned char* MappedFile::get_data() const noexcept {
+	return m_data;
+}
+
+std::size_t MappedFile::get_size() const noexcept {
+	return m_size;
+}
+
+void MappedFile::unmap() noexcept {
+	if (m_data)
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+	m_data = nullptr;
+	m_size = 0;
+}
 }
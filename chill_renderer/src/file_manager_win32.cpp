@@ -73,4 +73,76 @@ std::wstring basic_file_open(const std::wstring& a_title, const std::vector<std:
 
 	return ret_filepath;
 } 
-}
\ No newline at end of file
+
+MappedFile::MappedFile(const std::wstring& a_path) {
+	HANDLE file = CreateFileW(a_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Couldn't open " + wstos(a_path));
+
+	LARGE_INTEGER siz{};
+	if (!GetFileSizeEx(file, &siz) || siz.QuadPart == 0) {
+		CloseHandle(file);
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Empty or unreadable file " + wstos(a_path));
+	}
+
+	// Mapping object keeps file referenced.
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Couldn't map " + wstos(a_path));
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		CloseHandle(mapping);
+		throw GenericException("[MAPPEDFILE::MAPPEDFILE] Couldn't map " + wstos(a_path));
+	}
+
+	m_data = static_cast<const unsigned char*>(data);
+	m_size = static_cast<std::size_t>(siz.QuadPart);
+	m_handle = mapping;
+}
+
+MappedFile::MappedFile(MappedFile&& a_file) noexcept
+	:m_data{ a_file.m_data }, m_size{ a_file.m_size }, m_handle{ a_file.m_handle }
+{
+	a_file.m_data = nullptr;
+	a_file.m_size = 0;
+	a_file.m_handle = nullptr;
+}
+
+MappedFile::~MappedFile() {
+	unmap();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& a_file) noexcept {
+	if (this == &a_file)
+		return *this;
+
+	unmap();
+	m_data = a_file.m_data;
+	m_size = a_file.m_size;
+	m_handle = a_file.m_handle;
+	a_file.m_data = nullptr;
+	a_file.m_size = 0;
+	a_file.m_handle = nullptr;
+	return *this;
+}
+
+const unsigned char* MappedFile::get_data() const noexcept {
+	return m_data;
+}
+
+std::size_t MappedFile::get_size() const noexcept {
+	return m_size;
+}
+
+void MappedFile::unmap() noexcept {
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_handle)
+		CloseHandle(m_handle);
+	m_data = nullptr;
+	m_size = 0;
+	m_handle = nullptr;
+}
+}
@@ -0,0 +1,104 @@
+#include "chill_renderer/gl_objects.hpp"
+#include "chill_renderer/assert.hpp"
+
+namespace chill_renderer {
+GLObjects::~GLObjects() {
+	for (auto& frame : m_frames) {
+		glDeleteSync(frame.fence);
+		delete_names(frame.released);
+	}
+	m_frames.clear();
+	delete_names(m_released);
+	delete_names(m_free);
+}
+
+GLuint GLObjects::gen(GLObjectType a_type) {
+	auto& pool = m_free[static_cast<std::size_t>(a_type)];
+	if (pool.empty()) {
+		pool.resize(g_gl_name_batch);
+		switch (a_type) {
+		case GLObjectType::BUFFER:        glGenBuffers(g_gl_name_batch, pool.data()); break;
+		case GLObjectType::VERTEX_ARRAY:  glGenVertexArrays(g_gl_name_batch, pool.data()); break;
+		case GLObjectType::TEXTURE:       glGenTextures(g_gl_name_batch, pool.data()); break;
+		case GLObjectType::RENDER_BUFFER: glGenRenderbuffers(g_gl_name_batch, pool.data()); break;
+		case GLObjectType::FRAME_BUFFER:  glGenFramebuffers(g_gl_name_batch, pool.data()); break;
+		default:
+			pool.clear();
+			ERROR("[GLOBJECTS::GEN] Object type has no pooled names.", Error_action::throwing);
+		}
+	}
+
+	GLuint id = pool.back();
+	pool.pop_back();
+	return id;
+}
+
+void GLObjects::release(GLObjectType a_type, GLuint a_id) {
+	if (a_id != 0)
+		m_released[static_cast<std::size_t>(a_type)].push_back(a_id);
+}
+
+void GLObjects::end_frame() {
+	// Fences signal in order, first unsignaled one means the rest isn't done either.
+	while (!m_frames.empty()) {
+		GLenum status = glClientWaitSync(m_frames.front().fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(m_frames.front().fence);
+		delete_names(m_frames.front().released);
+		m_frames.pop_front();
+	}
+
+	bool released = false;
+	for (const auto& ids : m_released) {
+		released |= !ids.empty();
+	}
+	if (released) {
+		m_frames.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(m_released) });
+		m_released = Names{};
+	}
+}
+
+std::size_t GLObjects::get_pending() const noexcept {
+	std::size_t pending{};
+	for (const auto& frame : m_frames) {
+		for (const auto& ids : frame.released) {
+			pending += ids.size();
+		}
+	}
+	for (const auto& ids : m_released) {
+		pending += ids.size();
+	}
+	return pending;
+}
+
+void GLObjects::delete_names(Names& a_names) {
+	for (std::size_t i = 0; i < a_names.size(); ++i) {
+		auto& ids = a_names[i];
+		if (ids.empty())
+			continue;
+
+		GLsizei siz = static_cast<GLsizei>(ids.size());
+		switch (static_cast<GLObjectType>(i)) {
+		case GLObjectType::BUFFER:        glDeleteBuffers(siz, ids.data()); break;
+		case GLObjectType::VERTEX_ARRAY:  glDeleteVertexArrays(siz, ids.data()); break;
+		case GLObjectType::TEXTURE:       glDeleteTextures(siz, ids.data()); break;
+		case GLObjectType::RENDER_BUFFER: glDeleteRenderbuffers(siz, ids.data()); break;
+		case GLObjectType::FRAME_BUFFER:  glDeleteFramebuffers(siz, ids.data()); break;
+		case GLObjectType::SHADER:
+			for (GLuint id : ids) {
+				glDeleteShader(id);
+			}
+			break;
+		case GLObjectType::PROGRAM:
+			for (GLuint id : ids) {
+				glDeleteProgram(id);
+			}
+			break;
+		default: break;
+		}
+		ids.clear();
+	}
+}
+}
@@ -0,0 +1,123 @@
+#include "chill_renderer/handle_pool.hpp"
+#include "chill_renderer/assert.hpp"
+
+namespace chill_renderer {
+bool ResourceHandle::is_empty() const noexcept {
+	return index == g_empty_handle;
+}
+
+ResourceHandle HandlePool::acquire(GLuint a_id) {
+	std::uint32_t idx{};
+	if (!m_free.empty()) {
+		idx = m_free.back();
+		m_free.pop_back();
+	}
+	else {
+		if (m_siz == g_handle_chunk_siz * g_handle_max_chunks)
+			ERROR("[HANDLEPOOL::ACQUIRE] Out of resource handles.", Error_action::throwing);
+
+		idx = m_siz++;
+		auto& chunk = m_chunks[idx / g_handle_chunk_siz];
+		if (!chunk)
+			chunk = std::make_unique<Slot[]>(g_handle_chunk_siz);
+	}
+
+	Slot& slot = get_slot(idx);
+	slot.id = a_id;
+	slot.live = true;
+	slot.refs = 1;
+	slot.bytes = 0;
+	slot.last_used = 0;
+	return ResourceHandle{ idx, slot.generation };
+}
+
+// Bumped generation invalidates every handle still pointing at slot.
+void HandlePool::release(ResourceHandle a_handle) noexcept {
+	if (!is_valid(a_handle))
+		return;
+
+	Slot& slot = get_slot(a_handle.index);
+	slot.live = false;
+	slot.refs = 0;
+	m_bytes -= slot.bytes;
+	slot.bytes = 0;
+	slot.generation++;
+	m_free.push_back(a_handle.index);
+}
+
+void HandlePool::inc(ResourceHandle a_handle) noexcept {
+	if (!is_valid(a_handle))
+		return;
+#if defined(CHILL_ATOMIC_REF_COUNTS)
+	get_slot(a_handle.index).refs.fetch_add(1, std::memory_order_relaxed);
+#else
+	get_slot(a_handle.index).refs++;
+#endif
+}
+
+int HandlePool::dec(ResourceHandle a_handle) noexcept {
+	if (!is_valid(a_handle))
+		return 0;
+#if defined(CHILL_ATOMIC_REF_COUNTS)
+	return get_slot(a_handle.index).refs.fetch_sub(1, std::memory_order_acq_rel);
+#else
+	return get_slot(a_handle.index).refs--;
+#endif
+}
+
+void HandlePool::set_bytes(ResourceHandle a_handle, std::size_t a_bytes) noexcept {
+	if (!is_valid(a_handle))
+		return;
+
+	Slot& slot = get_slot(a_handle.index);
+	m_bytes = m_bytes - slot.bytes + a_bytes;
+	slot.bytes = a_bytes;
+}
+
+void HandlePool::touch(ResourceHandle a_handle, std::uint64_t a_frame) noexcept {
+	if (is_valid(a_handle))
+		get_slot(a_handle.index).last_used = a_frame;
+}
+
+bool HandlePool::is_valid(ResourceHandle a_handle) const noexcept {
+	if (a_handle.index >= m_siz)
+		return false;
+
+	const Slot& slot = get_slot(a_handle.index);
+	return slot.live && slot.generation == a_handle.generation;
+}
+
+GLuint HandlePool::get_id(ResourceHandle a_handle) const noexcept {
+	return is_valid(a_handle) ? get_slot(a_handle.index).id : 0;
+}
+
+int HandlePool::get_ref_count(ResourceHandle a_handle) const noexcept {
+	return is_valid(a_handle) ? static_cast<int>(get_slot(a_handle.index).refs) : 0;
+}
+
+std::size_t HandlePool::get_bytes(ResourceHandle a_handle) const noexcept {
+	return is_valid(a_handle) ? get_slot(a_handle.index).bytes : 0;
+}
+
+std::uint64_t HandlePool::get_last_used(ResourceHandle a_handle) const noexcept {
+	return is_valid(a_handle) ? get_slot(a_handle.index).last_used : 0;
+}
+
+std::size_t HandlePool::get_total_bytes() const noexcept {
+	return m_bytes;
+}
+
+std::vector<std::pair<GLuint, int>> HandlePool::get_live() const {
+	std::vector<std::pair<GLuint, int>> live;
+	for (std::uint32_t i = 0; i < m_siz; ++i) {
+		const Slot& slot = get_slot(i);
+		if (slot.live)
+			live.emplace_back(slot.id, static_cast<int>(slot.refs));
+	}
+	return live;
+}
+
+HandlePool::Slot& HandlePool::get_slot(std::uint32_t a_idx) const noexcept {
+	return m_chunks[a_idx / g_handle_chunk_siz][a_idx % g_handle_chunk_siz];
+}
+}
@@ -0,0 +1,143 @@
+#include <bit>
+#include <array>
+#include <cstring>
+
+#include "chill_renderer/instance_batches.hpp"
+
+namespace chill_renderer {
+static constexpr std::size_t g_no_group = ~std::size_t(0);
+
+void InstanceBatches::clear() noexcept {
+	m_colors_used = false;
+	m_groups.clear();
+	m_group_sizes.clear();
+	m_entries.clear();
+}
+
+void InstanceBatches::push(Model& a_model) {
+	push_entry(a_model, glm::vec4(1.0f));
+}
+
+void InstanceBatches::push(Model& a_model, const glm::vec3& a_color) {
+	m_colors_used = true;
+	push_entry(a_model, glm::vec4(a_color, 1.0f));
+}
+
+void InstanceBatches::push_entry(Model& a_model, const glm::vec4& a_color) {
+	if (!make_key(a_model)) {
+		m_entries.push_back({ &a_model, a_color, g_no_group });
+		return;
+	}
+
+	auto it = m_groups.find(m_key);
+	if (it == m_groups.end()) {
+		it = m_groups.emplace(m_key, m_group_sizes.size()).first;
+		m_group_sizes.push_back(0);
+	}
+	m_group_sizes[it->second]++;
+	m_entries.push_back({ &a_model, a_color, it->second });
+}
+
+// Models draw the same if their meshes share buffers, draw state and material maps.
+// Mirrored models can't be batched, quaternion can't hold negative scale.
+bool InstanceBatches::make_key(Model& a_model) {
+	glm::vec3 siz = a_model.get_size();
+	if (siz.x <= 0.f || siz.y <= 0.f || siz.z <= 0.f)
+		return false;
+
+	m_key.clear();
+	for (auto& mesh : a_model.get_meshes()) {
+		m_key.push_back(mesh.get_VAO());
+		m_key.push_back(static_cast<std::uint64_t>(mesh.get_draw_mode()) << 2 | mesh.get_wireframe() << 1 | mesh.get_visibility());
+
+		const MaterialMap& material = mesh.get_material_map();
+		m_key.push_back(std::bit_cast<std::uint32_t>(material.get_shininess()));
+		// Pointers, copying maps would touch texture ref counts off render thread.
+		for (const auto* maps : std::array{ &material.get_diffuse_maps(), &material.get_specular_maps(), &material.get_emission_maps() }) {
+			m_key.push_back(maps->size());
+			for (const auto& map : *maps) {
+				m_key.push_back(map.get_id());
+			}
+		}
+	}
+	return !m_key.empty();
+}
+
+void InstanceBatches::build(std::vector<Model*>& a_singles, std::vector<glm::vec3>* a_single_colors) {
+	m_batches.clear();
+	m_group_batches.assign(m_group_sizes.size(), g_no_group);
+	m_instance_siz = 0;
+	for (std::size_t group = 0; group < m_group_sizes.size(); ++group) {
+		if (m_group_sizes[group] < g_batch_min_instances)
+			continue;
+		m_group_batches[group] = m_batches.size();
+		m_batches.push_back({ nullptr, static_cast<int>(m_instance_siz), 0 });
+		m_instance_siz += m_group_sizes[group];
+	}
+
+	for (const auto& entry : m_entries) {
+		if (entry.group != g_no_group && m_group_batches[entry.group] != g_no_group)
+			continue;
+		a_singles.push_back(entry.model);
+		if (a_single_colors)
+			a_single_colors->push_back(glm::vec3(entry.color));
+	}
+	if (m_instance_siz == 0)
+		return;
+
+	if (m_alignment == 0)
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &m_alignment);
+	const std::size_t alignment = static_cast<std::size_t>(m_alignment);
+
+	// Transforms and colors go into one write, so growing ring can't separate them.
+	std::size_t transforms_siz = m_instance_siz * sizeof(InstanceTransform);
+	std::size_t colors_offset = (transforms_siz + alignment - 1) / alignment * alignment;
+	m_staging.resize(m_colors_used ? colors_offset + m_instance_siz * sizeof(glm::vec4) : transforms_siz);
+	auto* transforms = reinterpret_cast<InstanceTransform*>(m_staging.data());
+	auto* colors = reinterpret_cast<glm::vec4*>(m_staging.data() + colors_offset);
+
+	for (const auto& entry : m_entries) {
+		if (entry.group == g_no_group || m_group_batches[entry.group] == g_no_group)
+			continue;
+		auto& batch = m_batches[m_group_batches[entry.group]];
+		if (!batch.model)
+			batch.model = entry.model;
+
+		std::size_t idx = batch.offset + batch.count++;
+		transforms[idx] = to_instance_transform(entry.model->get_model_mat());
+		if (m_colors_used)
+			colors[idx] = entry.color;
+	}
+
+	m_transforms_offset = m_stream_buf.write(m_staging.data(), m_staging.size(), alignment);
+	m_colors_offset = m_transforms_offset + colors_offset;
+}
+
+void InstanceBatches::draw(ShaderProgram& a_shader, const std::string& a_material_map_uniform_name) {
+	if (m_batches.empty())
+		return;
+
+	GLuint buf_id = m_stream_buf.get_id();
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, g_batch_transforms_binding, buf_id, m_transforms_offset, m_instance_siz * sizeof(InstanceTransform));
+	if (m_colors_used)
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, g_batch_colors_binding, buf_id, m_colors_offset, m_instance_siz * sizeof(glm::vec4));
+
+	for (const auto& batch : m_batches) {
+		a_shader["instance_offset"] = batch.offset;
+		for (auto& mesh : batch.model->get_meshes()) {
+			if (a_material_map_uniform_name != "")
+				a_shader.set_uniform(a_material_map_uniform_name, mesh.get_material_map());
+			mesh.draw_instances(batch.count);
+		}
+	}
+	m_stream_buf.fence();
+}
+
+std::size_t InstanceBatches::get_batch_count() const noexcept {
+	return m_batches.size();
+}
+
+std::size_t InstanceBatches::get_instance_count() const noexcept {
+	return m_instance_siz;
+}
+}
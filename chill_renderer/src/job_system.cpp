@@ -0,0 +1,302 @@
+#include <format>
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include "chill_renderer/job_system.hpp"
+#include "chill_renderer/assert.hpp"
+
+namespace chill_renderer {
+static thread_local const JobSystem* t_system = nullptr;
+static thread_local std::size_t t_worker_idx{};
+
+bool JobCounter::is_done() const noexcept {
+	return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+void JobProfiler::record(const JobTiming& a_timing) {
+	double ms = std::chrono::duration<double, std::milli>(a_timing.end - a_timing.begin).count();
+	std::lock_guard lock(m_mutex);
+	Entry& entry = m_recording[a_timing.name];
+	entry.count++;
+	entry.ms += ms;
+}
+
+void JobProfiler::end_frame() {
+	std::lock_guard lock(m_mutex);
+	m_frame.swap(m_recording);
+	m_recording.clear();
+}
+
+std::map<std::string, JobProfiler::Entry> JobProfiler::get_frame() const {
+	std::lock_guard lock(m_mutex);
+	return m_frame;
+}
+
+JobSystem::JobSystem(std::size_t a_threads_siz) {
+	std::size_t threads_siz = a_threads_siz ? a_threads_siz : std::max(1u, std::thread::hardware_concurrency());
+	for (std::size_t i = 0; i < threads_siz; ++i) {
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	t_system = this;
+	t_worker_idx = 0;
+	for (std::size_t i = 1; i < threads_siz; ++i) {
+		m_threads.emplace_back([this, i]() { worker_loop(i); });
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard lock(m_sleep_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_threads.clear();
+
+	if (t_system == this)
+		t_system = nullptr;
+}
+
+void JobSystem::submit(Task a_task, JobCounter* a_counter, const char* a_name) {
+	if (a_counter)
+		a_counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+	push({ std::move(a_task), a_counter, a_name });
+}
+
+void JobSystem::submit_background(Task a_task, JobCounter* a_counter, const char* a_name) {
+	if (a_counter)
+		a_counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+	Job job{ std::move(a_task), a_counter, a_name };
+	if (m_threads.empty()) {
+		run(job, get_worker_idx());
+		return;
+	}
+
+	{
+		std::lock_guard lock(m_background_mutex);
+		m_background.push_back(std::move(job));
+	}
+	m_queued.fetch_add(1, std::memory_order_release);
+
+	{ std::lock_guard lock(m_sleep_mutex); }
+	m_wake.notify_one();
+}
+
+void JobSystem::then(JobCounter& a_dependency, Task a_task, JobCounter* a_counter, const char* a_name) {
+	// Counted now, so waiting on a_counter also waits for continuations not submitted yet.
+	if (a_counter)
+		a_counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+	Job job{ std::move(a_task), a_counter, a_name };
+	{
+		std::lock_guard lock(a_dependency.m_mutex);
+		if (!a_dependency.is_done()) {
+			a_dependency.m_continuations.push_back([this, job = std::move(job)]() mutable { push(std::move(job)); });
+			return;
+		}
+	}
+	push(std::move(job));
+}
+
+void JobSystem::wait(JobCounter& a_counter) {
+	const std::size_t idx = get_worker_idx();
+	while (!a_counter.is_done()) {
+		Job job;
+		if (try_pop(idx, job) || try_steal(idx, job))
+			run(job, idx);
+		else
+			std::this_thread::yield();
+	}
+	// Last job decrements under this lock, it must release it before counter goes out of scope.
+	std::exception_ptr error;
+	{
+		std::lock_guard lock(a_counter.m_mutex);
+		error = std::exchange(a_counter.m_error, nullptr);
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void JobSystem::parallel_for(std::size_t a_begin, std::size_t a_end, std::size_t a_grain, const std::function<void(std::size_t, std::size_t)>& a_func, const char* a_name) {
+	if (a_begin >= a_end)
+		return;
+
+	const std::size_t siz = a_end - a_begin;
+	const std::size_t grain = std::max<std::size_t>(a_grain, 1);
+	if (siz <= grain || m_workers.size() == 1) {
+		a_func(a_begin, a_end);
+		return;
+	}
+
+	// Chunks are multiples of grain, so callers can keep them aligned to SIMD width or tiles.
+	std::size_t chunks = std::min((siz + grain - 1) / grain, m_workers.size() * g_jobs_chunks_per_worker);
+	std::size_t chunk = (siz + chunks - 1) / chunks;
+	chunk = (chunk + grain - 1) / grain * grain;
+
+	JobCounter counter;
+	for (std::size_t begin = a_begin + chunk; begin < a_end; begin += chunk) {
+		submit([&a_func, begin, end = std::min(begin + chunk, a_end)]() { a_func(begin, end); }, &counter, a_name);
+	}
+	// Submitted chunks reference a_func and counter, so wait even if this chunk throws.
+	std::exception_ptr error;
+	try {
+		a_func(a_begin, std::min(a_begin + chunk, a_end));
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+	try {
+		wait(counter);
+	}
+	catch (...) {
+		if (!error)
+			error = std::current_exception();
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void JobSystem::set_timing_hook(TimingHook a_hook) {
+	m_timing_hook = std::move(a_hook);
+}
+
+std::size_t JobSystem::get_worker_count() const noexcept {
+	return m_workers.size();
+}
+
+std::size_t JobSystem::get_worker_idx() const noexcept {
+	return t_system == this ? t_worker_idx : m_workers.size();
+}
+
+void JobSystem::push(Job&& a_job) {
+	// Threads outside of the system hand jobs out round robin.
+	std::size_t idx = get_worker_idx();
+	if (idx == m_workers.size())
+		idx = m_next_victim.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+	{
+		std::lock_guard lock(m_workers[idx]->mutex);
+		m_workers[idx]->jobs.push_back(std::move(a_job));
+	}
+	m_queued.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders this with sleeping worker checking m_queued, so wake up can't be lost.
+	{ std::lock_guard lock(m_sleep_mutex); }
+	m_wake.notify_one();
+}
+
+void JobSystem::worker_loop(std::size_t a_idx) {
+	t_system = this;
+	t_worker_idx = a_idx;
+
+	while (true) {
+		Job job;
+		if (try_pop(a_idx, job) || try_steal(a_idx, job) || try_pop_background(job)) {
+			run(job, a_idx);
+			continue;
+		}
+
+		std::unique_lock lock(m_sleep_mutex);
+		m_wake.wait(lock, [this]() { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+		if (m_stop)
+			return;
+	}
+}
+
+// Owner takes newest job, its data is most likely still in cache.
+bool JobSystem::try_pop(std::size_t a_idx, Job& a_job) {
+	if (a_idx >= m_workers.size())
+		return false;
+
+	Worker& worker = *m_workers[a_idx];
+	std::lock_guard lock(worker.mutex);
+	if (worker.jobs.empty())
+		return false;
+
+	a_job = std::move(worker.jobs.back());
+	worker.jobs.pop_back();
+	m_queued.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+// Thieves take oldest job, usually the biggest part of work left.
+bool JobSystem::try_steal(std::size_t a_idx, Job& a_job) {
+	const std::size_t workers_siz = m_workers.size();
+	for (std::size_t i = 1; i <= workers_siz; ++i) {
+		std::size_t victim_idx = (a_idx + i) % workers_siz;
+		if (victim_idx == a_idx)
+			continue;
+
+		Worker& victim = *m_workers[victim_idx];
+		std::lock_guard lock(victim.mutex);
+		if (victim.jobs.empty())
+			continue;
+
+		a_job = std::move(victim.jobs.front());
+		victim.jobs.pop_front();
+		m_queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+// Oldest first, loads finish in order they were requested.
+bool JobSystem::try_pop_background(Job& a_job) {
+	std::lock_guard lock(m_background_mutex);
+	if (m_background.empty())
+		return false;
+
+	a_job = std::move(m_background.front());
+	m_background.pop_front();
+	m_queued.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+// Counted jobs hand any exception to whoever waits on counter, nobody would see it of uncounted ones, so it is logged.
+void JobSystem::run(Job& a_job, std::size_t a_idx) {
+	auto begin = m_timing_hook ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+	std::exception_ptr error;
+	try {
+		a_job.task();
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+	if (error && !a_job.counter) {
+		try {
+			std::rethrow_exception(error);
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[JOBSYSTEM::RUN] Job \"{}\" failed: {}", a_job.name, e.what()), Error_action::logging);
+		}
+		catch (...) {
+			ERROR(std::format("[JOBSYSTEM::RUN] Job \"{}\" failed with unknown exception.", a_job.name), Error_action::logging);
+		}
+	}
+	if (m_timing_hook)
+		m_timing_hook({ a_job.name, a_idx, begin, std::chrono::steady_clock::now() });
+
+	finish(a_job.counter, error);
+}
+
+void JobSystem::finish(JobCounter* a_counter, std::exception_ptr a_error) {
+	if (!a_counter)
+		return;
+
+	std::vector<std::function<void()>> continuations;
+	{
+		// Decrement under lock, so then() either sees pending jobs and queues continuation or sees none and submits it.
+		std::lock_guard lock(a_counter->m_mutex);
+		if (a_error && !a_counter->m_error)
+			a_counter->m_error = a_error;
+		if (a_counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		continuations.swap(a_counter->m_continuations);
+	}
+	for (auto& continuation : continuations) {
+		continuation();
+	}
+}
+}
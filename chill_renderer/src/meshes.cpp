@@ -135,15 +135,15 @@ void MaterialMap::set_shininess(float a_shininess) noexcept {
 	m_shininess = a_shininess;
 }
 
-std::vector<Texture2D> MaterialMap::get_diffuse_maps() const noexcept {
+const std::vector<Texture2D>& MaterialMap::get_diffuse_maps() const noexcept {
 	return m_diffuse_maps;
 }
 
-std::vector<Texture2D> MaterialMap::get_specular_maps() const noexcept {
+const std::vector<Texture2D>& MaterialMap::get_specular_maps() const noexcept {
 	return m_specular_maps;
 }
 
-std::vector<Texture2D> MaterialMap::get_emission_maps() const noexcept {
+const std::vector<Texture2D>& MaterialMap::get_emission_maps() const noexcept {
 	return m_emission_maps;
 }
 
@@ -160,11 +160,17 @@ void MaterialMap::check_unit_id_limits() const {
 	}
 }
 
+// Vertex and element buffers of mesh, vertex array itself holds no storage.
+static std::size_t get_buffers_size(const BufferData& a_data) {
+	return a_data.positions.size() * sizeof(glm::vec3) + a_data.UVs.size() * sizeof(glm::vec2) +
+		a_data.normals.size() * sizeof(glm::vec3) + a_data.indicies.size() * sizeof(unsigned int);
+}
+
 Mesh::Mesh(const BufferData& a_data, const MaterialMap& a_mat, bool a_wireframe)
 	:m_material_map{ a_mat }, m_wireframe{ a_wireframe }
 {
-	glGenVertexArrays(1, &m_VBOs.VAO);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::MESHES, m_VBOs.VAO);
+	m_VBOs.VAO = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::VERTEX_ARRAY);
+	m_VBOs.handle = Application::get_instance().get_rmanager().new_handle(ResourceType::MESHES, m_VBOs.VAO);
 
 	m_type = (a_data.indicies.empty()) ? BufferDataType::VERTEX : BufferDataType::ELEMENT;
 
@@ -172,15 +178,129 @@ Mesh::Mesh(const BufferData& a_data, const MaterialMap& a_mat, bool a_wireframe)
 	set_UVs(a_data.UVs);
 	set_normals(a_data.normals);
 	set_indicies(a_data.indicies);
+	set_occluder(a_data.positions, a_data.indicies);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::MESHES, m_VBOs.handle, get_buffers_size(a_data));
+}
+
+Mesh::Mesh(const BufferData& a_data, const MeshBuffers& a_buffers, const MaterialMap& a_mat, bool a_wireframe)
+	:m_wireframe{ a_wireframe }, m_material_map{ a_mat }
+{
+	m_VBOs.VAO = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::VERTEX_ARRAY);
+	m_VBOs.handle = Application::get_instance().get_rmanager().new_handle(ResourceType::MESHES, m_VBOs.VAO);
+
+	m_type = (a_data.indicies.empty()) ? BufferDataType::VERTEX : BufferDataType::ELEMENT;
+	m_VBOs.VBO_pos = a_buffers.VBO_pos;
+	m_VBOs.VBO_UVs = a_buffers.VBO_UVs;
+	m_VBOs.VBO_normals = a_buffers.VBO_normals;
+	m_VBOs.EBO = a_buffers.EBO;
+	m_verticies_sum = a_data.positions.size();
+	m_indicies_sum = a_data.indicies.size();
+
+	for (const auto& pos : a_data.positions) {
+		m_aabb.expand(pos);
+	}
+
+	glBindVertexArray(m_VBOs.VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs.VBO_pos);
+	glVertexAttribPointer(g_attrib_pos_location, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(g_attrib_pos_location);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs.VBO_UVs);
+	glVertexAttribPointer(g_attrib_tex_location, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(g_attrib_tex_location);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs.VBO_normals);
+	glVertexAttribPointer(g_attrib_normal_location, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(g_attrib_normal_location);
+
+	if (m_type == BufferDataType::ELEMENT)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_VBOs.EBO);
+
+	set_occluder(a_data.positions, a_data.indicies);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::MESHES, m_VBOs.handle, get_buffers_size(a_data));
+}
+
+Mesh::Mesh(const MeshView& a_view, const MaterialMap& a_mat, bool a_wireframe)
+	:m_wireframe{ a_wireframe }, m_material_map{ a_mat }
+{
+	GLObjects& gl_objects = Application::get_instance().get_rmanager().get_gl_objects();
+	m_VBOs.VAO = gl_objects.gen(GLObjectType::VERTEX_ARRAY);
+	m_VBOs.handle = Application::get_instance().get_rmanager().new_handle(ResourceType::MESHES, m_VBOs.VAO);
+
+	m_type = (a_view.indicies.empty()) ? BufferDataType::VERTEX : BufferDataType::ELEMENT;
+	m_verticies_sum = a_view.positions.size();
+	m_indicies_sum = a_view.indicies.size();
+	m_aabb = a_view.aabb;
+
+	auto upload = [&gl_objects](GLuint& a_buf_id, GLenum a_target, std::size_t a_siz, const void* a_data) {
+		a_buf_id = gl_objects.gen(GLObjectType::BUFFER);
+		glBindBuffer(a_target, a_buf_id);
+		glBufferData(a_target, a_siz, a_data, GL_STATIC_DRAW);
+	};
+
+	glBindVertexArray(m_VBOs.VAO);
+
+	upload(m_VBOs.VBO_pos, GL_ARRAY_BUFFER, a_view.positions.size_bytes(), a_view.positions.data());
+	glVertexAttribPointer(g_attrib_pos_location, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(g_attrib_pos_location);
+
+	upload(m_VBOs.VBO_UVs, GL_ARRAY_BUFFER, a_view.UVs.size_bytes(), a_view.UVs.data());
+	glVertexAttribPointer(g_attrib_tex_location, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(g_attrib_tex_location);
+
+	upload(m_VBOs.VBO_normals, GL_ARRAY_BUFFER, a_view.normals.size_bytes(), a_view.normals.data());
+	glVertexAttribPointer(g_attrib_normal_location, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(g_attrib_normal_location);
+
+	if (m_type == BufferDataType::ELEMENT)
+		upload(m_VBOs.EBO, GL_ELEMENT_ARRAY_BUFFER, a_view.indicies.size_bytes(), a_view.indicies.data());
+
+	set_occluder(a_view.positions, a_view.indicies);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::MESHES, m_VBOs.handle,
+		a_view.positions.size_bytes() + a_view.UVs.size_bytes() + a_view.normals.size_bytes() + a_view.indicies.size_bytes());
+}
+
+MeshBuffers Mesh::upload_buffers(const BufferData& a_data) {
+	// Copy write target, element array binding belongs to vertex array which doesn't exist yet.
+	auto upload = [](GLuint& a_buf_id, std::size_t a_siz, const void* a_data) {
+		glGenBuffers(1, &a_buf_id);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, a_buf_id);
+		glBufferData(GL_COPY_WRITE_BUFFER, a_siz, a_data, GL_STATIC_DRAW);
+	};
+
+	MeshBuffers buffers;
+	upload(buffers.VBO_pos, a_data.positions.size() * sizeof(glm::vec3), a_data.positions.data());
+	upload(buffers.VBO_UVs, a_data.UVs.size() * sizeof(glm::vec2), a_data.UVs.data());
+	upload(buffers.VBO_normals, a_data.normals.size() * sizeof(glm::vec3), a_data.normals.data());
+	if (!a_data.indicies.empty())
+		upload(buffers.EBO, a_data.indicies.size() * sizeof(unsigned int), a_data.indicies.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	return buffers;
+}
+
+void Mesh::set_occluder(std::span<const glm::vec3> a_positions, std::span<const unsigned int> a_indicies) {
+	std::size_t tri_siz = (m_type == BufferDataType::ELEMENT ? a_indicies.size() : a_positions.size()) / 3;
+	if (m_draw_mode == BufferDrawType::TRIANGLES && tri_siz > 0 && tri_siz <= g_occluder_max_triangles) {
+		m_occluder = std::make_shared<const OccluderGeometry>(std::vector<glm::vec3>(a_positions.begin(), a_positions.end()),
+			std::vector<unsigned int>(a_indicies.begin(), a_indicies.end()));
+	}
 }
 
 void Mesh::set_positions(const std::vector<glm::vec3>& a_positions) {
 	m_verticies_sum = a_positions.size();
+	m_occluder.reset();
+
+	m_aabb = AABB();
+	for (const auto& pos : a_positions) {
+		m_aabb.expand(pos);
+	}
 
 	glBindVertexArray(m_VBOs.VAO);
 
 	if (m_VBOs.VBO_pos == EMPTY_VBO)
-		glGenBuffers(1, &m_VBOs.VBO_pos);
+		m_VBOs.VBO_pos = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs.VBO_pos);
 	glBufferData(GL_ARRAY_BUFFER, m_verticies_sum * sizeof(a_positions[0]), a_positions.data(), GL_STATIC_DRAW);
@@ -193,7 +313,7 @@ void Mesh::set_UVs(const std::vector<glm::vec2>& a_UVs) {
 	glBindVertexArray(m_VBOs.VAO);
 
 	if (m_VBOs.VBO_UVs == EMPTY_VBO)
-		glGenBuffers(1, &m_VBOs.VBO_UVs);
+		m_VBOs.VBO_UVs = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs.VBO_UVs);
 	glBufferData(GL_ARRAY_BUFFER, a_UVs.size() * sizeof(a_UVs[0]), a_UVs.data(), GL_STATIC_DRAW);
@@ -206,7 +326,7 @@ void Mesh::set_normals(const std::vector<glm::vec3>& a_normals) {
 	glBindVertexArray(m_VBOs.VAO);
 
 	if (m_VBOs.VBO_normals == EMPTY_VBO)
-		glGenBuffers(1, &m_VBOs.VBO_normals);
+		m_VBOs.VBO_normals = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_VBOs.VBO_normals);
 	glBufferData(GL_ARRAY_BUFFER, a_normals.size() * sizeof(a_normals[0]), a_normals.data(), GL_STATIC_DRAW);
@@ -222,9 +342,10 @@ void Mesh::set_indicies(const std::vector<unsigned int>& a_indicies) {
 	glBindVertexArray(m_VBOs.VAO);
 
 	m_indicies_sum = a_indicies.size();
+	m_occluder.reset();
 
 	if (m_VBOs.EBO == EMPTY_VBO)
-		glGenBuffers(1, &m_VBOs.EBO);
+		m_VBOs.EBO = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_VBOs.EBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, a_indicies.size() * sizeof(a_indicies[0]), a_indicies.data(), GL_STATIC_DRAW);
@@ -286,6 +407,30 @@ GLuint Mesh::get_VAO() const noexcept {
 	return m_VBOs.VAO;
 }
 
+ResourceHandle Mesh::get_handle() const noexcept {
+	return m_VBOs.handle;
+}
+
+const AABB& Mesh::get_aabb() const noexcept {
+	return m_aabb;
+}
+
+const std::shared_ptr<const OccluderGeometry>& Mesh::get_occluder() const noexcept {
+	return m_occluder;
+}
+
+std::size_t Mesh::get_triangle_count() const noexcept {
+	return (m_type == BufferDataType::ELEMENT ? m_indicies_sum : m_verticies_sum) / 3;
+}
+
+int Mesh::get_element_count() const noexcept {
+	return m_type == BufferDataType::ELEMENT ? m_indicies_sum : m_verticies_sum;
+}
+
+bool Mesh::is_indexed() const noexcept {
+	return m_type == BufferDataType::ELEMENT;
+}
+
 MaterialMap& Mesh::get_material_map() noexcept {
 	return m_material_map;
 }
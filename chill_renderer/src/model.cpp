@@ -3,8 +3,11 @@
 #include <assimp/postprocess.h>
 
 #include <format>
+#include <numeric>
+#include <algorithm>
 
 #include "chill_renderer/model.hpp"
+#include "chill_renderer/cooked_asset.hpp"
 #include "chill_renderer/file_manager.hpp"
 #include "chill_renderer/application.hpp"
 
@@ -17,39 +20,136 @@ Model::Model(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) {
 	load_model(a_path, a_flip_UVs, a_gamma_corr);
 }
 
-void Model::load_model(const std::wstring & a_path, bool a_flip_UVs, bool a_gamma_corr) {
-	clear();
+void Model::load_model(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) {
+	if (is_cooked_file(a_path))
+		build(CookedAsset(a_path), a_gamma_corr);
+	else
+		build(import_file(a_path, a_flip_UVs, a_gamma_corr));
+}
 
+ModelImport Model::import_file(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) {
 	fs::path p = guess_path(a_path);
 	if (p == fs::path())
-		ERROR(std::format("[MODEL::MODEL] Bad model path: {}", wstos(a_path)), Error_action::throwing);
+		ERROR(std::format("[MODEL::IMPORT_FILE] Bad model path: {}", wstos(a_path)), Error_action::throwing);
 
-	m_flipped_UVs = a_flip_UVs;
-	m_gamma_corr = a_gamma_corr;
-	m_path = p.wstring();
-	m_dir = p.parent_path().wstring();
-	m_filename = p.filename().wstring();
+	ModelImport import;
+	import.path = p.wstring();
+	import.flip_UVs = a_flip_UVs;
+	import.gamma_corr = a_gamma_corr;
 
 	Assimp::Importer importer;
 	int flags = aiProcess_Triangulate | aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals;
 	if (a_flip_UVs) {
 		flags |= aiProcess_FlipUVs;
 	}
-	const aiScene* scene = importer.ReadFile(wstos(m_path), flags);
+	const aiScene* scene = importer.ReadFile(wstos(import.path), flags);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		ERROR(std::format("[MODEL::LOAD_MODEL] ASSIMP::{}", importer.GetErrorString()), Error_action::logging);
-		return;
+		ERROR(std::format("[MODEL::IMPORT_FILE] ASSIMP::{}", importer.GetErrorString()), Error_action::logging);
+		return import;
+	}
+
+	// Texture paths are resolved once per material, not per mesh using it.
+	std::wstring dir = p.parent_path().wstring();
+	for (unsigned int mat_idx = 0; mat_idx < scene->mNumMaterials; mat_idx++) {
+		import.materials.push_back(process_material(scene->mMaterials[mat_idx], dir));
 	}
 
 	// Recursive method
-	// process_node(scene->mRootNode, scene);
+	// process_node(scene->mRootNode, scene, import);
+
+	// Iterative method, meshes are independent and scene is only read, so they're converted in parallel.
+	import.meshes.resize(scene->mNumMeshes);
+	Application::get_instance().get_jobs().parallel_for(0, scene->mNumMeshes, 1, [&import, scene](std::size_t a_begin, std::size_t a_end) {
+			for (std::size_t mesh_idx = a_begin; mesh_idx < a_end; mesh_idx++) {
+				import.meshes[mesh_idx] = process_mesh(scene->mMeshes[mesh_idx]);
+			}
+		}, "process_mesh");
+	return import;
+}
+
+void Model::build(const ModelImport& a_import, bool a_async_textures, const std::vector<MeshBuffers>& a_buffers) {
+	clear();
+
+	fs::path p(a_import.path);
+	m_flipped_UVs = a_import.flip_UVs;
+	m_gamma_corr = a_import.gamma_corr;
+	m_path = p.wstring();
+	m_dir = p.parent_path().wstring();
+	m_filename = p.filename().wstring();
+
+	// Use rmanager to load textures (see Application class).
+	ResourceManager& rman = Application::get_instance().get_rmanager();
+	std::map<std::size_t, MaterialMap> materials;
+	for (std::size_t i = 0; i < a_import.meshes.size(); ++i) {
+		const MeshImport& mesh_import = a_import.meshes[i];
+		auto [mat_it, inserted] = materials.try_emplace(mesh_import.material_idx);
+		if (inserted && mesh_import.material_idx < a_import.materials.size()) {
+			const auto& tex_imports = a_import.materials[mesh_import.material_idx];
+			std::vector<Texture2D> textures;
+			textures.reserve(tex_imports.size());
+			for (const auto& tex_import : tex_imports) {
+				Texture2D tex_obj = a_async_textures ?
+					rman.load_texture_async(tex_import.type, tex_import.path, false, m_gamma_corr) :
+					rman.load_texture(tex_import.type, tex_import.path, false, m_gamma_corr);
+				tex_obj.set_unit_id(tex_import.unit_id);
+				textures.push_back(tex_obj);
+			}
+			mat_it->second.set_textures(textures);
+		}
+		const MaterialMap& mat = mat_it->second;
+		if (i < a_buffers.size())
+			m_meshes.push_back(Mesh(mesh_import.data, a_buffers[i], mat));
+		else
+			m_meshes.push_back(Mesh(mesh_import.data, mat));
+	}
+	update_bounds();
+}
+
+void Model::build(const CookedAsset& a_asset, bool a_gamma_corr) {
+	clear();
+
+	fs::path p(a_asset.get_path());
+	m_flipped_UVs = a_asset.get_header().flags & COOKED_FLIPPED_UVS;
+	m_gamma_corr = a_gamma_corr;
+	m_path = p.wstring();
+	m_dir = p.parent_path().wstring();
+	m_filename = p.filename().wstring();
+
+	ResourceManager& rman = Application::get_instance().get_rmanager();
+	auto cooked_materials = a_asset.get_materials();
+	auto cooked_textures = a_asset.get_textures();
+	std::map<std::size_t, MaterialMap> materials;
+	for (const auto& cooked_mesh : a_asset.get_meshes()) {
+		auto [mat_it, inserted] = materials.try_emplace(cooked_mesh.material_idx);
+		if (inserted && cooked_mesh.material_idx < cooked_materials.size()) {
+			const CookedMaterial& material = cooked_materials[cooked_mesh.material_idx];
+			std::vector<Texture2D> textures;
+			textures.reserve(material.texture_siz);
+			for (const auto& mat_texture : a_asset.get_material_textures().subspan(material.first_texture, material.texture_siz)) {
+				const CookedTexture& cooked_texture = cooked_textures[mat_texture.texture_idx];
+				TextureType type = static_cast<TextureType>(mat_texture.type);
+				std::wstring path = a_asset.get_texture_path(cooked_texture);
+				Texture2D tex_obj = cooked_texture.level_siz > 0 ?
+					rman.load_texture(type, path, m_gamma_corr, a_asset.get_image(cooked_texture)) :
+					rman.load_texture(type, path, false, m_gamma_corr);
+				tex_obj.set_unit_id(mat_texture.unit_id);
+				textures.push_back(tex_obj);
+			}
+			mat_it->second.set_textures(textures);
+		}
+		m_meshes.push_back(Mesh(a_asset.get_mesh_view(cooked_mesh), mat_it->second));
+	}
+	update_bounds();
+}
 
-	// Iterative method
-	for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
-		aiMesh* currentMesh = scene->mMeshes[meshIndex];
-		m_meshes.push_back(process_mesh(currentMesh, scene));
+std::size_t ModelImport::get_byte_size() const noexcept {
+	std::size_t siz{};
+	for (const auto& mesh : meshes) {
+		siz += mesh.data.positions.size() * sizeof(glm::vec3) + mesh.data.normals.size() * sizeof(glm::vec3) +
+			mesh.data.UVs.size() * sizeof(glm::vec2) + mesh.data.indicies.size() * sizeof(unsigned int);
 	}
+	return siz;
 }
 
 Model::Model(const std::vector<Mesh>& a_meshes) {
@@ -63,6 +163,9 @@ void Model::clear() noexcept {
 	m_transform_rotation = 1.0f;
 	m_transform_pos = 1.0f;
 	m_meshes.clear();
+	m_aabb = AABB();
+	m_world_aabb = AABB();
+	m_world_sphere = BoundingSphere();
 	m_path = L"";
 	m_dir = L"";
 	m_filename = L"";
@@ -72,80 +175,74 @@ void Model::clear() noexcept {
 
 // Nodes are laid out in tree like fashion. Each aiNode::mMeshes is an array of indicies into
 // aiScene::mMeshes which contains Meshes we process.
-void Model::process_node(aiNode* a_node, const aiScene* a_scene) {
+void Model::process_node(aiNode* a_node, const aiScene* a_scene, ModelImport& a_import) {
 	for (int i = 0; i < a_node->mNumMeshes; i++) {
 		aiMesh* mesh = a_scene->mMeshes[a_node->mMeshes[i]];
-		m_meshes.push_back(process_mesh(mesh, a_scene));
+		a_import.meshes.push_back(process_mesh(mesh));
 	}
 
 	for (int i = 0; i < a_node->mNumChildren; i++) {
-		process_node(a_node->mChildren[i], a_scene);
+		process_node(a_node->mChildren[i], a_scene, a_import);
 	}
 }
 
-Mesh Model::process_mesh(aiMesh* a_mesh, const aiScene* a_scene) {
-	BufferData data;
-	MaterialMap mat;
-	std::vector<Texture2D> textures;
-	auto texture_siz = a_scene->mMaterials[a_mesh->mMaterialIndex]->GetTextureCount(aiTextureType::aiTextureType_DIFFUSE);
-	texture_siz += a_scene->mMaterials[a_mesh->mMaterialIndex]->GetTextureCount(aiTextureType::aiTextureType_SPECULAR);
-	texture_siz += a_scene->mMaterials[a_mesh->mMaterialIndex]->GetTextureCount(aiTextureType::aiTextureType_EMISSIVE);
-	textures.reserve(texture_siz);
+// Attribute arrays are converted in bulk into presized vectors.
+MeshImport Model::process_mesh(aiMesh* a_mesh) {
+	MeshImport mesh_import;
+	BufferData& data = mesh_import.data;
+	mesh_import.material_idx = a_mesh->mMaterialIndex;
 
 	// Load VBO specific data
 	if (a_mesh->HasPositions()) {
-		auto has_UV_channels = a_mesh->GetNumUVChannels();
-		auto has_normals = a_mesh->HasNormals();
-		for (int i = 0; i < a_mesh->mNumVertices; i++) {
-			// Load vertex positions.
-			data.positions.push_back(glm::vec3(a_mesh->mVertices[i].x, a_mesh->mVertices[i].y, a_mesh->mVertices[i].z));
-
-			// Load normals.
-			if (has_normals) {
-				data.normals.push_back(glm::vec3(a_mesh->mNormals[i].x, a_mesh->mNormals[i].y, a_mesh->mNormals[i].z));
-			}
-			else {
-				data.normals.push_back(glm::vec3(0));
-			}
+		const std::size_t verticies_siz = a_mesh->mNumVertices;
+		auto to_vec3 = [](const aiVector3D& a_vec) { return glm::vec3(a_vec.x, a_vec.y, a_vec.z); };
 
-			// Load UVs from first UV channel.
-			// TODO: Manage situation when a_mesh->mNumUVComponents[n] is different than 2.
-			if (has_UV_channels && a_mesh->mNumUVComponents[0] == 2) {
-				data.UVs.push_back(glm::vec2(a_mesh->mTextureCoords[0][i].x, a_mesh->mTextureCoords[0][i].y));
-			}
-			else {
-				data.UVs.push_back(glm::vec2(0));
-			}
+		// Load vertex positions.
+		data.positions.resize(verticies_siz);
+		std::transform(a_mesh->mVertices, a_mesh->mVertices + verticies_siz, data.positions.begin(), to_vec3);
+
+		// Load normals.
+		data.normals.resize(verticies_siz, glm::vec3(0));
+		if (a_mesh->HasNormals()) {
+			std::transform(a_mesh->mNormals, a_mesh->mNormals + verticies_siz, data.normals.begin(), to_vec3);
+		}
+
+		// Load UVs from first UV channel.
+		// TODO: Manage situation when a_mesh->mNumUVComponents[n] is different than 2.
+		data.UVs.resize(verticies_siz, glm::vec2(0));
+		if (a_mesh->GetNumUVChannels() && a_mesh->mNumUVComponents[0] == 2) {
+			std::transform(a_mesh->mTextureCoords[0], a_mesh->mTextureCoords[0] + verticies_siz, data.UVs.begin(),
+				[](const aiVector3D& a_vec) { return glm::vec2(a_vec.x, a_vec.y); });
 		}
 	}
 
 	if (a_mesh->HasFaces()) {
 		// Iterate over mesh faces and save indicies if any.
+		data.indicies.resize(a_mesh->mNumFaces * 3);
 		for (int i = 0; i < a_mesh->mNumFaces; i++) {
-			aiFace face = a_mesh->mFaces[i];
+			const aiFace& face = a_mesh->mFaces[i];
 			// If mNumIndices is not 3 then face is not a triangle, which shouldn't happend in this importer.
 			assert(face.mNumIndices == 3);
-			for (int j = 0; j < 3; j++) {
-				data.indicies.push_back(a_mesh->mFaces[i].mIndices[j]);
-			}
+			std::copy_n(face.mIndices, 3, data.indicies.begin() + i * 3);
 		}
 	}
 
-	// Load mesh textures. I'm assuming that result of ambient calculations is the same as for diffuse (usual behaviour),
-	// and so I don't process aiTextureType_AMBIENT. Might add support for more aiTextureTypes in the future.
-	if (a_scene->HasMaterials()) {
-		aiMaterial* material = a_scene->mMaterials[a_mesh->mMaterialIndex];
+	return mesh_import;
+}
 
-		process_texture(textures, material, aiTextureType_DIFFUSE);
-		process_texture(textures, material, aiTextureType_SPECULAR);
-		process_texture(textures, material, aiTextureType_EMISSIVE);
-	}
-	mat.set_textures(textures);
+// Load mesh textures. I'm assuming that result of ambient calculations is the same as for diffuse (usual behaviour),
+// and so I don't process aiTextureType_AMBIENT. Might add support for more aiTextureTypes in the future.
+std::vector<TextureImport> Model::process_material(aiMaterial* a_mat, const std::wstring& a_dir) {
+	std::vector<TextureImport> textures;
+	textures.reserve(a_mat->GetTextureCount(aiTextureType_DIFFUSE) + a_mat->GetTextureCount(aiTextureType_SPECULAR) + a_mat->GetTextureCount(aiTextureType_EMISSIVE));
 
-	return Mesh(data, mat);
+	process_texture(textures, a_mat, aiTextureType_DIFFUSE, a_dir);
+	process_texture(textures, a_mat, aiTextureType_SPECULAR, a_dir);
+	process_texture(textures, a_mat, aiTextureType_EMISSIVE, a_dir);
+	return textures;
 }
 
-void Model::process_texture(std::vector<Texture2D>& a_textures, aiMaterial* a_mat, aiTextureType a_ai_texture_type) {
+void Model::process_texture(std::vector<TextureImport>& a_textures, aiMaterial* a_mat, aiTextureType a_ai_texture_type, const std::wstring& a_dir) {
 	aiString texture_name;
 	TextureType texture_type{ TextureType::NONE };
 	int unit_id{ 0 };
@@ -169,12 +266,8 @@ void Model::process_texture(std::vector<Texture2D>& a_textures, aiMaterial* a_ma
 		// Get texture path
 		a_mat->GetTexture(a_ai_texture_type, i, &texture_name);
 
-		// Use rmanager to load texture (see Application class).
-		ResourceManager& rman = Application::get_instance().get_rmanager();
-		std::wstring texture_path = (fs::path(m_dir) / fs::path(texture_name.C_Str())).wstring();
-		Texture2D tex_obj = rman.load_texture(texture_type, texture_path, false, m_gamma_corr);
-		tex_obj.set_unit_id(unit_id + i);
-		a_textures.push_back(tex_obj);
+		std::wstring texture_path = (fs::path(a_dir) / fs::path(texture_name.C_Str())).wstring();
+		a_textures.push_back({ texture_type, unit_id + i, texture_path });
 	}
 }
 
@@ -182,6 +275,7 @@ void Model::set_pos(const glm::vec3& a_pos) noexcept {
 	m_pos = a_pos;
 	m_transform_pos = glm::mat4(1.0f);
 	m_transform_pos = glm::translate(m_transform_pos, a_pos);
+	update_world_bounds();
 }
 
 void Model::set_rotation(const glm::vec3& a_rotation) noexcept {
@@ -190,10 +284,12 @@ void Model::set_rotation(const glm::vec3& a_rotation) noexcept {
 	m_transform_rotation = glm::rotate(m_transform_rotation, glm::radians(a_rotation[0]), glm::vec3(1.0, 0.0, 0.0));
 	m_transform_rotation = glm::rotate(m_transform_rotation, glm::radians(a_rotation[1]), glm::vec3(0.0, 1.0, 0.0));
 	m_transform_rotation = glm::rotate(m_transform_rotation, glm::radians(a_rotation[2]), glm::vec3(0.0, 0.0, 1.0));
+	update_world_bounds();
 }
 
 void Model::set_meshes(const std::vector<Mesh>& a_meshes) noexcept {
 	m_meshes = a_meshes;
+	update_bounds();
 }
 
 void Model::set_outline(bool a_option) noexcept {
@@ -212,17 +308,20 @@ void Model::set_size(float a_size) noexcept {
 	m_size = glm::vec3(a_size);
 	m_transform_scale = glm::mat4(1.0f);
 	m_transform_scale = glm::scale(m_transform_scale, glm::vec3(a_size));
+	update_world_bounds();
 }
 
 void Model::set_size(const glm::vec3& a_size) noexcept {
 	m_size = a_size;
 	m_transform_scale = glm::mat4(1.0f);
 	m_transform_scale = glm::scale(m_transform_scale, a_size);
+	update_world_bounds();
 }
 
 void Model::move(const glm::vec3& a_vec) noexcept {
 	m_pos += a_vec;
 	m_transform_pos = glm::translate(m_transform_pos, a_vec);
+	update_world_bounds();
 }
 
 void Model::rotate(float a_angle, Axis a_axis) noexcept {
@@ -240,6 +339,7 @@ void Model::rotate(float a_angle, Axis a_axis) noexcept {
 		m_transform_rotation = glm::rotate(m_transform_rotation, glm::radians(a_angle), glm::vec3(0.0, 0.0, 1.0));
 		break;
 	}
+	update_world_bounds();
 }
 
 void Model::draw_outline(ShaderProgram& a_object_shader, ShaderProgram& a_outline_shader, const std::string& a_model_uniform_name, const std::string& a_material_map_uniform_name) {
@@ -277,6 +377,7 @@ void Model::draw_outline(ShaderProgram& a_object_shader, ShaderProgram& a_outlin
 	// Restore
 	m_transform_scale = tmp_scale_mat;
 	m_size = tmp_size;
+	update_world_bounds();
 	glStencilFunc(GL_ALWAYS, 0, 0xFF); // Stencil test always passes
 	glStencilMask(0xFF);
 	glClear(GL_STENCIL_BUFFER_BIT);
@@ -344,6 +445,38 @@ glm::mat3 Model::get_normal_view_mat(const glm::mat4& a_view_mat) const noexcept
 	return glm::mat3(glm::transpose(glm::inverse(get_model_mat() * a_view_mat)));
 }
 
+const AABB& Model::get_aabb() const noexcept {
+	return m_aabb;
+}
+
+const AABB& Model::get_world_aabb() const noexcept {
+	return m_world_aabb;
+}
+
+const BoundingSphere& Model::get_world_sphere() const noexcept {
+	return m_world_sphere;
+}
+
+// Local bounds as union of mesh bounds.
+void Model::update_bounds() noexcept {
+	m_aabb = AABB();
+	for (const auto& mesh : m_meshes) {
+		m_aabb.expand(mesh.get_aabb());
+	}
+	update_world_bounds();
+}
+
+void Model::update_world_bounds() noexcept {
+	glm::mat4 model_mat = get_model_mat();
+	m_world_aabb = m_aabb.transform(model_mat);
+
+	// Sphere around local box is tighter than sphere around rotated world box.
+	BoundingSphere local_sphere(m_aabb);
+	float max_scale = glm::max(glm::length(glm::vec3(model_mat[0])), glm::max(glm::length(glm::vec3(model_mat[1])), glm::length(glm::vec3(model_mat[2]))));
+	m_world_sphere.center = glm::vec3(model_mat * glm::vec4(local_sphere.center, 1.0f));
+	m_world_sphere.radius = local_sphere.radius * max_scale;
+}
+
 float Model::get_outline_thickness() const noexcept {
 	return m_outline.thickness;
 }
@@ -369,42 +502,85 @@ ModelInstanced::ModelInstanced(const Model& a_model)
 { }
 
 ModelInstanced::ModelInstanced(const ModelInstanced& a_obj) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_model_mat_buf_id);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_normal_mat_buf_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_transform_buf_handle);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_visible_buf_handle);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_motion_buf_handle);
 
 	m_model_base = a_obj.m_model_base;
 	m_instances_siz = a_obj.m_instances_siz;
-	m_model_mat_buf_id = a_obj.m_model_mat_buf_id;
-	m_normal_mat_buf_id = a_obj.m_normal_mat_buf_id;
+	m_visible_siz = a_obj.m_visible_siz;
+	m_transform_buf_id = a_obj.m_transform_buf_id;
+	m_transform_buf_handle = a_obj.m_transform_buf_handle;
+	m_visible_buf_id = a_obj.m_visible_buf_id;
+	m_visible_buf_handle = a_obj.m_visible_buf_handle;
 	m_instanced_vecs = a_obj.m_instanced_vecs;
-	m_model_mats = a_obj.m_model_mats;
-	m_normal_mats = a_obj.m_normal_mats;
+	m_transforms = a_obj.m_transforms;
+	m_visible_idx = a_obj.m_visible_idx;
+	m_instance_spheres = a_obj.m_instance_spheres;
+	m_instance_capacity = a_obj.m_instance_capacity;
+	m_dirty_ranges = a_obj.m_dirty_ranges;
+	m_stream_buf = a_obj.m_stream_buf;
+	m_motion_buf_id = a_obj.m_motion_buf_id;
+	m_motion_buf_handle = a_obj.m_motion_buf_handle;
+	m_animated = a_obj.m_animated;
+	m_orbit_center = a_obj.m_orbit_center;
+	m_motions = a_obj.m_motions;
 }
 
 ModelInstanced::ModelInstanced(ModelInstanced&& a_obj) noexcept { 
 	m_model_base = std::move(a_obj.m_model_base);
 	m_instances_siz = a_obj.m_instances_siz;
-	m_model_mat_buf_id = a_obj.m_model_mat_buf_id;
-	m_normal_mat_buf_id = a_obj.m_normal_mat_buf_id;
+	m_visible_siz = a_obj.m_visible_siz;
+	m_transform_buf_id = a_obj.m_transform_buf_id;
+	m_transform_buf_handle = a_obj.m_transform_buf_handle;
+	m_visible_buf_id = a_obj.m_visible_buf_id;
+	m_visible_buf_handle = a_obj.m_visible_buf_handle;
 	m_instanced_vecs = std::move(a_obj.m_instanced_vecs);
-	m_model_mats = std::move(a_obj.m_model_mats);
-	m_normal_mats = std::move(a_obj.m_normal_mats);
-
-	a_obj.m_model_mat_buf_id = EMPTY_VBO;
-	a_obj.m_normal_mat_buf_id = EMPTY_VBO;
+	m_transforms = std::move(a_obj.m_transforms);
+	m_visible_idx = std::move(a_obj.m_visible_idx);
+	m_instance_spheres = std::move(a_obj.m_instance_spheres);
+	m_instance_capacity = a_obj.m_instance_capacity;
+	m_dirty_ranges = std::move(a_obj.m_dirty_ranges);
+	m_stream_buf = std::move(a_obj.m_stream_buf);
+	m_motion_buf_id = a_obj.m_motion_buf_id;
+	m_motion_buf_handle = a_obj.m_motion_buf_handle;
+	m_animated = a_obj.m_animated;
+	m_orbit_center = a_obj.m_orbit_center;
+	m_motions = std::move(a_obj.m_motions);
+
+	a_obj.m_transform_buf_id = EMPTY_VBO;
+	a_obj.m_transform_buf_handle = {};
+	a_obj.m_visible_buf_id = EMPTY_VBO;
+	a_obj.m_visible_buf_handle = {};
+	a_obj.m_motion_buf_id = EMPTY_VBO;
+	a_obj.m_motion_buf_handle = {};
+	a_obj.m_instance_capacity = 0;
 }
 
 ModelInstanced& ModelInstanced::operator=(const ModelInstanced& a_obj) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_model_mat_buf_id);
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_normal_mat_buf_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_transform_buf_handle);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_visible_buf_handle);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::INSTANCED_ARRAYS, a_obj.m_motion_buf_handle);
 
 	m_model_base = a_obj.m_model_base;
 	m_instances_siz = a_obj.m_instances_siz;
-	m_model_mat_buf_id = a_obj.m_model_mat_buf_id;
-	m_normal_mat_buf_id = a_obj.m_normal_mat_buf_id;
+	m_visible_siz = a_obj.m_visible_siz;
+	m_transform_buf_id = a_obj.m_transform_buf_id;
+	m_transform_buf_handle = a_obj.m_transform_buf_handle;
+	m_visible_buf_id = a_obj.m_visible_buf_id;
+	m_visible_buf_handle = a_obj.m_visible_buf_handle;
 	m_instanced_vecs = a_obj.m_instanced_vecs;
-	m_model_mats = a_obj.m_model_mats;
-	m_normal_mats = a_obj.m_normal_mats;
+	m_transforms = a_obj.m_transforms;
+	m_visible_idx = a_obj.m_visible_idx;
+	m_instance_spheres = a_obj.m_instance_spheres;
+	m_instance_capacity = a_obj.m_instance_capacity;
+	m_dirty_ranges = a_obj.m_dirty_ranges;
+	m_stream_buf = a_obj.m_stream_buf;
+	m_motion_buf_id = a_obj.m_motion_buf_id;
+	m_motion_buf_handle = a_obj.m_motion_buf_handle;
+	m_animated = a_obj.m_animated;
+	m_orbit_center = a_obj.m_orbit_center;
+	m_motions = a_obj.m_motions;
 
 	return *this;
 }
@@ -412,37 +588,64 @@ ModelInstanced& ModelInstanced::operator=(const ModelInstanced& a_obj) {
 ModelInstanced& ModelInstanced::operator=(ModelInstanced&& a_obj) noexcept {
 	m_model_base = std::move(a_obj.m_model_base);
 	m_instances_siz = a_obj.m_instances_siz;
-	m_model_mat_buf_id = a_obj.m_model_mat_buf_id;
-	m_normal_mat_buf_id = a_obj.m_normal_mat_buf_id;
+	m_visible_siz = a_obj.m_visible_siz;
+	m_transform_buf_id = a_obj.m_transform_buf_id;
+	m_transform_buf_handle = a_obj.m_transform_buf_handle;
+	m_visible_buf_id = a_obj.m_visible_buf_id;
+	m_visible_buf_handle = a_obj.m_visible_buf_handle;
 	m_instanced_vecs = std::move(a_obj.m_instanced_vecs);
-	m_model_mats = std::move(a_obj.m_model_mats);
-	m_normal_mats = std::move(a_obj.m_normal_mats); 
-
-	a_obj.m_model_mat_buf_id = EMPTY_VBO;
-	a_obj.m_normal_mat_buf_id = EMPTY_VBO;
+	m_transforms = std::move(a_obj.m_transforms);
+	m_visible_idx = std::move(a_obj.m_visible_idx);
+	m_instance_spheres = std::move(a_obj.m_instance_spheres);
+	m_instance_capacity = a_obj.m_instance_capacity;
+	m_dirty_ranges = std::move(a_obj.m_dirty_ranges);
+	m_stream_buf = std::move(a_obj.m_stream_buf);
+	m_motion_buf_id = a_obj.m_motion_buf_id;
+	m_motion_buf_handle = a_obj.m_motion_buf_handle;
+	m_animated = a_obj.m_animated;
+	m_orbit_center = a_obj.m_orbit_center;
+	m_motions = std::move(a_obj.m_motions);
+
+	a_obj.m_transform_buf_id = EMPTY_VBO;
+	a_obj.m_transform_buf_handle = {};
+	a_obj.m_visible_buf_id = EMPTY_VBO;
+	a_obj.m_visible_buf_handle = {};
+	a_obj.m_motion_buf_id = EMPTY_VBO;
+	a_obj.m_motion_buf_handle = {};
+	a_obj.m_instance_capacity = 0;
 	return *this;
 }
 
 ModelInstanced::~ModelInstanced() {
-	if (m_model_mat_buf_id != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::INSTANCED_ARRAYS, m_model_mat_buf_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::INSTANCED_ARRAYS, m_model_mat_buf_id)) {
-			glDeleteTextures(1, &m_model_mat_buf_id);
-		}
-	}
+	release_buffer(m_transform_buf_id, m_transform_buf_handle);
+	release_buffer(m_visible_buf_id, m_visible_buf_handle);
+	release_buffer(m_motion_buf_id, m_motion_buf_handle);
+}
 
-	if (m_normal_mat_buf_id != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::INSTANCED_ARRAYS, m_normal_mat_buf_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::INSTANCED_ARRAYS, m_normal_mat_buf_id)) {
-			glDeleteTextures(1, &m_normal_mat_buf_id);
+void ModelInstanced::release_buffer(GLuint& a_buf_id, ResourceHandle& a_handle) noexcept {
+	if (a_buf_id != EMPTY_VBO) {
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::INSTANCED_ARRAYS, a_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::INSTANCED_ARRAYS, a_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::BUFFER, a_buf_id);
 		}
+		a_buf_id = EMPTY_VBO;
+		a_handle = {};
 	}
 }
 
 void ModelInstanced::set_model(const Model& a_model) {
+	bool created = m_visible_buf_id == EMPTY_VBO;
 	m_model_base = a_model;
-	create_model_instanced_arr(m_model_mats);
-	create_normal_instanced_arr(m_normal_mats);
+	reserve_instance_buffers(m_transforms.size());
+	// New base model brings its own VAOs.
+	if (!created)
+		setup_instance_attrib();
+	reset_visible();
+	// Spheres depend on base model's bounds.
+	if (m_animated)
+		update_motion_spheres(std::max(m_sphere_window, 0.0f));
+	else if (!m_transforms.empty())
+		populate_model_mat_buffer();
 }
 
 void ModelInstanced::push_position(const glm::vec3& a_position) noexcept {
@@ -458,36 +661,32 @@ void ModelInstanced::push_size(const glm::vec3& a_size) noexcept {
 }
 
 void ModelInstanced::push_positions(const std::vector<glm::vec3>& a_positions) noexcept {
-	m_instanced_vecs[ModelInstancedVecs::POSITIONS] = a_positions;
+	m_instanced_vecs[ModelInstancedVecs::POSITIONS].assign(a_positions);
 }
 
 void ModelInstanced::push_rotations(const std::vector<glm::vec3>& a_rotations) noexcept {
-	m_instanced_vecs[ModelInstancedVecs::ROTATIONS] = a_rotations;
+	m_instanced_vecs[ModelInstancedVecs::ROTATIONS].assign(a_rotations);
 }
 
 void ModelInstanced::push_sizes(const std::vector<glm::vec3>& a_sizes) noexcept {
-	m_instanced_vecs[ModelInstancedVecs::SIZES] = a_sizes;
+	m_instanced_vecs[ModelInstancedVecs::SIZES].assign(a_sizes);
 }
 
 bool ModelInstanced::insert_buffer(std::size_t idx) { 
-	if (idx < m_instances_siz) {
-		auto model_mat = calculate_model_mat(idx);
-		auto normal_mat = calculate_normal_mat(idx);
-		glBindBuffer(GL_ARRAY_BUFFER, m_model_mat_buf_id);
-		glBufferSubData(GL_ARRAY_BUFFER, idx * sizeof(glm::mat4), sizeof(model_mat), glm::value_ptr(model_mat));
-
-		glBindBuffer(GL_ARRAY_BUFFER, m_normal_mat_buf_id);
-		glBufferSubData(GL_ARRAY_BUFFER, idx * sizeof(glm::mat4), sizeof(normal_mat), glm::value_ptr(normal_mat));
-		return true;
-	}
-	return false;
+	if (m_animated || idx >= m_transforms.size())
+		return false;
+
+	compose_transform(m_instanced_vecs[ModelInstancedVecs::POSITIONS], m_instanced_vecs[ModelInstancedVecs::ROTATIONS], m_instanced_vecs[ModelInstancedVecs::SIZES],
+		BoundingSphere(m_model_base.get_aabb()), idx, m_transforms.data(), m_instance_spheres);
+	mark_dirty(idx, idx + 1);
+	return true;
 }
 
 bool ModelInstanced::insert_position(std::size_t idx, const glm::vec3& a_position) {
 	auto& pos_vec = m_instanced_vecs[ModelInstancedVecs::POSITIONS]; 
 	if (idx >= pos_vec.size())
 		return false;
-	pos_vec[idx] = a_position;
+	pos_vec.set(idx, a_position);
 	return insert_buffer(idx);
 }
 
@@ -496,7 +695,7 @@ bool ModelInstanced::insert_rotation(std::size_t idx, const glm::vec3& a_rotatio
 	if (idx >= rot_vec.size())
 		return false;
 
-	rot_vec[idx] = a_rotation; 
+	rot_vec.set(idx, a_rotation);
 	return insert_buffer(idx);
 }
 
@@ -505,34 +704,146 @@ bool ModelInstanced::insert_size(std::size_t idx, const glm::vec3& a_size) {
 	if (idx >= siz_vec.size())
 		return false;
 
-	siz_vec[idx] = a_size; 
+	siz_vec.set(idx, a_size);
 	return insert_buffer(idx);
 }
 
+// Buffers keep their storage between calls, transforms are only marked for upload.
 void ModelInstanced::populate_model_mat_buffer() {
+	std::size_t old_siz = m_transforms.size();
+	m_animated = false;
 	calculate_model_mats();
-	create_model_instanced_arr(m_model_mats);
-	m_instances_siz = m_model_mats.size();
+	reserve_instance_buffers(m_transforms.size());
+	mark_dirty(0, m_transforms.size());
+	if (old_siz != m_transforms.size())
+		reset_visible();
+}
+
+void ModelInstanced::set_transforms(const std::vector<InstanceTransform>& a_transforms, const SphereBatch& a_spheres) {
+	std::size_t old_siz = m_transforms.size();
+	m_animated = false;
+	m_transforms = a_transforms;
+	m_instance_spheres = a_spheres;
+	m_instances_siz = m_transforms.size();
+	reserve_instance_buffers(m_transforms.size());
+	mark_dirty(0, m_transforms.size());
+	if (old_siz != m_transforms.size())
+		reset_visible();
+}
+
+void ModelInstanced::flush_dirty() {
+	if (m_dirty_ranges.empty() || !m_stream_buf || m_animated)
+		return;
+
+	std::ranges::sort(m_dirty_ranges);
+	std::size_t merged = 0;
+	for (std::size_t i = 1; i < m_dirty_ranges.size(); ++i) {
+		auto& last = m_dirty_ranges[merged];
+		if (m_dirty_ranges[i].first <= last.second + g_instance_merge_gap)
+			last.second = std::max(last.second, m_dirty_ranges[i].second);
+		else
+			m_dirty_ranges[++merged] = m_dirty_ranges[i];
+	}
+	m_dirty_ranges.resize(merged + 1);
+
+	for (auto [begin, end] : m_dirty_ranges) {
+		end = std::min(end, m_transforms.size());
+		if (begin >= end)
+			continue;
+		m_stream_buf->upload(m_transform_buf_id, begin * sizeof(InstanceTransform), m_transforms.data() + begin, (end - begin) * sizeof(InstanceTransform));
+	}
+	m_dirty_ranges.clear();
 }
 
-void ModelInstanced::populate_normal_mat_buffer() {
-	calculate_normal_mats();
-	create_normal_instanced_arr(m_normal_mats);
+void ModelInstanced::set_motions(const std::vector<InstanceMotion>& a_motions, const glm::vec3& a_orbit_center) {
+	m_animated = true;
+	m_orbit_center = a_orbit_center;
+	m_motions = a_motions;
+	for (auto& motion : m_motions) {
+		motion.tumble_axis = glm::normalize(motion.tumble_axis);
+	}
+
+	// CPU transforms are never evaluated, they only keep instance count for buffers.
+	std::size_t old_siz = m_transforms.size();
+	m_transforms.assign(m_motions.size(), InstanceTransform{});
+	m_instances_siz = m_motions.size();
+	reserve_instance_buffers(m_motions.size());
+	m_dirty_ranges.clear();
+	if (old_siz != m_transforms.size())
+		reset_visible();
+
+	if (m_motion_buf_id == EMPTY_VBO) {
+		m_motion_buf_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
+		m_motion_buf_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::INSTANCED_ARRAYS, m_motion_buf_id);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_motion_buf_id);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_motions.size() * sizeof(InstanceMotion), m_motions.data(), GL_STATIC_DRAW);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::INSTANCED_ARRAYS, m_motion_buf_handle, m_motions.size() * sizeof(InstanceMotion));
+
+	update_motion_spheres(std::max(m_sphere_window, 0.0f));
+}
+
+void ModelInstanced::animate(ShaderProgram& a_motion_shader, float a_time) {
+	if (!m_animated || m_instances_siz == 0)
+		return;
+	if (a_time < m_sphere_window || a_time >= m_sphere_window + g_motion_sphere_window)
+		update_motion_spheres(a_time);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_instance_transforms_binding, m_transform_buf_id);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_instance_motions_binding, m_motion_buf_id);
+	a_motion_shader["time"] = a_time;
+	a_motion_shader["instance_count"] = m_instances_siz;
+	a_motion_shader["orbit_center"] = m_orbit_center;
+	a_motion_shader.dispatch((static_cast<GLuint>(m_instances_siz) + g_instance_motion_group_siz - 1) / g_instance_motion_group_siz);
+
+	// Matrices are read by instanced vertex shaders.
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+// Visible indices are re-uploaded on every cull, so each pass (shadow, main, reflection) draws its own set.
+std::size_t ModelInstanced::cull(const Frustum& a_frustum) {
+	flush_dirty();
+	cull_spheres(a_frustum, m_instance_spheres, m_cull_flags);
+
+	m_visible_idx.clear();
+	for (std::size_t i = 0; i < m_cull_flags.size(); ++i) {
+		if (m_cull_flags[i])
+			m_visible_idx.push_back(static_cast<GLuint>(i));
+	}
+	m_visible_siz = m_visible_idx.size();
+	if (m_visible_buf_id == EMPTY_VBO || m_visible_siz == 0)
+		return m_visible_siz;
+
+	// Orphan old storage, earlier passes may still be reading it.
+	glBindBuffer(GL_ARRAY_BUFFER, m_visible_buf_id);
+	glBufferData(GL_ARRAY_BUFFER, m_instance_capacity * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_visible_siz * sizeof(GLuint), m_visible_idx.data());
+	return m_visible_siz;
 }
 
 void ModelInstanced::draw() {
+	flush_dirty();
+	if (m_visible_siz == 0)
+		return;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_instance_transforms_binding, m_transform_buf_id);
 	auto& meshes = m_model_base.get_meshes();
 	for (auto& mesh : meshes) {
-		mesh.draw_instances(m_instances_siz);
+		mesh.draw_instances(static_cast<int>(m_visible_siz));
 	}
 }
 
 void ModelInstanced::draw(ShaderProgram& a_shader, const std::string& a_material_map_uniform_name) {
+	flush_dirty();
+	if (m_visible_siz == 0)
+		return;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_instance_transforms_binding, m_transform_buf_id);
 	auto& meshes = m_model_base.get_meshes();
 	for (auto& mesh : meshes) {
 		if (a_material_map_uniform_name != "")
 			a_shader.set_uniform(a_material_map_uniform_name, mesh.get_material_map());
-		mesh.draw_instances(m_instances_siz);
+		mesh.draw_instances(static_cast<int>(m_visible_siz));
 	}
 }
 
@@ -540,39 +851,32 @@ Model& ModelInstanced::get_model_base() noexcept {
 	return m_model_base;
 }
 
-std::vector<glm::vec3>& ModelInstanced::get_positions() noexcept { 
+Vec3Array& ModelInstanced::get_positions() noexcept { 
 	return m_instanced_vecs[ModelInstancedVecs::POSITIONS];
 }
 
-std::vector<glm::vec3>& ModelInstanced::get_rotations() noexcept { 
+Vec3Array& ModelInstanced::get_rotations() noexcept { 
 	return m_instanced_vecs[ModelInstancedVecs::ROTATIONS];
 }
 
-std::vector<glm::vec3>& ModelInstanced::get_size() noexcept {
+Vec3Array& ModelInstanced::get_size() noexcept {
 	return m_instanced_vecs[ModelInstancedVecs::SIZES];
 }
 
-glm::mat4 ModelInstanced::calculate_model_mat(std::size_t idx) noexcept {
-	auto& pos_vec = m_instanced_vecs[ModelInstancedVecs::POSITIONS];
-	auto& rot_vec = m_instanced_vecs[ModelInstancedVecs::ROTATIONS];
-	auto& siz_vec = m_instanced_vecs[ModelInstancedVecs::SIZES];
-
-	glm::vec3 pos = (idx < pos_vec.size()) ? pos_vec[idx] : m_model_base.get_pos();
-	glm::vec3 rot = (idx < rot_vec.size()) ? rot_vec[idx] : m_model_base.get_rotation();
-	glm::vec3 siz = (idx < siz_vec.size()) ? siz_vec[idx] : m_model_base.get_size();
+std::size_t ModelInstanced::get_instance_count() const noexcept {
+	return m_instances_siz;
+}
 
-	glm::mat4 transform_pos = glm::translate(glm::mat4(1.0f), pos); 
-	glm::mat4 transform_scale = glm::scale(glm::mat4(1.0f), siz); 
-	glm::mat4 transform_rotation(1.0f);
-	transform_rotation = glm::rotate(transform_rotation, glm::radians(rot[0]), glm::vec3(1.0, 0.0, 0.0));
-	transform_rotation = glm::rotate(transform_rotation, glm::radians(rot[1]), glm::vec3(0.0, 1.0, 0.0));
-	transform_rotation = glm::rotate(transform_rotation, glm::radians(rot[2]), glm::vec3(0.0, 0.0, 1.0));
+std::size_t ModelInstanced::get_visible_count() const noexcept {
+	return m_visible_siz;
+}
 
-	return transform_pos * transform_rotation * transform_scale;
+std::size_t ModelInstanced::get_instance_capacity() const noexcept {
+	return m_instance_capacity;
 }
 
-glm::mat3 ModelInstanced::calculate_normal_mat(std::size_t idx) noexcept {
-	return glm::transpose(glm::inverse(glm::mat3(m_model_mats[idx])));
+bool ModelInstanced::is_animated() const noexcept {
+	return m_animated;
 }
 
 void ModelInstanced::calculate_model_mats() noexcept {
@@ -585,64 +889,101 @@ void ModelInstanced::calculate_model_mats() noexcept {
 		max_siz = max_siz < size ? size : max_siz;
 	}
 
-	m_model_mats.clear();
-	m_model_mats.reserve(max_siz); 
-	for (std::size_t i = 0; i < max_siz; ++i) {
-		m_model_mats.push_back(calculate_model_mat(i));
+	// Instances missing some of vectors use base model's transform
+	pos_vec.resize(max_siz, m_model_base.get_pos());
+	rot_vec.resize(max_siz, m_model_base.get_rotation());
+	siz_vec.resize(max_siz, m_model_base.get_size());
+
+	m_transforms.resize(max_siz);
+	compose_transforms(pos_vec, rot_vec, siz_vec, BoundingSphere(m_model_base.get_aabb()), m_transforms.data(), m_instance_spheres);
+	m_instances_siz = m_transforms.size();
+}
+
+// Matrices of animated instances stay on GPU, so each sphere bounds arc instance travels during window starting at a_time.
+// Arc is bounded from its midpoint, instances fast enough to cover half orbit get sphere of whole orbit.
+void ModelInstanced::update_motion_spheres(float a_time) {
+	BoundingSphere local(m_model_base.get_aabb());
+	m_sphere_window = a_time;
+	m_instance_spheres.clear();
+	m_instance_spheres.reserve(m_motions.size());
+	for (const auto& motion : m_motions) {
+		float max_scale = std::max({ motion.size.x, motion.size.y, motion.size.z });
+		float model_radius = (glm::length(local.center) + local.radius) * max_scale;
+		float arc = std::abs(motion.angular_speed) * g_motion_sphere_window;
+		glm::vec3 center = m_orbit_center + glm::vec3(0.0f, motion.height, 0.0f);
+		if (arc >= glm::pi<float>()) {
+			m_instance_spheres.push(BoundingSphere{ center, motion.radius + model_radius });
+			continue;
+		}
+
+		float mid_angle = motion.phase + motion.angular_speed * (a_time + 0.5f * g_motion_sphere_window);
+		center += glm::vec3(std::cos(mid_angle), 0.0f, std::sin(mid_angle)) * motion.radius;
+		m_instance_spheres.push(BoundingSphere{ center, 2.0f * motion.radius * std::sin(0.25f * arc) + model_radius });
 	}
-	m_instances_siz = m_model_mats.size();
 }
 
-void ModelInstanced::calculate_normal_mats() noexcept {
-	m_normal_mats.clear();
-	m_normal_mats.reserve(m_model_mats.size());
+// Storage is reallocated only when instance count outgrows capacity, attribute setup happens once per VAO.
+void ModelInstanced::reserve_instance_buffers(std::size_t a_siz) {
+	bool created = m_visible_buf_id == EMPTY_VBO;
+	if (created || a_siz > m_instance_capacity) {
+		m_instance_capacity = std::max({ a_siz, m_instance_capacity * 2, g_instance_min_capacity });
+		create_instance_buffer(m_transform_buf_id, m_transform_buf_handle, GL_SHADER_STORAGE_BUFFER, m_instance_capacity * sizeof(InstanceTransform));
+		create_instance_buffer(m_visible_buf_id, m_visible_buf_handle, GL_ARRAY_BUFFER, m_instance_capacity * sizeof(GLuint));
 
-	for (std::size_t i = 0; i < m_model_mats.size(); ++i) {
-		m_normal_mats.push_back(calculate_normal_mat(i));
+		// New storage is empty, everything has to be uploaded again.
+		m_dirty_ranges.clear();
+		mark_dirty(0, m_transforms.size());
+		m_visible_siz = 0;
 	}
+	if (!m_stream_buf)
+		m_stream_buf = std::make_shared<StreamBuffer>(g_instance_min_capacity * sizeof(InstanceTransform));
+	if (created)
+		setup_instance_attrib();
 }
 
-// Modifies attribute pointers of original mesh.
-auto ModelInstanced::create_model_instanced_arr(const std::vector<glm::mat4>& a_model_mats) -> void {
-	m_instances_siz = a_model_mats.size();
-	if (m_model_mat_buf_id != EMPTY_VBO)
-		glDeleteBuffers(1, &m_model_mat_buf_id);
+void ModelInstanced::create_instance_buffer(GLuint& a_buf_id, ResourceHandle& a_handle, GLenum a_target, std::size_t a_siz) {
+	if (a_buf_id == EMPTY_VBO) {
+		a_buf_id = Application::get_instance().get_rmanager().get_gl_objects().gen(GLObjectType::BUFFER);
+		a_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::INSTANCED_ARRAYS, a_buf_id);
+	}
 
-	glGenBuffers(1, &m_model_mat_buf_id);
-	glBindBuffer(GL_ARRAY_BUFFER, m_model_mat_buf_id);
-	glBufferData(GL_ARRAY_BUFFER, m_instances_siz * sizeof(glm::mat4), a_model_mats.data(), GL_STATIC_DRAW);
+	glBindBuffer(a_target, a_buf_id);
+	glBufferData(a_target, a_siz, nullptr, GL_DYNAMIC_DRAW);
+	Application::get_instance().get_rmanager().track_memory(ResourceType::INSTANCED_ARRAYS, a_handle, a_siz);
+}
 
+// Modifies attribute pointers of original mesh.
+void ModelInstanced::setup_instance_attrib() {
+	glBindBuffer(GL_ARRAY_BUFFER, m_visible_buf_id);
 	auto& meshes = m_model_base.get_meshes();
 	for (auto& mesh : meshes) {
 		GLuint VAO = mesh.get_VAO(); 
 		glBindVertexArray(VAO); 
-		for (int i = 0; i < 4; ++i) {
-			glVertexAttribPointer(g_attrib_model_mat_arr_location + i, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(glm::vec4), (void*)(i * sizeof(glm::vec4)));
-			glEnableVertexAttribArray(g_attrib_model_mat_arr_location + i); 
-			glVertexAttribDivisor(g_attrib_model_mat_arr_location + i, 1);
-		}
+		glVertexAttribIPointer(g_attrib_instance_idx_location, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+		glEnableVertexAttribArray(g_attrib_instance_idx_location); 
+		glVertexAttribDivisor(g_attrib_instance_idx_location, 1);
 	}
 	glBindVertexArray(0);
 }
 
-auto ModelInstanced::create_normal_instanced_arr(const std::vector<glm::mat3>& a_normal_mats) -> void {
-	if (m_normal_mat_buf_id != EMPTY_VBO)
-		glDeleteBuffers(1, &m_normal_mat_buf_id);
+// Until first cull every instance is visible.
+void ModelInstanced::reset_visible() {
+	m_visible_idx.resize(m_transforms.size());
+	std::iota(m_visible_idx.begin(), m_visible_idx.end(), 0);
+	m_visible_siz = m_visible_idx.size();
+	if (m_visible_siz == 0)
+		return;
 
-	glGenBuffers(1, &m_normal_mat_buf_id);
-	glBindBuffer(GL_ARRAY_BUFFER, m_normal_mat_buf_id);
-	glBufferData(GL_ARRAY_BUFFER, a_normal_mats.size() * sizeof(glm::mat3), a_normal_mats.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, m_visible_buf_id);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_visible_siz * sizeof(GLuint), m_visible_idx.data());
+}
 
-	auto& meshes = m_model_base.get_meshes();
-	for (auto& mesh : meshes) {
-		GLuint VAO = mesh.get_VAO(); 
-		glBindVertexArray(VAO); 
-		for (int i = 0; i < 3; ++i) {
-			glVertexAttribPointer(g_attrib_normal_mat_arr_location + i, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(glm::vec3), (void*)(i * sizeof(glm::vec3))); 
-			glEnableVertexAttribArray(g_attrib_normal_mat_arr_location + i); 
-			glVertexAttribDivisor(g_attrib_normal_mat_arr_location + i, 1);
-		}
-	}
-	glBindVertexArray(0);
+void ModelInstanced::mark_dirty(std::size_t a_begin, std::size_t a_end) {
+	if (a_begin >= a_end)
+		return;
+	if (!m_dirty_ranges.empty() && m_dirty_ranges.back().second == a_begin)
+		m_dirty_ranges.back().second = a_end;
+	else
+		m_dirty_ranges.emplace_back(a_begin, a_end);
+}
 }
-}
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include <format>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "chill_renderer/occlusion.hpp"
+#include "chill_renderer/simd.hpp"
+#include "chill_renderer/assert.hpp"
+#include "chill_renderer/application.hpp"
+
+namespace chill_renderer {
+// Vertices closer than this (clip w) are treated as crossing near plane.
+static constexpr float g_occlusion_min_w = 1e-4f;
+
+// Float to pixel coordinate, clamped first so vertices close to near plane can't overflow int.
+static int to_pixel(float a_coord, int a_siz) {
+	return static_cast<int>(std::clamp(a_coord, -1.f, static_cast<float>(a_siz)));
+}
+
+OcclusionBuffer::OcclusionBuffer(int a_width, int a_height) {
+	resize(a_width, a_height);
+}
+
+// Dimensions are rounded up to whole tiles.
+void OcclusionBuffer::resize(int a_width, int a_height) {
+	if (a_width <= 0 || a_height <= 0)
+		ERROR(std::format("[OCCLUSIONBUFFER::RESIZE] Bad resolution: {}x{}", a_width, a_height), Error_action::throwing);
+
+	m_tiles_x = (a_width + g_occlusion_tile_siz - 1) / g_occlusion_tile_siz;
+	m_tiles_y = (a_height + g_occlusion_tile_siz - 1) / g_occlusion_tile_siz;
+	m_width = m_tiles_x * g_occlusion_tile_siz;
+	m_height = m_tiles_y * g_occlusion_tile_siz;
+	m_depth.resize(static_cast<std::size_t>(m_width) * m_height);
+	m_tile_max_depth.resize(static_cast<std::size_t>(m_tiles_x) * m_tiles_y);
+	clear();
+}
+
+void OcclusionBuffer::clear() {
+	m_triangles.clear();
+	std::fill(m_depth.begin(), m_depth.end(), 1.f);
+	std::fill(m_tile_max_depth.begin(), m_tile_max_depth.end(), 1.f);
+}
+
+void OcclusionBuffer::set_view_proj(const glm::mat4& a_view_proj) noexcept {
+	m_view_proj = a_view_proj;
+}
+
+void OcclusionBuffer::add_occluder(const glm::mat4& a_model_mat, const std::vector<glm::vec3>& a_positions, const std::vector<unsigned int>& a_indicies) {
+	const glm::mat4 mvp = m_view_proj * a_model_mat;
+	const std::size_t tri_siz = a_indicies.empty() ? a_positions.size() / 3 : a_indicies.size() / 3;
+
+	auto to_screen = [this](const glm::vec4& a_clip) {
+			glm::vec3 ndc = glm::vec3(a_clip) / a_clip.w;
+			return glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, glm::clamp(ndc.z * 0.5f + 0.5f, 0.f, 1.f));
+		};
+
+	for (std::size_t i = 0; i < tri_siz; ++i) {
+		glm::vec4 clip[3];
+		for (int j = 0; j < 3; ++j) {
+			std::size_t idx = a_indicies.empty() ? i * 3 + j : a_indicies[i * 3 + j];
+			clip[j] = mvp * glm::vec4(a_positions[idx], 1.0f);
+		}
+
+		// Clip against near plane (z = -w), big occluders like floors almost always cross it.
+		glm::vec4 poly[4];
+		int poly_siz = 0;
+		for (int j = 0; j < 3; ++j) {
+			const glm::vec4& a = clip[j];
+			const glm::vec4& b = clip[(j + 1) % 3];
+			float da = a.z + a.w;
+			float db = b.z + b.w;
+			if (da >= 0.f)
+				poly[poly_siz++] = a;
+			if ((da >= 0.f) != (db >= 0.f))
+				poly[poly_siz++] = a + (b - a) * (da / (da - db));
+		}
+
+		for (int j = 1; j + 1 < poly_siz; ++j) {
+			if (poly[0].w < g_occlusion_min_w || poly[j].w < g_occlusion_min_w || poly[j + 1].w < g_occlusion_min_w)
+				continue;
+
+			Triangle tri{ to_screen(poly[0]), to_screen(poly[j]), to_screen(poly[j + 1]) };
+			float area2 = (tri.v1.x - tri.v0.x) * (tri.v2.y - tri.v0.y) - (tri.v2.x - tri.v0.x) * (tri.v1.y - tri.v0.y);
+			// Both facings are rasterized, face culling is per shader so open meshes may be seen from behind.
+			if (area2 == 0.f)
+				continue;
+			if (area2 < 0.f)
+				std::swap(tri.v1, tri.v2);
+
+			float min_x = std::min({ tri.v0.x, tri.v1.x, tri.v2.x });
+			float max_x = std::max({ tri.v0.x, tri.v1.x, tri.v2.x });
+			float min_y = std::min({ tri.v0.y, tri.v1.y, tri.v2.y });
+			float max_y = std::max({ tri.v0.y, tri.v1.y, tri.v2.y });
+			if (max_x < 0.f || max_y < 0.f || min_x >= m_width || min_y >= m_height)
+				continue;
+
+			m_triangles.push_back(tri);
+		}
+	}
+}
+
+// Rows are split into bands of whole tiles so jobs never write the same pixels.
+void OcclusionBuffer::rasterize() {
+	Application::get_instance().get_jobs().parallel_for(0, m_height, g_occlusion_tile_siz, [this](std::size_t a_begin, std::size_t a_end) {
+			rasterize_rows(static_cast<int>(a_begin), static_cast<int>(a_end));
+		}, "occlusion_rasterize");
+}
+
+void OcclusionBuffer::rasterize_rows(int a_row_begin, int a_row_end) {
+	for (const auto& tri : m_triangles) {
+		const glm::vec3& v0 = tri.v0;
+		const glm::vec3& v1 = tri.v1;
+		const glm::vec3& v2 = tri.v2;
+
+		int min_y = std::max(a_row_begin, to_pixel(std::floor(std::min({ v0.y, v1.y, v2.y })), m_height));
+		int max_y = std::min(a_row_end - 1, to_pixel(std::ceil(std::max({ v0.y, v1.y, v2.y })), m_height));
+		if (min_y > max_y)
+			continue;
+		// Align to SIMD width, width is multiple of tile size so loads stay inside the row.
+		int min_x = std::max(0, to_pixel(std::floor(std::min({ v0.x, v1.x, v2.x })), m_width)) & ~3;
+		int max_x = std::min(m_width - 1, to_pixel(std::ceil(std::max({ v0.x, v1.x, v2.x })), m_width));
+
+		// Edge function of edge a->b is A * x + B * y + C, positive on interior side for CCW triangles.
+		auto edge = [](const glm::vec3& a, const glm::vec3& b) {
+				float A = a.y - b.y;
+				float B = b.x - a.x;
+				return glm::vec3(A, B, -A * a.x - B * a.y);
+			};
+		glm::vec3 e0 = edge(v1, v2);
+		glm::vec3 e1 = edge(v2, v0);
+		glm::vec3 e2 = edge(v0, v1);
+
+		// Depth is affine in screen space.
+		float area2 = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+		float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area2;
+		float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area2;
+		float z_c = v0.z - dzdx * v0.x - dzdy * v0.y;
+
+		for (int y = min_y; y <= max_y; ++y) {
+			float* row = &m_depth[static_cast<std::size_t>(y) * m_width];
+			float py = y + 0.5f;
+			float e0_row = e0.y * py + e0.z;
+			float e1_row = e1.y * py + e1.z;
+			float e2_row = e2.y * py + e2.z;
+			float z_row = dzdy * py + z_c;
+
+			int x = min_x;
+#if defined(CHILL_SIMD_SSE)
+			const __m128 lane_offs = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+			for (; x + 4 <= m_width && x <= max_x; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane_offs);
+				__m128 w0 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(e0.x)), _mm_set1_ps(e0_row));
+				__m128 w1 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(e1.x)), _mm_set1_ps(e1_row));
+				__m128 w2 = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(e2.x)), _mm_set1_ps(e2_row));
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(dzdx)), _mm_set1_ps(z_row));
+				__m128 cur = _mm_loadu_ps(row + x);
+				__m128 res = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(cur, z)), _mm_andnot_ps(inside, cur));
+				_mm_storeu_ps(row + x, res);
+			}
+#endif
+			for (; x <= max_x; ++x) {
+				float px = x + 0.5f;
+				if (e0.x * px + e0_row >= 0.f && e1.x * px + e1_row >= 0.f && e2.x * px + e2_row >= 0.f)
+					row[x] = std::min(row[x], dzdx * px + z_row);
+			}
+		}
+	}
+
+	// Farthest depth of each tile in this band.
+	for (int ty = a_row_begin / g_occlusion_tile_siz; ty * g_occlusion_tile_siz < a_row_end; ++ty) {
+		for (int tx = 0; tx < m_tiles_x; ++tx) {
+			float tile_max = 0.f;
+			for (int y = ty * g_occlusion_tile_siz; y < (ty + 1) * g_occlusion_tile_siz; ++y) {
+				const float* row = &m_depth[static_cast<std::size_t>(y) * m_width + tx * g_occlusion_tile_siz];
+				for (int x = 0; x < g_occlusion_tile_siz; ++x) {
+					tile_max = std::max(tile_max, row[x]);
+				}
+			}
+			m_tile_max_depth[static_cast<std::size_t>(ty) * m_tiles_x + tx] = tile_max;
+		}
+	}
+}
+
+bool OcclusionBuffer::test_aabb(const AABB& a_aabb) const {
+	if (!a_aabb.is_valid())
+		return true;
+
+	float min_x = std::numeric_limits<float>::max();
+	float min_y = std::numeric_limits<float>::max();
+	float max_x = std::numeric_limits<float>::lowest();
+	float max_y = std::numeric_limits<float>::lowest();
+	float min_z = 1.f;
+	for (int i = 0; i < 8; ++i) {
+		glm::vec3 corner{
+			(i & 1) ? a_aabb.max.x : a_aabb.min.x,
+			(i & 2) ? a_aabb.max.y : a_aabb.min.y,
+			(i & 4) ? a_aabb.max.z : a_aabb.min.z,
+		};
+		glm::vec4 clip = m_view_proj * glm::vec4(corner, 1.0f);
+		// Box crosses near plane, camera is basically inside it.
+		if (clip.w < g_occlusion_min_w)
+			return true;
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		min_x = std::min(min_x, (ndc.x * 0.5f + 0.5f) * m_width);
+		max_x = std::max(max_x, (ndc.x * 0.5f + 0.5f) * m_width);
+		min_y = std::min(min_y, (ndc.y * 0.5f + 0.5f) * m_height);
+		max_y = std::max(max_y, (ndc.y * 0.5f + 0.5f) * m_height);
+		min_z = std::min(min_z, ndc.z * 0.5f + 0.5f);
+	}
+
+	int x0 = std::max(0, to_pixel(std::floor(min_x), m_width));
+	int y0 = std::max(0, to_pixel(std::floor(min_y), m_height));
+	int x1 = std::min(m_width - 1, to_pixel(std::ceil(max_x), m_width));
+	int y1 = std::min(m_height - 1, to_pixel(std::ceil(max_y), m_height));
+	// Outside of screen, leave it to frustum culling.
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	for (int ty = y0 / g_occlusion_tile_siz; ty <= y1 / g_occlusion_tile_siz; ++ty) {
+		for (int tx = x0 / g_occlusion_tile_siz; tx <= x1 / g_occlusion_tile_siz; ++tx) {
+			if (min_z > m_tile_max_depth[static_cast<std::size_t>(ty) * m_tiles_x + tx])
+				continue;
+
+			// Box may be in front somewhere in this tile, check pixels it covers.
+			int py0 = std::max(y0, ty * g_occlusion_tile_siz);
+			int py1 = std::min(y1, (ty + 1) * g_occlusion_tile_siz - 1);
+			int px0 = std::max(x0, tx * g_occlusion_tile_siz);
+			int px1 = std::min(x1, (tx + 1) * g_occlusion_tile_siz - 1);
+			for (int y = py0; y <= py1; ++y) {
+				const float* row = &m_depth[static_cast<std::size_t>(y) * m_width];
+				for (int x = px0; x <= px1; ++x) {
+					if (min_z <= row[x])
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+int OcclusionBuffer::get_width() const noexcept {
+	return m_width;
+}
+
+int OcclusionBuffer::get_height() const noexcept {
+	return m_height;
+}
+
+std::size_t OcclusionBuffer::get_triangle_count() const noexcept {
+	return m_triangles.size();
+}
+
+const std::vector<float>& OcclusionBuffer::get_depth() const noexcept {
+	return m_depth;
+}
+}
@@ -0,0 +1,107 @@
+#include "chill_renderer/occlusion_queries.hpp"
+
+namespace chill_renderer {
+OcclusionQueries::OcclusionQueries(OcclusionQueries&& a_queries) noexcept {
+	m_conditional = a_queries.m_conditional;
+	m_queries = std::move(a_queries.m_queries);
+
+	a_queries.m_conditional = false;
+	a_queries.m_queries.clear();
+}
+
+OcclusionQueries& OcclusionQueries::operator=(OcclusionQueries&& a_queries) noexcept {
+	if (this != &a_queries) {
+		release();
+		m_conditional = a_queries.m_conditional;
+		m_queries = std::move(a_queries.m_queries);
+
+		a_queries.m_conditional = false;
+		a_queries.m_queries.clear();
+	}
+	return *this;
+}
+
+OcclusionQueries::~OcclusionQueries() {
+	release();
+}
+
+void OcclusionQueries::release() noexcept {
+	for (const auto& query : m_queries) {
+		glDeleteQueries(1, &query.id);
+	}
+	m_queries.clear();
+}
+
+void OcclusionQueries::begin_frame(std::size_t a_siz) {
+	if (a_siz != m_queries.size()) {
+		release();
+		m_queries.resize(a_siz);
+		for (auto& query : m_queries) {
+			glGenQueries(1, &query.id);
+		}
+		return;
+	}
+
+	for (auto& query : m_queries) {
+		if (query.visible_frames > 0)
+			query.visible_frames--;
+		if (!query.pending)
+			continue;
+
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+			continue;
+
+		GLuint any_samples = GL_FALSE;
+		glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &any_samples);
+		query.pending = false;
+		if (any_samples != GL_FALSE)
+			query.visible_frames = g_query_visible_frames;
+	}
+}
+
+void OcclusionQueries::invalidate(std::size_t a_idx) noexcept {
+	auto& query = m_queries[a_idx];
+	query.issued = false;
+	query.pending = false;
+	query.visible_frames = 0;
+}
+
+bool OcclusionQueries::needs_query(std::size_t a_idx) const noexcept {
+	return m_queries[a_idx].visible_frames == 0;
+}
+
+void OcclusionQueries::begin_query(std::size_t a_idx) {
+	auto& query = m_queries[a_idx];
+	query.issued = true;
+	query.pending = true;
+	glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, query.id);
+}
+
+void OcclusionQueries::end_query() {
+	glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+}
+
+// Objects known to be visible are drawn unconditionally.
+void OcclusionQueries::begin_conditional(std::size_t a_idx) {
+	const auto& query = m_queries[a_idx];
+	if (!query.issued || query.visible_frames > 0)
+		return;
+
+	glBeginConditionalRender(query.id, GL_QUERY_NO_WAIT);
+	m_conditional = true;
+}
+
+void OcclusionQueries::end_conditional() {
+	if (!m_conditional)
+		return;
+
+	glEndConditionalRender();
+	m_conditional = false;
+}
+
+std::size_t OcclusionQueries::get_size() const noexcept {
+	return m_queries.size();
+}
+}
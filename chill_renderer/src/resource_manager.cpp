@@ -1,12 +1,61 @@
 #include <filesystem>
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 
 #include "chill_renderer/resource_manager.hpp"
+#include "chill_renderer/texture_compression.hpp"
 #include "chill_renderer/file_manager.hpp"
+#include "chill_renderer/application.hpp"
 
 namespace chill_renderer {
 namespace fs = std::filesystem;
 
+static constexpr std::uint64_t g_hash_offset = 14695981039346656037ull;
+static constexpr std::uint64_t g_hash_prime = 1099511628211ull;
+
+// FNV-1a taking 8 byte words, so hashing whole images stays cheap next to decoding them.
+static std::uint64_t hash_bytes(const void* a_data, std::size_t a_siz, std::uint64_t a_hash = g_hash_offset) {
+	const auto* bytes = static_cast<const unsigned char*>(a_data);
+	std::size_t i = 0;
+	for (; i + sizeof(std::uint64_t) <= a_siz; i += sizeof(std::uint64_t)) {
+		std::uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		a_hash = (a_hash ^ word) * g_hash_prime;
+		a_hash ^= a_hash >> 32;
+	}
+	for (; i < a_siz; ++i) {
+		a_hash = (a_hash ^ bytes[i]) * g_hash_prime;
+	}
+	return a_hash;
+}
+
+static std::uint64_t hash_path(const std::wstring& a_path) {
+	return hash_bytes(a_path.data(), a_path.size() * sizeof(wchar_t));
+}
+
+static std::uint64_t hash_flags(std::uint64_t a_hash, bool a_flip, bool a_gamma_corr) {
+	unsigned char flags = static_cast<unsigned char>(a_flip) | static_cast<unsigned char>(a_gamma_corr) << 1;
+	return hash_bytes(&flags, sizeof(flags), a_hash);
+}
+
+// Same file reached by different relative paths gets same key. Unresolved path is kept as is, loading it throws anyway.
+static std::uint64_t path_key(const std::wstring& a_path, bool a_flip, bool a_gamma_corr) {
+	fs::path p = guess_path(a_path);
+	return hash_flags(hash_path(p.empty() ? a_path : p.wstring()), a_flip, a_gamma_corr);
+}
+
+static std::uint64_t hash_image(const ImageData& a_image) {
+	int dims[] = { a_image.width, a_image.height, a_image.channels };
+	return hash_bytes(a_image.pixels.get(), a_image.get_byte_size(), hash_bytes(dims, sizeof(dims)));
+}
+
+static std::uint64_t hash_image(const CompressedImage& a_image) {
+	int dims[] = { a_image.levels.empty() ? 0 : a_image.levels[0].width, a_image.levels.empty() ? 0 : a_image.levels[0].height, static_cast<int>(a_image.format) };
+	return hash_bytes(a_image.get_data(), a_image.get_byte_size(), hash_bytes(dims, sizeof(dims)));
+}
+
 // TODO: Async file manager
 std::wstring ResourceManager::dialog_import_model() {
 	std::vector<std::pair<std::wstring, std::wstring>> filters{
@@ -18,80 +67,148 @@ std::wstring ResourceManager::dialog_import_model() {
 }
 
 ShaderProgram ResourceManager::new_shader(const ShaderSrc& a_vertex_shader, const ShaderSrc& a_fragment_shader, const ShaderSrc& a_geometry_shader) {
-	const std::wstring& vert_path = a_vertex_shader.get_path();
-	const std::wstring& frag_path = a_fragment_shader.get_path();
-	const std::wstring& geom_path = a_geometry_shader.get_path();
-	// Check if shader is cached.
-	auto it = std::find_if(m_shaders_cached.cbegin(), m_shaders_cached.cend(),
-		[&vert_path, &frag_path, &geom_path](const auto& elem) {
-			ShaderProgram* cached_shader = elem.second.get();
-			if (cached_shader != nullptr) {
-				const std::wstring& cached_vert_path = cached_shader->get_vert_shader().get_path();
-				const std::wstring& cached_frag_path = cached_shader->get_frag_shader().get_path();
-				const std::wstring& cached_geom_path = cached_shader->get_geom_shader().get_path();
-				if (cached_vert_path == vert_path && cached_frag_path == frag_path && cached_geom_path == geom_path)
-					return true;
-			}
-			return false;
-		});
+	// Shader source paths are canonical already.
+	std::uint64_t key = hash_path(a_vertex_shader.get_path() + L'|' + a_fragment_shader.get_path() + L'|' + a_geometry_shader.get_path());
+	if (ShaderProgram* cached_shader = find_cached_shader(key))
+		return *cached_shader;
 
 	// If shader is not cached then cache it.
-	if (it == m_shaders_cached.end()) {
-		ShaderProgram a_shader_program(a_vertex_shader, a_fragment_shader, a_geometry_shader);
-		m_shaders_cached[a_shader_program.get_id()] = std::make_unique<ShaderProgram>(a_shader_program);
-		return *m_shaders_cached[a_shader_program.get_id()];
-	}
+	ShaderProgram a_shader_program(a_vertex_shader, a_fragment_shader, a_geometry_shader);
+	auto& cached_shader = m_shaders_cached[a_shader_program.get_id()];
+	cached_shader = std::make_unique<ShaderProgram>(a_shader_program);
+	m_shader_index[key] = cached_shader->get_handle();
+	return *cached_shader;
+}
 
-	// Return cached shader.
-	return *it->second;
+ShaderProgram ResourceManager::new_shader(const ShaderSrc& a_compute_shader) {
+	std::uint64_t key = hash_path(L"comp|" + a_compute_shader.get_path());
+	if (ShaderProgram* cached_shader = find_cached_shader(key))
+		return *cached_shader;
+
+	ShaderProgram a_shader_program(a_compute_shader);
+	auto& cached_shader = m_shaders_cached[a_shader_program.get_id()];
+	cached_shader = std::make_unique<ShaderProgram>(a_shader_program);
+	m_shader_index[key] = cached_shader->get_handle();
+	return *cached_shader;
+}
+
+// Index entry of released shader is dropped, its GL id might belong to another program by now.
+ShaderProgram* ResourceManager::find_cached_shader(std::uint64_t a_key) {
+	auto it = m_shader_index.find(a_key);
+	if (it == m_shader_index.end())
+		return nullptr;
+
+	auto cached = m_shaders_cached.find(get_pool(ResourceType::SHADER_PROGRAMS).get_id(it->second));
+	if (cached != m_shaders_cached.end() && cached->second != nullptr && cached->second->get_handle() == it->second)
+		return cached->second.get();
+
+	m_shader_index.erase(it);
+	return nullptr;
 }
 
 Model ResourceManager::load_model(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) {
-	// Check if model is cached.
-	std::wstring path = guess_path(a_path).wstring();
-	auto it = std::find_if(m_models_cached.begin(), m_models_cached.end(),
-		[&path, &a_flip_UVs, &a_gamma_corr](const auto& elem) {
-			Model* cached_model = elem.second.get();
-			return cached_model != nullptr && 
-				   elem.first == path && 
-				   cached_model->is_flipped() == a_flip_UVs &&
-				   cached_model->is_gamma_corr() == a_gamma_corr;
-		});
+	std::uint64_t key = path_key(a_path, a_flip_UVs, a_gamma_corr);
+	if (auto cached = m_models_cached.find(key); cached != m_models_cached.end())
+		return *cached->second;
 
 	// If model is not cached then cache it.
-	if (it == m_models_cached.end()) {
-		m_models_cached[path] = std::make_unique<Model>(a_path, a_flip_UVs, a_gamma_corr);
+	return cache_model(key, std::make_unique<Model>(a_path, a_flip_UVs, a_gamma_corr));
+}
+
+Model& ResourceManager::cache_model(std::uint64_t a_key, std::unique_ptr<Model> a_model) {
+	for (const auto& mesh : a_model->get_meshes()) {
+		m_mesh_owners[mesh.get_VAO()] = a_key;
 	}
+	return *(m_models_cached[a_key] = std::move(a_model));
+}
+
+int ResourceManager::get_model_ref_count(Model& a_model) noexcept {
+	if (a_model.get_meshes().empty())
+		return 0;
+
+	return get_pool(ResourceType::MESHES).get_ref_count(a_model.get_meshes().front().get_handle()) - 1;
+}
+
+void ResourceManager::evict_model(std::uint64_t a_key) {
+	auto it = m_models_cached.find(a_key);
+	if (it == m_models_cached.end())
+		return;
+
+	// Unlinked before destruction, so meshes released by it don't find their owner again.
+	std::unique_ptr<Model> model = std::move(it->second);
+	m_models_cached.erase(it);
+	for (const auto& mesh : model->get_meshes()) {
+		m_mesh_owners.erase(mesh.get_VAO());
+	}
+}
+
+std::shared_future<Model> ResourceManager::load_model_async(const std::wstring& a_path, bool a_flip_UVs, bool a_gamma_corr) {
+	std::uint64_t key = path_key(a_path, a_flip_UVs, a_gamma_corr);
+	auto cached = m_models_cached.find(key);
+	if (cached != m_models_cached.end()) {
+		std::promise<Model> promise;
+		promise.set_value(*cached->second);
+		return promise.get_future().share();
+	}
+
+	// Same model requested again while loading.
+	for (const auto& [id, pending] : m_pending_models) {
+		if (pending.key == key)
+			return pending.future;
+	}
+
+	std::uint64_t id = m_next_load_id++;
+	PendingModel& pending = m_pending_models[id];
+	pending.key = key;
+	pending.flip_UVs = a_flip_UVs;
+	pending.gamma_corr = a_gamma_corr;
+	pending.future = pending.promise.get_future().share();
+
+	Application::get_instance().get_jobs().submit_background([this, id, a_path, a_flip_UVs, a_gamma_corr]() {
+			LoadResult result{ id };
+			try {
+				if (is_cooked_file(a_path))
+					result.data = std::make_shared<const CookedAsset>(a_path);
+				else
+					result.data = Model::import_file(a_path, a_flip_UVs, a_gamma_corr);
+			}
+			catch (...) {
+				result.error = std::current_exception();
+			}
+			push_result(std::move(result));
+		}, nullptr, "load_model");
 
-	return *m_models_cached[path];
+	return pending.future;
 }
 
 Model ResourceManager::create_model(const std::vector<Mesh>& a_meshes) {
 	return Model(a_meshes);
 }
 
-Texture2D ResourceManager::load_texture(TextureType a_type, const std::wstring& a_path, bool a_flip_image, bool a_gamma_corr) {
-	// Check if texture is cached.
-	std::wstring filename = fs::path(a_path).filename().wstring();
-	auto it = std::find_if(m_textures_cached.begin(), m_textures_cached.end(),
-		[&filename, &a_flip_image, &a_gamma_corr](const auto& elem) {
-			const auto cached_texture = elem.second.get();
-
-			return cached_texture != nullptr &&
-				   cached_texture->get_filename() == filename &&
-				   cached_texture->is_flipped() == a_flip_image &&
-				   cached_texture->is_gamma_corr() == a_gamma_corr;
-		});
+// Index entry of released texture is dropped, its GL id might belong to another texture by now.
+Texture2D* ResourceManager::find_cached_texture(std::unordered_map<std::uint64_t, ResourceHandle>& a_index, std::uint64_t a_key) {
+	auto it = a_index.find(a_key);
+	if (it == a_index.end())
+		return nullptr;
 
-	// If texture is not cached then cache it.
-	if (it == m_textures_cached.end()) {
-		Texture2D new_texture(a_type, a_path, a_flip_image, a_gamma_corr);
-		m_textures_cached[new_texture.get_id()] = std::make_unique<Texture2D>(new_texture);
-		return *m_textures_cached[new_texture.get_id()];
-	}
+	auto cached = m_textures_cached.find(get_pool(ResourceType::TEXTURES).get_id(it->second));
+	if (cached != m_textures_cached.end() && cached->second != nullptr && cached->second->get_handle() == it->second)
+		return cached->second.get();
+
+	a_index.erase(it);
+	return nullptr;
+}
+
+Texture2D& ResourceManager::cache_texture(const Texture2D& a_texture, std::uint64_t a_key) {
+	auto& cached_texture = m_textures_cached[a_texture.get_id()];
+	cached_texture = std::make_unique<Texture2D>(a_texture);
+	m_texture_index[a_key] = cached_texture->get_handle();
+	return *cached_texture;
+}
 
-	// Texture is cached. Modify possibly wrong attributes to match user parameters.
-	Texture2D cached_texture = *it->second;
+// Texture is cached. Modify possibly wrong attributes to match user parameters.
+Texture2D ResourceManager::cached_texture_copy(const Texture2D& a_texture, TextureType a_type) {
+	Texture2D cached_texture = a_texture;
 
 	if (cached_texture.get_type() != a_type)
 		cached_texture.set_type(a_type); 
@@ -101,10 +218,83 @@ Texture2D ResourceManager::load_texture(TextureType a_type, const std::wstring&
 	return cached_texture;
 }
 
+Texture2D ResourceManager::load_texture(TextureType a_type, const std::wstring& a_path, bool a_flip_image, bool a_gamma_corr) {
+	// Check if texture is cached.
+	std::uint64_t key = path_key(a_path, a_flip_image, a_gamma_corr);
+	if (Texture2D* cached_texture = find_cached_texture(m_texture_index, key))
+		return cached_texture_copy(*cached_texture, a_type);
+
+	// Same image found under another path, e.g. duplicated by asset exporter, shares its texture.
+	// Flip is applied to pixels already, only gamma correction changes how they are uploaded.
+	TextureImage image = load_texture_image(a_path, a_flip_image, m_compress_textures);
+	std::uint64_t content_key = hash_flags(std::visit([](const auto& a_image) { return hash_image(a_image); }, image), false, a_gamma_corr);
+	if (Texture2D* same_texture = find_cached_texture(m_texture_contents, content_key)) {
+		m_texture_index[key] = same_texture->get_handle();
+		return cached_texture_copy(*same_texture, a_type);
+	}
+
+	// If texture is not cached then cache it.
+	Texture2D& cached_texture = cache_texture(std::visit([&](const auto& a_image) { return Texture2D(a_type, a_path, a_flip_image, a_gamma_corr, a_image); }, image), key);
+	m_texture_contents[content_key] = cached_texture.get_handle();
+	return cached_texture;
+}
+
+Texture2D ResourceManager::load_texture(TextureType a_type, const std::wstring& a_path, bool a_gamma_corr, const CompressedImage& a_image) {
+	std::uint64_t key = path_key(a_path, false, a_gamma_corr);
+	if (Texture2D* cached_texture = find_cached_texture(m_texture_index, key))
+		return cached_texture_copy(*cached_texture, a_type);
+
+	return cache_texture(Texture2D(a_type, a_path, false, a_gamma_corr, a_image), key);
+}
+
+Texture2D ResourceManager::load_texture_async(TextureType a_type, const std::wstring& a_path, bool a_flip_image, bool a_gamma_corr) {
+	// Cached texture might still be pending, then its copies get the image too.
+	std::uint64_t key = path_key(a_path, a_flip_image, a_gamma_corr);
+	if (Texture2D* cached_texture = find_cached_texture(m_texture_index, key))
+		return cached_texture_copy(*cached_texture, a_type);
+
+	// Content isn't known until image is decoded, so async textures aren't deduplicated, they only become dedup targets.
+	// Image size isn't known yet, so placeholder storage stays mutable until it's respecified by upload.
+	Texture2D new_texture(a_type, a_path, a_flip_image, a_gamma_corr, solid_image(3, g_placeholder_texel), GL_NONE, TextureStorage::MUTABLE);
+	Texture2D& cached_texture = cache_texture(new_texture, key);
+
+	// Pending copy keeps texture alive until its image is uploaded.
+	std::uint64_t id = m_next_load_id++;
+	m_pending_textures.emplace(id, new_texture);
+	submit_image_load(id, new_texture.get_path(), a_flip_image);
+
+	return cached_texture;
+}
+
+void ResourceManager::submit_image_load(std::uint64_t a_id, const std::wstring& a_path, bool a_flip_image) {
+	Application::get_instance().get_jobs().submit_background([this, a_id, a_path, a_flip_image, compress = m_compress_textures]() {
+			LoadResult result{ a_id };
+			try {
+				TextureImage image = load_texture_image(a_path, a_flip_image, compress);
+				result.content_hash = std::visit([](const auto& a_image) { return hash_image(a_image); }, image);
+				std::visit([&result](auto& a_image) { result.data = std::move(a_image); }, image);
+			}
+			catch (...) {
+				result.error = std::current_exception();
+			}
+			push_result(std::move(result));
+		}, nullptr, "load_image");
+}
+
 // TODO: At the moment caching TextureCubemaps is not worth it as long as they don't consist of 6 Texture2D objects.
 TextureCubemap ResourceManager::load_cubemap(TextureType a_type, const std::vector<std::wstring>& a_paths, bool a_flip_images, bool a_gamma_corr) {
 	return TextureCubemap(a_type, a_paths, a_flip_images, a_gamma_corr);
 }
+
+TextureCubemap ResourceManager::load_cubemap_async(TextureType a_type, const std::vector<std::wstring>& a_paths, bool a_flip_images, bool a_gamma_corr) {
+	TextureCubemap cubemap(a_type, a_paths, a_flip_images, a_gamma_corr, solid_image(3, g_placeholder_texel));
+	for (int face = 0; face < static_cast<int>(a_paths.size()); ++face) {
+		std::uint64_t id = m_next_load_id++;
+		m_pending_faces.emplace(id, std::make_pair(cubemap, face));
+		submit_image_load(id, a_paths[face], a_flip_images);
+	}
+	return cubemap;
+}
 //TextureCubemap ResourceManager::load_cubemap(TextureType a_type, const std::vector<std::wstring>& a_paths, bool a_flip_images, bool a_gamma_corr) {
 //	// Check if texture is cached.
 //	std::vector<std::wstring> filenames{};
@@ -159,45 +349,38 @@ RenderBuffer ResourceManager::create_render_buffer(int a_width, int a_height, Re
 	return RenderBuffer(a_width, a_height, a_type);
 }
 
-void ResourceManager::inc_ref_count(ResourceType a_res_type, GLuint a_id) noexcept {
-	auto& res_ref_counter = m_ref_counter[a_res_type];
-
-	auto it = res_ref_counter.find(a_id);
-	if (it == res_ref_counter.end())
-		res_ref_counter[a_id] = 0;
-	res_ref_counter[a_id]++;
+ResourceHandle ResourceManager::new_handle(ResourceType a_res_type, GLuint a_id) {
+	return get_pool(a_res_type).acquire(a_id);
 }
 
-void ResourceManager::dec_ref_count(ResourceType a_res_type, GLuint a_id) noexcept {
-	auto& res_ref_counter = m_ref_counter[a_res_type];
+void ResourceManager::inc_ref_count(ResourceType a_res_type, ResourceHandle a_handle) noexcept {
+	get_pool(a_res_type).inc(a_handle);
+}
 
-	auto it = res_ref_counter.find(a_id);
-	if (it == res_ref_counter.end())
-		return;
-	res_ref_counter[a_id]--;
+int ResourceManager::dec_ref_count(ResourceType a_res_type, ResourceHandle a_handle) noexcept {
+	return get_pool(a_res_type).dec(a_handle) - 1;
 }
 
 // 'True' - there are references to this texture elsewhere.
-// 'False' - there are no references to this texture.
-bool ResourceManager::chk_ref_count(ResourceType a_res_type, GLuint a_id) {
-	auto& res_ref_counter = m_ref_counter[a_res_type];
-
-	auto it = res_ref_counter.find(a_id);
-	if (it == res_ref_counter.end())
+// 'False' - there are no references to this texture, its handle is released.
+bool ResourceManager::chk_ref_count(ResourceType a_res_type, ResourceHandle a_handle, int a_ref_count) {
+	auto& pool = get_pool(a_res_type);
+	if (!pool.is_valid(a_handle))
 		return false;
 
-	int ref_count = it->second;
-	if (ref_count <= 0) {
+	if (a_ref_count <= 0) {
+		pool.release(a_handle);
 		return false;
 	}
 
+	GLuint id = pool.get_id(a_handle);
 	// Check if the last referenced resource is cached, if so delete it.
-	if (ref_count == 1) {
+	if (a_ref_count == 1) {
 		if (a_res_type == ResourceType::SHADER_PROGRAMS) {
 			return true;
-			auto it = m_shaders_cached.find(a_id);
+			auto it = m_shaders_cached.find(id);
 			ShaderProgram* cached_shader = (it == m_shaders_cached.end()) ? nullptr : it->second.get();
-			if (cached_shader != nullptr && cached_shader->get_id() == a_id) {
+			if (cached_shader != nullptr && cached_shader->get_id() == id) {
 				// Resetting should call ShaderProgram's destructor and decrement reference counter.
 				it->second.reset(nullptr);
 				return false;
@@ -205,34 +388,22 @@ bool ResourceManager::chk_ref_count(ResourceType a_res_type, GLuint a_id) {
 		}
 
 		else if (a_res_type == ResourceType::TEXTURES) {
-			auto it = m_textures_cached.find(a_id);
-			Texture2D* cached_texture = (it == m_textures_cached.end()) ? nullptr : it->second.get();
-			if (cached_texture != nullptr && cached_texture->get_id() == a_id) {
-				// Resetting should call Texture's destructor and decrement reference counter.
-				it->second.reset(nullptr);
+			auto it = m_textures_cached.find(id);
+			if (it != m_textures_cached.end() && it->second != nullptr && it->second->get_id() == id) {
+				// Erased before destruction, which calls Texture's destructor and decrements reference counter.
+				auto cached_texture = std::move(it->second);
+				m_textures_cached.erase(it);
 				return false;
 			}
 		}
-		/*
-		TODO: Deleting cached model is a bit performance heavy. Can be optimized by counting Model references and
-		implementing some id generation system. As long as lag is not visible it's good enough.
-		*/
-		// Find if there's a cached model that has this Mesh. If so delete whole Model.
+		// Last reference belongs to cached model that has this Mesh, delete whole Model once no copy of it is left.
 		else if (a_res_type == ResourceType::MESHES) {
-			unsigned mesh_id = a_id;
-			auto it = std::find_if(m_models_cached.begin(), m_models_cached.end(),
-				[mesh_id](const auto& elem) {
-					if (elem.second != nullptr) {
-						std::vector<Mesh>& cached_meshes = elem.second.get()->get_meshes();
-						auto it = std::find_if(cached_meshes.begin(), cached_meshes.end(), [mesh_id](const Mesh& a_mesh) {
-							return a_mesh.get_VAO() == mesh_id;
-							});
-						return it != cached_meshes.end();
-					}
-					return false;
-				});
-			if (it != m_models_cached.end()) {
-				it->second.reset(nullptr);
+			if (auto owner = m_mesh_owners.find(id); owner != m_mesh_owners.end()) {
+				auto cached = m_models_cached.find(owner->second);
+				if (cached != m_models_cached.end() && get_model_ref_count(*cached->second) > 0)
+					return true;
+
+				evict_model(owner->second);
 				return false;
 			}
 		}
@@ -241,10 +412,304 @@ bool ResourceManager::chk_ref_count(ResourceType a_res_type, GLuint a_id) {
 	return true;
 }
 
+void ResourceManager::track_memory(ResourceType a_res_type, ResourceHandle a_handle, std::size_t a_bytes) noexcept {
+	get_pool(a_res_type).set_bytes(a_handle, a_bytes);
+	m_memory_peak = std::max(m_memory_peak, get_memory_usage());
+}
+
+void ResourceManager::set_memory_budget(std::size_t a_bytes) noexcept {
+	m_memory_budget = a_bytes;
+}
+
+MemoryStats ResourceManager::get_memory_stats() const noexcept {
+	MemoryStats stats{ .current = get_memory_usage(), .peak = m_memory_peak, .budget = m_memory_budget };
+	for (std::size_t i = 0; i < m_handle_pools.size(); ++i) {
+		stats.per_type[i] = m_handle_pools[i].get_total_bytes();
+	}
+	return stats;
+}
+
+std::size_t ResourceManager::get_memory_usage() const noexcept {
+	std::size_t bytes{};
+	for (const auto& pool : m_handle_pools) {
+		bytes += pool.get_total_bytes();
+	}
+	return bytes;
+}
+
+// Cached model or texture referenced outside of cache is in use. Once over budget, unused ones are evicted
+// starting with least recently used, until usage fits. Evicted resources are loaded again when requested.
+void ResourceManager::update_residency() {
+	++m_frame;
+	auto& mesh_pool = get_pool(ResourceType::MESHES);
+	auto& texture_pool = get_pool(ResourceType::TEXTURES);
+	// Models are tracked by their first mesh, see get_model_ref_count().
+	for (const auto& [key, model] : m_models_cached) {
+		if (get_model_ref_count(*model) > 0)
+			mesh_pool.touch(model->get_meshes().front().get_handle(), m_frame);
+	}
+	for (const auto& [id, texture] : m_textures_cached) {
+		if (texture != nullptr && texture_pool.get_ref_count(texture->get_handle()) > 1)
+			texture_pool.touch(texture->get_handle(), m_frame);
+	}
+
+	if (get_memory_usage() <= m_memory_budget)
+		return;
+
+	struct Candidate {
+		std::uint64_t last_used{};
+		ResourceType type{};
+		std::uint64_t key{};
+	};
+	std::vector<Candidate> candidates;
+	for (const auto& [key, model] : m_models_cached) {
+		std::uint64_t last_used = model->get_meshes().empty() ? 0 : mesh_pool.get_last_used(model->get_meshes().front().get_handle());
+		if (last_used != m_frame)
+			candidates.push_back({ last_used, ResourceType::MESHES, key });
+	}
+	// Textures of cached models are still referenced by their meshes, they become candidates once model is evicted.
+	for (const auto& [id, texture] : m_textures_cached) {
+		if (texture != nullptr && texture_pool.get_ref_count(texture->get_handle()) == 1)
+			candidates.push_back({ texture_pool.get_last_used(texture->get_handle()), ResourceType::TEXTURES, id });
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a_lhs, const Candidate& a_rhs) {
+			return a_lhs.last_used < a_rhs.last_used;
+		});
+
+	for (const auto& candidate : candidates) {
+		if (get_memory_usage() <= m_memory_budget)
+			break;
+
+		if (candidate.type == ResourceType::MESHES) {
+			evict_model(candidate.key);
+		}
+		else if (auto it = m_textures_cached.find(static_cast<GLuint>(candidate.key)); it != m_textures_cached.end()) {
+			auto cached_texture = std::move(it->second);
+			m_textures_cached.erase(it);
+		}
+	}
+}
+
+void ResourceManager::push_result(LoadResult&& a_result) {
+	std::lock_guard lock(m_results_mutex);
+	m_results.push_back(std::move(a_result));
+}
+
+void ResourceManager::process_uploads(std::size_t a_byte_budget, double a_ms_budget) {
+	auto start = std::chrono::steady_clock::now();
+	update_residency();
+	m_gl_objects.end_frame();
+	if (UploadThread* uploader = Application::get_instance().get_uploader())
+		uploader->poll();
+
+	std::size_t bytes{};
+	while (bytes < a_byte_budget) {
+		LoadResult result;
+		{
+			std::lock_guard lock(m_results_mutex);
+			if (m_results.empty())
+				break;
+			result = std::move(m_results.front());
+			m_results.pop_front();
+		}
+
+		bytes += finish_load(result);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= a_ms_budget)
+			return;
+	}
+
+	// Images queued above count towards the budget only once they are streamed.
+	if (bytes < a_byte_budget)
+		m_texture_streamer.update(a_byte_budget - bytes);
+}
+
+// Creates GL resources of finished load and queues decoded images for streaming, returns uploaded bytes.
+std::size_t ResourceManager::finish_load(LoadResult& a_result) {
+	if (auto tex_it = m_pending_textures.find(a_result.id); tex_it != m_pending_textures.end()) {
+		Texture2D texture = std::move(tex_it->second);
+		m_pending_textures.erase(tex_it);
+
+		// Failed texture keeps its placeholder.
+		try {
+			if (a_result.error)
+				std::rethrow_exception(a_result.error);
+
+			std::uint64_t content_key = hash_flags(a_result.content_hash, false, texture.is_gamma_corr());
+			if (find_cached_texture(m_texture_contents, content_key) == nullptr)
+				m_texture_contents[content_key] = texture.get_handle();
+
+			// Compressed images are small and bring their mips, they're uploaded whole instead of streamed.
+			if (auto* compressed = std::get_if<CompressedImage>(&a_result.data)) {
+				std::size_t bytes = compressed->get_byte_size();
+				if (UploadThread* uploader = Application::get_instance().get_uploader()) {
+					auto held_texture = std::make_shared<Texture2D>(texture);
+					auto held_image = std::make_shared<CompressedImage>(std::move(*compressed));
+					uploader->submit([texture = held_texture.get(), held_image]() { texture->upload(*held_image); },
+						[this, held_texture, bytes]() { track_memory(ResourceType::TEXTURES, held_texture->get_handle(), bytes); });
+					return 0;
+				}
+				texture.upload(*compressed);
+				track_memory(ResourceType::TEXTURES, texture.get_handle(), bytes);
+				return bytes;
+			}
+
+			ImageData& image = std::get<ImageData>(a_result.data);
+			if (UploadThread* uploader = Application::get_instance().get_uploader()) {
+				// Publish holds the copy, so it's released on render thread. Memory is tracked there too.
+				auto held_texture = std::make_shared<Texture2D>(texture);
+				std::size_t bytes = image.get_gpu_size(true);
+				auto held_image = std::make_shared<ImageData>(std::move(image));
+				uploader->submit([texture = held_texture.get(), held_image]() { texture->upload(*held_image); },
+					[this, held_texture, bytes]() { track_memory(ResourceType::TEXTURES, held_texture->get_handle(), bytes); });
+			}
+			else {
+				m_texture_streamer.push(texture, std::move(image));
+			}
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[RESOURCEMANAGER::FINISH_LOAD] Texture {} failed to load: {}", wstos(texture.get_path()), e.what()), Error_action::logging);
+		}
+		return 0;
+	}
+
+	if (auto face_it = m_pending_faces.find(a_result.id); face_it != m_pending_faces.end()) {
+		auto [cubemap, face] = std::move(face_it->second);
+		m_pending_faces.erase(face_it);
+
+		try {
+			if (a_result.error)
+				std::rethrow_exception(a_result.error);
+
+			if (auto* compressed = std::get_if<CompressedImage>(&a_result.data)) {
+				std::size_t bytes = compressed->get_byte_size();
+				if (UploadThread* uploader = Application::get_instance().get_uploader()) {
+					auto held_cubemap = std::make_shared<TextureCubemap>(cubemap);
+					auto held_image = std::make_shared<CompressedImage>(std::move(*compressed));
+					uploader->submit([cubemap = held_cubemap.get(), face, held_image]() { cubemap->upload_face(face, *held_image); },
+						[this, held_cubemap, bytes]() { track_memory(ResourceType::TEXTURES, held_cubemap->get_handle(), 6 * bytes); });
+					return 0;
+				}
+				cubemap.upload_face(face, *compressed);
+				track_memory(ResourceType::TEXTURES, cubemap.get_handle(), 6 * bytes);
+				return bytes;
+			}
+
+			ImageData& image = std::get<ImageData>(a_result.data);
+			if (UploadThread* uploader = Application::get_instance().get_uploader()) {
+				auto held_cubemap = std::make_shared<TextureCubemap>(cubemap);
+				std::size_t bytes = 6 * image.get_gpu_size(false);
+				auto held_image = std::make_shared<ImageData>(std::move(image));
+				uploader->submit([cubemap = held_cubemap.get(), face, held_image]() { cubemap->upload_face(face, *held_image); },
+					[this, held_cubemap, bytes]() { track_memory(ResourceType::TEXTURES, held_cubemap->get_handle(), bytes); });
+			}
+			else {
+				m_texture_streamer.push(cubemap, face, std::move(image));
+			}
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[RESOURCEMANAGER::FINISH_LOAD] Face {} of cubemap {} failed to load: {}", face, cubemap.get_id(), e.what()), Error_action::logging);
+		}
+		return 0;
+	}
+
+	auto model_it = m_pending_models.find(a_result.id);
+	if (model_it == m_pending_models.end())
+		return 0;
+
+	PendingModel pending = std::move(model_it->second);
+	m_pending_models.erase(model_it);
+	if (a_result.error) {
+		pending.promise.set_exception(a_result.error);
+		return 0;
+	}
+
+	// Mapping was validated on worker, buffers and textures are filled straight from it here.
+	if (auto* cooked = std::get_if<std::shared_ptr<const CookedAsset>>(&a_result.data)) {
+		try {
+			if (auto cached = m_models_cached.find(pending.key); cached != m_models_cached.end()) {
+				pending.promise.set_value(*cached->second);
+				return 0;
+			}
+			auto model = std::make_unique<Model>();
+			model->build(**cooked, pending.gamma_corr);
+			pending.promise.set_value(cache_model(pending.key, std::move(model)));
+		}
+		catch (...) {
+			pending.promise.set_exception(std::current_exception());
+		}
+		return (*cooked)->get_byte_size();
+	}
+
+	ModelImport& import = std::get<ModelImport>(a_result.data);
+	if (UploadThread* uploader = Application::get_instance().get_uploader()) {
+		auto held_pending = std::make_shared<PendingModel>(std::move(pending));
+		auto held_import = std::make_shared<ModelImport>(std::move(import));
+		auto buffers = std::make_shared<std::vector<MeshBuffers>>();
+		uploader->submit([held_import, buffers]() {
+				for (const auto& mesh_import : held_import->meshes) {
+					buffers->push_back(Mesh::upload_buffers(mesh_import.data));
+				}
+			},
+			[this, held_pending, held_import, buffers]() { publish_model(*held_pending, *held_import, *buffers); });
+		return 0;
+	}
+
+	publish_model(pending, import, {});
+	return import.get_byte_size();
+}
+
+// Buffers missing in a_buffers, e.g. when upload failed, are uploaded by Model::build().
+void ResourceManager::publish_model(PendingModel& a_pending, const ModelImport& a_import, const std::vector<MeshBuffers>& a_buffers) {
+	try {
+		auto cached = m_models_cached.find(a_pending.key);
+		if (cached == m_models_cached.end()) {
+			auto model = std::make_unique<Model>();
+			model->build(a_import, true, a_buffers);
+			a_pending.promise.set_value(cache_model(a_pending.key, std::move(model)));
+		}
+		else {
+			// Same model finished loading earlier, its meshes are reused.
+			for (const auto& buffers : a_buffers) {
+				for (GLuint id : { buffers.VBO_pos, buffers.VBO_UVs, buffers.VBO_normals, buffers.EBO }) {
+					m_gl_objects.release(GLObjectType::BUFFER, id);
+				}
+			}
+			a_pending.promise.set_value(*cached->second);
+		}
+	}
+	catch (...) {
+		a_pending.promise.set_exception(std::current_exception());
+	}
+}
+
+std::size_t ResourceManager::get_pending_loads() const noexcept {
+	std::size_t pending = m_pending_textures.size() + m_pending_faces.size() + m_pending_models.size() + m_texture_streamer.get_pending();
+	if (UploadThread* uploader = Application::get_instance().get_uploader())
+		pending += uploader->get_pending();
+	return pending;
+}
+
 void ResourceManager::debug(ResourceType a_type) {
-	for (auto& [id, cnt] : m_ref_counter[a_type]) {
+	for (auto [id, cnt] : get_pool(a_type).get_live()) {
 		std::cout << std::format("[ID:{}, \tCOUNT:{}]", id, cnt) << '\n';
 	}
 	std::cout << '\n';
 } 
+
+void ResourceManager::set_texture_compression(bool a_compress) noexcept {
+	m_compress_textures = a_compress;
+}
+
+bool ResourceManager::is_compressing_textures() const noexcept {
+	return m_compress_textures;
+}
+
+GLObjects& ResourceManager::get_gl_objects() noexcept {
+	return m_gl_objects;
+}
+
+HandlePool& ResourceManager::get_pool(ResourceType a_res_type) noexcept {
+	return m_handle_pools[static_cast<std::size_t>(a_res_type)];
+}
 }
\ No newline at end of file
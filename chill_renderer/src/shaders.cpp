@@ -25,6 +25,10 @@ std::string Uniform::get_name() const noexcept {
 	return m_name;
 }
 
+int Uniform::get_location() const noexcept {
+	return m_uniform_location;
+}
+
 ShaderSrc::ShaderSrc(ShaderType a_shader_type, const std::wstring& a_path)
 	:m_type{ a_shader_type }
 {
@@ -38,6 +42,7 @@ ShaderSrc::ShaderSrc(ShaderType a_shader_type, const std::wstring& a_path)
 	case ShaderType::VERTEX:   m_id = glCreateShader(GL_VERTEX_SHADER); break;
 	case ShaderType::FRAGMENT: m_id = glCreateShader(GL_FRAGMENT_SHADER); break;
 	case ShaderType::GEOMETRY: m_id = glCreateShader(GL_GEOMETRY_SHADER); break;
+	case ShaderType::COMPUTE:  m_id = glCreateShader(GL_COMPUTE_SHADER); break;
 	default:
 		ERROR(std::format("[SHADERSRC::SHADERSRC] [{}] Shader type not compatible.", p.string()), Error_action::throwing);
 	}
@@ -71,30 +76,35 @@ ShaderSrc::ShaderSrc(ShaderType a_shader_type, const std::wstring& a_path)
 		glGetShaderInfoLog(m_id, g_info_log_siz, nullptr, infoLog);
 		ERROR(std::format("[SHADERSRC::SHADERSRC] shader {} can't compile. GLSL error message:\n{}", wstos(m_path), infoLog), Error_action::throwing);
 	}
+
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::SHADER_SRCS, m_id);
 }
 
 ShaderSrc::ShaderSrc(const ShaderSrc& a_shader_src) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_SRCS, a_shader_src.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_SRCS, a_shader_src.m_handle);
 
 	m_type = a_shader_src.m_type;
 	m_path = a_shader_src.m_path;
 	m_id = a_shader_src.m_id;
+	m_handle = a_shader_src.m_handle;
 }
 
 ShaderSrc::ShaderSrc(ShaderSrc&& a_shader_src) noexcept {
 	m_type = a_shader_src.m_type;
 	m_path = a_shader_src.m_path;
 	m_id = a_shader_src.m_id;
+	m_handle = a_shader_src.m_handle;
 
 	m_id = EMPTY_VBO;
 }
 
 ShaderSrc& ShaderSrc::operator=(const ShaderSrc& a_shader_src) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_SRCS, a_shader_src.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_SRCS, a_shader_src.m_handle);
 
 	m_type = a_shader_src.m_type;
 	m_path = a_shader_src.m_path;
 	m_id = a_shader_src.m_id;
+	m_handle = a_shader_src.m_handle;
 
 	return *this;
 }
@@ -103,6 +113,7 @@ ShaderSrc& ShaderSrc::operator=(ShaderSrc&& a_shader_src) noexcept {
 	m_type = a_shader_src.m_type;
 	m_path = a_shader_src.m_path;
 	m_id = a_shader_src.m_id;
+	m_handle = a_shader_src.m_handle;
 
 	m_id = EMPTY_VBO;
 
@@ -111,9 +122,9 @@ ShaderSrc& ShaderSrc::operator=(ShaderSrc&& a_shader_src) noexcept {
 
 ShaderSrc::~ShaderSrc() {
 	if (m_id != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::SHADER_SRCS, m_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::SHADER_SRCS, m_id)) {
-			glDeleteShader(m_id);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::SHADER_SRCS, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::SHADER_SRCS, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::SHADER, m_id);
 		}
 	}
 }
@@ -150,34 +161,61 @@ ShaderProgram::ShaderProgram(const ShaderSrc& a_vertex_shader, const ShaderSrc&
 		glGetProgramInfoLog(m_id, g_info_log_siz, nullptr, infoLog);
 		ERROR(std::format("[SHADERPROGRAM::CHECK_LINKING] [{}] [{}] Shader linking error. GLSL error message:\n{}", wstos(a_vertex_shader.get_path()), wstos(a_fragment_shader.get_path()), infoLog), Error_action::throwing);
 	}
+
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::SHADER_PROGRAMS, m_id);
+}
+
+ShaderProgram::ShaderProgram(const ShaderSrc& a_compute_shader) 
+	:m_compute_sh{ a_compute_shader } {
+	m_id = glCreateProgram();
+	glAttachShader(m_id, a_compute_shader.get_id());
+	glLinkProgram(m_id);
+
+	// Check linking
+	int success;
+	glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+	if (!success) {
+		char infoLog[g_info_log_siz] = {};
+		glGetProgramInfoLog(m_id, g_info_log_siz, nullptr, infoLog);
+		ERROR(std::format("[SHADERPROGRAM::CHECK_LINKING] [{}] Shader linking error. GLSL error message:\n{}", wstos(a_compute_shader.get_path()), infoLog), Error_action::throwing);
+	}
+
+	m_handle = Application::get_instance().get_rmanager().new_handle(ResourceType::SHADER_PROGRAMS, m_id);
 }
 
 ShaderProgram::ShaderProgram(const ShaderProgram& a_shader_program) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_PROGRAMS, a_shader_program.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_PROGRAMS, a_shader_program.m_handle);
 
 	m_id = a_shader_program.m_id;
+	m_handle = a_shader_program.m_handle;
 	m_vertex_sh = a_shader_program.m_vertex_sh;
 	m_fragment_sh = a_shader_program.m_fragment_sh;
+	m_compute_sh = a_shader_program.m_compute_sh;
 	m_uniforms = a_shader_program.m_uniforms;
 	m_states = a_shader_program.m_states;
 }
 
 ShaderProgram::ShaderProgram(ShaderProgram&& a_shader_program) noexcept {
 	m_id = a_shader_program.m_id;
+	m_handle = a_shader_program.m_handle;
 	m_vertex_sh = a_shader_program.m_vertex_sh;
 	m_fragment_sh = a_shader_program.m_fragment_sh;
+	m_compute_sh = a_shader_program.m_compute_sh;
 	m_uniforms = std::move(a_shader_program.m_uniforms);
 	m_states = std::move(a_shader_program.m_states);
 
 	a_shader_program.m_id = EMPTY_VBO;
+	a_shader_program.m_handle = {};
 }
 
 ShaderProgram& ShaderProgram::operator=(const ShaderProgram& a_shader_program) {
-	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_PROGRAMS, a_shader_program.m_id);
+	Application::get_instance().get_rmanager().inc_ref_count(ResourceType::SHADER_PROGRAMS, a_shader_program.m_handle);
 
 	m_id = a_shader_program.m_id;
+	m_handle = a_shader_program.m_handle;
 	m_vertex_sh = a_shader_program.m_vertex_sh;
 	m_fragment_sh = a_shader_program.m_fragment_sh;
+	m_compute_sh = a_shader_program.m_compute_sh;
 	m_uniforms = a_shader_program.m_uniforms;
 	m_states = a_shader_program.m_states;
 
@@ -186,21 +224,24 @@ ShaderProgram& ShaderProgram::operator=(const ShaderProgram& a_shader_program) {
 
 ShaderProgram& ShaderProgram::operator=(ShaderProgram&& a_shader_program) noexcept {
 	m_id = a_shader_program.m_id;
+	m_handle = a_shader_program.m_handle;
 	m_vertex_sh = a_shader_program.m_vertex_sh;
 	m_fragment_sh = a_shader_program.m_fragment_sh;
+	m_compute_sh = a_shader_program.m_compute_sh;
 	m_uniforms = std::move(a_shader_program.m_uniforms);
 	m_states = std::move(a_shader_program.m_states);
 
 	a_shader_program.m_id = EMPTY_VBO;
+	a_shader_program.m_handle = {};
 
 	return *this;
 }
 
 ShaderProgram::~ShaderProgram() {
 	if (m_id != EMPTY_VBO) {
-		Application::get_instance().get_rmanager().dec_ref_count(ResourceType::SHADER_PROGRAMS, m_id);
-		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::SHADER_PROGRAMS, m_id)) {
-			glDeleteProgram(m_id);
+		int refs = Application::get_instance().get_rmanager().dec_ref_count(ResourceType::SHADER_PROGRAMS, m_handle);
+		if (!Application::get_instance().get_rmanager().chk_ref_count(ResourceType::SHADER_PROGRAMS, m_handle, refs)) {
+			Application::get_instance().get_rmanager().get_gl_objects().release(GLObjectType::PROGRAM, m_id);
 		}
 	}
 }
@@ -253,6 +294,15 @@ void ShaderProgram::use() {
 	}
 }
 
+void ShaderProgram::dispatch(GLuint a_groups_x, GLuint a_groups_y, GLuint a_groups_z) {
+	if (m_compute_sh.get_id() == EMPTY_VBO) {
+		ERROR("[SHADERPROGRAM::DISPATCH] Shader program has no compute shader.", Error_action::throwing);
+	}
+
+	glUseProgram(m_id);
+	glDispatchCompute(a_groups_x, a_groups_y, a_groups_z);
+}
+
 void ShaderProgram::set_binding_point(const std::string& a_uniform_block_name, int a_binding_point) noexcept {
 	auto block_index = glGetUniformBlockIndex(m_id, a_uniform_block_name.data());
 	glUniformBlockBinding(m_id, block_index, a_binding_point);
@@ -381,6 +431,22 @@ void ShaderProgram::set_uniform(const std::string& a_material_name, const Materi
 	}
 }
 
+MaterialLocations ShaderProgram::get_material_locations(const std::string& a_material_name) const {
+	auto location = [this, &a_material_name](const std::string& a_member) {
+		return glGetUniformLocation(m_id, std::format("{}.{}", a_material_name, a_member).c_str());
+	};
+
+	MaterialLocations locations;
+	locations.shininess = location("shininess");
+	for (std::size_t i = 0; i < locations.diffuse_maps.size(); ++i)
+		locations.diffuse_maps[i] = location(std::format("diffuse_maps[{}]", i));
+	for (std::size_t i = 0; i < locations.specular_maps.size(); ++i)
+		locations.specular_maps[i] = location(std::format("specular_maps[{}]", i));
+	for (std::size_t i = 0; i < locations.emission_maps.size(); ++i)
+		locations.emission_maps[i] = location(std::format("emission_maps[{}]", i));
+	return locations;
+}
+
 bool ShaderProgram::is_state(ShaderState a_state) const noexcept {
 	return m_states.at(a_state);
 }
@@ -389,6 +455,10 @@ GLuint ShaderProgram::get_id() const noexcept {
 	return m_id;
 }
 
+ResourceHandle ShaderProgram::get_handle() const noexcept {
+	return m_handle;
+}
+
 ShaderSrc ShaderProgram::get_vert_shader() const noexcept {
 	return m_vertex_sh;
 }
@@ -400,4 +470,8 @@ ShaderSrc ShaderProgram::get_frag_shader() const noexcept {
 ShaderSrc ShaderProgram::get_geom_shader() const noexcept {
 	return m_geometry_sh; 
 }
+
+ShaderSrc ShaderProgram::get_comp_shader() const noexcept {
+	return m_compute_sh; 
+}
 }
@@ -0,0 +1,620 @@
+#include "chill_renderer/texture_compression.hpp"
+#include "chill_renderer/simd.hpp"
+#include "chill_renderer/file_manager.hpp"
+#include "chill_renderer/application.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cwctype>
+#include <limits>
+#include <thread>
+#include <format>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+namespace chill_renderer {
+namespace fs = std::filesystem;
+
+static constexpr std::uint32_t fourcc(const char (&a_code)[5]) {
+	return static_cast<std::uint32_t>(a_code[0]) | static_cast<std::uint32_t>(a_code[1]) << 8 |
+		static_cast<std::uint32_t>(a_code[2]) << 16 | static_cast<std::uint32_t>(a_code[3]) << 24;
+}
+
+// DDS header, words after "DDS " magic.
+static constexpr std::size_t g_dds_header_words = 31;
+static constexpr std::size_t g_dds_data_offset = 4 + g_dds_header_words * 4;
+static constexpr std::size_t g_dds_dx10_words = 5;
+static constexpr std::uint32_t g_ddpf_fourcc = 0x4;
+static constexpr std::uint32_t g_dds_caps2_cubemap = 0x200;
+static constexpr std::uint32_t g_dds_caps2_volume = 0x200000;
+static constexpr std::uint32_t g_dds_resource_texture2d = 3;
+static constexpr std::uint32_t g_dds_misc_cubemap = 0x4;
+
+// KTX2 identifier, header of 9 words and index of data format, key/value and supercompression blocks.
+static constexpr unsigned char g_ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static constexpr std::size_t g_ktx2_level_index_offset = 80;
+
+static std::wstring lower_extension(const fs::path& a_path) {
+	std::wstring ext = a_path.extension().wstring();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+	return ext;
+}
+
+static std::vector<unsigned char> read_file(const fs::path& a_path) {
+	std::ifstream file(a_path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		ERROR(std::format("[READ_FILE] Couldn't open {}", wstos(a_path.wstring())), Error_action::throwing);
+	}
+
+	std::vector<unsigned char> bytes(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	return bytes;
+}
+
+template<typename T>
+static T read_value(const std::vector<unsigned char>& a_bytes, std::size_t a_offset) {
+	T value{};
+	std::memcpy(&value, a_bytes.data() + a_offset, sizeof(T));
+	return value;
+}
+
+std::size_t set_block_levels(CompressedImage& a_image, int a_width, int a_height, int a_levels) {
+	std::size_t offset{};
+	a_image.levels.clear();
+	for (int i = 0; i < a_levels; ++i) {
+		int width = std::max(1, a_width >> i);
+		int height = std::max(1, a_height >> i);
+		std::size_t blocks = static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4);
+		a_image.levels.push_back({ width, height, offset, blocks * a_image.get_block_size() });
+		offset += a_image.levels.back().size;
+	}
+	return offset;
+}
+
+bool is_valid_block_levels(int a_width, int a_height, int a_levels) noexcept {
+	return a_width > 0 && a_width <= g_max_block_image_siz && a_height > 0 && a_height <= g_max_block_image_siz &&
+		a_levels > 0 && a_levels <= get_mip_levels(a_width, a_height);
+}
+
+static CompressedImage parse_dds(const std::vector<unsigned char>& a_file, const std::string& a_name) {
+	if (a_file.size() < g_dds_data_offset || std::memcmp(a_file.data(), "DDS ", 4) != 0) {
+		ERROR(std::format("[PARSE_DDS] {} isn't a DDS file.", a_name), Error_action::throwing);
+	}
+
+	std::uint32_t header[g_dds_header_words];
+	std::memcpy(header, a_file.data() + 4, sizeof(header));
+	if (header[27] & (g_dds_caps2_cubemap | g_dds_caps2_volume)) {
+		ERROR(std::format("[PARSE_DDS] {} isn't 2D texture, store cubemap faces in separate files.", a_name), Error_action::throwing);
+	}
+	if (!(header[19] & g_ddpf_fourcc)) {
+		ERROR(std::format("[PARSE_DDS] {} isn't block compressed.", a_name), Error_action::throwing);
+	}
+
+	CompressedImage image;
+	std::size_t offset = g_dds_data_offset;
+	std::uint32_t code = header[20];
+	if (code == fourcc("DX10")) {
+		if (a_file.size() < g_dds_data_offset + g_dds_dx10_words * 4) {
+			ERROR(std::format("[PARSE_DDS] {} is truncated.", a_name), Error_action::throwing);
+		}
+		std::uint32_t dx10[g_dds_dx10_words];
+		std::memcpy(dx10, a_file.data() + g_dds_data_offset, sizeof(dx10));
+		offset += sizeof(dx10);
+
+		if (dx10[1] != g_dds_resource_texture2d || (dx10[2] & g_dds_misc_cubemap) || dx10[3] > 1) {
+			ERROR(std::format("[PARSE_DDS] {} isn't single 2D texture.", a_name), Error_action::throwing);
+		}
+		// DXGI_FORMAT values, typeless and sRGB variants alike, gamma is decided by texture.
+		switch (dx10[0]) {
+		case 70: case 71: case 72: image.format = BlockFormat::BC1; break;
+		case 76: case 77: case 78: image.format = BlockFormat::BC3; break;
+		case 79: case 80:          image.format = BlockFormat::BC4; break;
+		case 82: case 83:          image.format = BlockFormat::BC5; break;
+		case 97: case 98: case 99: image.format = BlockFormat::BC7; break;
+		default:
+			ERROR(std::format("[PARSE_DDS] {} has unsupported DXGI format {}.", a_name, dx10[0]), Error_action::throwing);
+		}
+	}
+	else if (code == fourcc("DXT1")) {
+		image.format = BlockFormat::BC1;
+	}
+	else if (code == fourcc("DXT5")) {
+		image.format = BlockFormat::BC3;
+	}
+	else if (code == fourcc("ATI1") || code == fourcc("BC4U")) {
+		image.format = BlockFormat::BC4;
+	}
+	else if (code == fourcc("ATI2") || code == fourcc("BC5U")) {
+		image.format = BlockFormat::BC5;
+	}
+	else {
+		ERROR(std::format("[PARSE_DDS] {} has unsupported FourCC.", a_name), Error_action::throwing);
+	}
+
+	int width = static_cast<int>(header[3]);
+	int height = static_cast<int>(header[2]);
+	int levels = header[6] == 0 ? 1 : static_cast<int>(header[6]);
+	if (!is_valid_block_levels(width, height, levels)) {
+		ERROR(std::format("[PARSE_DDS] {} has bad size {}x{} or {} levels.", a_name, header[3], header[2], header[6]), Error_action::throwing);
+	}
+	std::size_t bytes = set_block_levels(image, width, height, levels);
+	if (a_file.size() < offset + bytes) {
+		ERROR(std::format("[PARSE_DDS] {} is truncated.", a_name), Error_action::throwing);
+	}
+
+	image.data.assign(a_file.begin() + offset, a_file.begin() + offset + bytes);
+	return image;
+}
+
+static CompressedImage parse_ktx2(const std::vector<unsigned char>& a_file, const std::string& a_name) {
+	if (a_file.size() < g_ktx2_level_index_offset || std::memcmp(a_file.data(), g_ktx2_identifier, sizeof(g_ktx2_identifier)) != 0) {
+		ERROR(std::format("[PARSE_KTX2] {} isn't a KTX2 file.", a_name), Error_action::throwing);
+	}
+
+	std::uint32_t header[9];
+	std::memcpy(header, a_file.data() + sizeof(g_ktx2_identifier), sizeof(header));
+	auto [vk_format, type_size, width, height, depth, layers, faces, levels, supercompression] = header;
+	if (depth > 1 || layers > 1 || faces != 1) {
+		ERROR(std::format("[PARSE_KTX2] {} isn't 2D texture, store cubemap faces in separate files.", a_name), Error_action::throwing);
+	}
+	if (supercompression != 0) {
+		ERROR(std::format("[PARSE_KTX2] {} is supercompressed, only raw block data is supported.", a_name), Error_action::throwing);
+	}
+
+	CompressedImage image;
+	// VkFormat values, UNORM and SRGB variants alike.
+	switch (vk_format) {
+	case 131: case 132: case 133: case 134: image.format = BlockFormat::BC1; break;
+	case 137: case 138:                     image.format = BlockFormat::BC3; break;
+	case 139:                               image.format = BlockFormat::BC4; break;
+	case 141:                               image.format = BlockFormat::BC5; break;
+	case 145: case 146:                     image.format = BlockFormat::BC7; break;
+	default:
+		ERROR(std::format("[PARSE_KTX2] {} has unsupported VkFormat {}.", a_name, vk_format), Error_action::throwing);
+	}
+
+	// Height 0 is 1D texture, level count 0 asks for generated mips.
+	int width_siz = static_cast<int>(width);
+	int height_siz = height == 0 ? 1 : static_cast<int>(height);
+	int level_siz = levels == 0 ? 1 : static_cast<int>(levels);
+	if (!is_valid_block_levels(width_siz, height_siz, level_siz)) {
+		ERROR(std::format("[PARSE_KTX2] {} has bad size {}x{} or {} levels.", a_name, width, height, levels), Error_action::throwing);
+	}
+	image.data.resize(set_block_levels(image, width_siz, height_siz, level_siz));
+	if (a_file.size() < g_ktx2_level_index_offset + level_siz * 3 * sizeof(std::uint64_t)) {
+		ERROR(std::format("[PARSE_KTX2] {} is truncated.", a_name), Error_action::throwing);
+	}
+
+	// Level index is ordered from base level, data itself may be stored smallest first.
+	for (int i = 0; i < level_siz; ++i) {
+		std::size_t entry = g_ktx2_level_index_offset + i * 3 * sizeof(std::uint64_t);
+		std::uint64_t offset = read_value<std::uint64_t>(a_file, entry);
+		std::uint64_t length = read_value<std::uint64_t>(a_file, entry + sizeof(std::uint64_t));
+		const auto& level = image.levels[i];
+		if (length != level.size || offset > a_file.size() || a_file.size() - offset < length) {
+			ERROR(std::format("[PARSE_KTX2] {} has bad level {}.", a_name, i), Error_action::throwing);
+		}
+		std::memcpy(image.data.data() + level.offset, a_file.data() + offset, level.size);
+	}
+	return image;
+}
+
+// Index rows of BC1 block are one byte each.
+static void flip_bc1_rows(unsigned char* a_block, int a_rows) {
+	std::reverse(a_block + 4, a_block + 4 + a_rows);
+}
+
+// BC4 block holds 48 bits of 3 bit indices, 12 bits per row.
+static void flip_bc4_rows(unsigned char* a_block, int a_rows) {
+	std::uint64_t bits{};
+	for (int i = 0; i < 6; ++i) {
+		bits |= static_cast<std::uint64_t>(a_block[2 + i]) << (8 * i);
+	}
+
+	std::uint64_t flipped = bits & ~((std::uint64_t{ 1 } << (12 * a_rows)) - 1);
+	for (int row = 0; row < a_rows; ++row) {
+		flipped |= ((bits >> (12 * row)) & 0xFFF) << (12 * (a_rows - 1 - row));
+	}
+
+	for (int i = 0; i < 6; ++i) {
+		a_block[2 + i] = static_cast<unsigned char>(flipped >> (8 * i));
+	}
+}
+
+// Flips without decoding: order of block rows is reversed, then rows inside each block.
+static void flip_blocks(CompressedImage& a_image, const std::string& a_name) {
+	if (a_image.format == BlockFormat::BC7) {
+		ERROR(std::format("[FLIP_BLOCKS] BC7 image {} can't be flipped, store it flipped instead.", a_name), Error_action::throwing);
+	}
+
+	std::size_t block_siz = a_image.get_block_size();
+	for (const auto& level : a_image.levels) {
+		if (level.height > 4 && level.height % 4 != 0) {
+			ERROR(std::format("[FLIP_BLOCKS] Height of {} isn't multiple of 4, it can't be flipped.", a_name), Error_action::throwing);
+		}
+
+		int blocks_x = (level.width + 3) / 4;
+		int blocks_y = (level.height + 3) / 4;
+		int rows = std::min(4, level.height);
+		std::size_t row_siz = blocks_x * block_siz;
+		unsigned char* data = a_image.data.data() + level.offset;
+		for (int y = 0; y < blocks_y / 2; ++y) {
+			std::swap_ranges(data + y * row_siz, data + (y + 1) * row_siz, data + (blocks_y - 1 - y) * row_siz);
+		}
+
+		for (std::size_t i = 0; i < level.size; i += block_siz) {
+			switch (a_image.format) {
+			case BlockFormat::BC1: flip_bc1_rows(data + i, rows); break;
+			case BlockFormat::BC3: flip_bc4_rows(data + i, rows); flip_bc1_rows(data + i + 8, rows); break;
+			case BlockFormat::BC4: flip_bc4_rows(data + i, rows); break;
+			case BlockFormat::BC5: flip_bc4_rows(data + i, rows); flip_bc4_rows(data + i + 8, rows); break;
+			default: break;
+			}
+		}
+	}
+}
+
+bool is_compressed_file(const std::wstring& a_path) {
+	std::wstring ext = lower_extension(a_path);
+	return ext == L".dds" || ext == L".ktx2";
+}
+
+CompressedImage load_compressed_image(const std::wstring& a_path, bool a_flip) {
+	fs::path p = guess_path(a_path);
+	if (p == fs::path()) {
+		ERROR(std::format("[LOAD_COMPRESSED_IMAGE] Bad image path: {}", wstos(a_path)), Error_action::throwing);
+	}
+
+	std::string name = wstos(p.wstring());
+	std::vector<unsigned char> file = read_file(p);
+	CompressedImage image = lower_extension(p) == L".ktx2" ? parse_ktx2(file, name) : parse_dds(file, name);
+	if (a_flip) {
+		flip_blocks(image, name);
+	}
+	return image;
+}
+
+void save_dds(const fs::path& a_path, const CompressedImage& a_image) {
+	if (a_image.levels.empty()) {
+		ERROR(std::format("[SAVE_DDS] Image saved to {} has no levels.", wstos(a_path.wstring())), Error_action::throwing);
+	}
+
+	std::uint32_t header[g_dds_header_words]{};
+	header[0] = 124;                                         // Header size
+	header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // Caps, height, width, pixel format, mip count, linear size
+	header[2] = static_cast<std::uint32_t>(a_image.levels[0].height);
+	header[3] = static_cast<std::uint32_t>(a_image.levels[0].width);
+	header[4] = static_cast<std::uint32_t>(a_image.levels[0].size);
+	header[6] = static_cast<std::uint32_t>(a_image.levels.size());
+	header[18] = 32;                                         // Pixel format size
+	header[19] = g_ddpf_fourcc;
+	header[20] = fourcc("DX10");
+	header[26] = 0x1000 | 0x400000 | 0x8;                    // Texture, mipmap, complex
+
+	std::uint32_t dxgi{};
+	switch (a_image.format) {
+	case BlockFormat::BC1: dxgi = 71; break;
+	case BlockFormat::BC3: dxgi = 77; break;
+	case BlockFormat::BC4: dxgi = 80; break;
+	case BlockFormat::BC5: dxgi = 83; break;
+	case BlockFormat::BC7: dxgi = 98; break;
+	}
+	std::uint32_t dx10[g_dds_dx10_words] = { dxgi, g_dds_resource_texture2d, 0, 1, 0 };
+
+	std::ofstream file(a_path, std::ios::binary | std::ios::trunc);
+	file.write("DDS ", 4);
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(dx10), sizeof(dx10));
+	file.write(reinterpret_cast<const char*>(a_image.get_data()), static_cast<std::streamsize>(a_image.get_byte_size()));
+	if (!file) {
+		ERROR(std::format("[SAVE_DDS] Couldn't write {}", wstos(a_path.wstring())), Error_action::throwing);
+	}
+}
+
+// Texels of 4x4 block as RGBA, edges are clamped for blocks hanging over image.
+static void fetch_block(const unsigned char* a_pixels, int a_width, int a_height, int a_channels, int a_block_x, int a_block_y, unsigned char a_block[16][4]) {
+	for (int y = 0; y < 4; ++y) {
+		int py = std::min(a_block_y * 4 + y, a_height - 1);
+		for (int x = 0; x < 4; ++x) {
+			int px = std::min(a_block_x * 4 + x, a_width - 1);
+			const unsigned char* texel = a_pixels + (static_cast<std::size_t>(py) * a_width + px) * a_channels;
+			unsigned char* out = a_block[y * 4 + x];
+			out[0] = texel[0];
+			out[1] = a_channels >= 3 ? texel[1] : texel[0];
+			out[2] = a_channels >= 3 ? texel[2] : texel[0];
+			out[3] = a_channels == 4 ? texel[3] : 255;
+		}
+	}
+}
+
+static std::uint16_t pack_565(const float a_color[3]) {
+	auto quantize = [](float a_value, int a_max) {
+		return std::clamp(static_cast<int>(a_value * a_max / 255.0f + 0.5f), 0, a_max);
+	};
+	return static_cast<std::uint16_t>(quantize(a_color[0], 31) << 11 | quantize(a_color[1], 63) << 5 | quantize(a_color[2], 31));
+}
+
+static void unpack_565(std::uint16_t a_color, float a_rgb[3]) {
+	int r = (a_color >> 11) & 31;
+	int g = (a_color >> 5) & 63;
+	int b = a_color & 31;
+	a_rgb[0] = static_cast<float>(r << 3 | r >> 2);
+	a_rgb[1] = static_cast<float>(g << 2 | g >> 4);
+	a_rgb[2] = static_cast<float>(b << 3 | b >> 2);
+}
+
+// Index of closest palette color for every texel of block.
+static void find_indices(const float a_texels[3][16], const float a_palette[4][3], int a_indices[16]) {
+	int i = 0;
+
+#if defined(CHILL_SIMD_SSE)
+	for (; i + 4 <= 16; i += 4) {
+		__m128 r = _mm_loadu_ps(&a_texels[0][i]);
+		__m128 g = _mm_loadu_ps(&a_texels[1][i]);
+		__m128 b = _mm_loadu_ps(&a_texels[2][i]);
+		__m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+		__m128i best_index = _mm_setzero_si128();
+
+		for (int c = 0; c < 4; ++c) {
+			__m128 dr = _mm_sub_ps(r, _mm_set1_ps(a_palette[c][0]));
+			__m128 dg = _mm_sub_ps(g, _mm_set1_ps(a_palette[c][1]));
+			__m128 db = _mm_sub_ps(b, _mm_set1_ps(a_palette[c][2]));
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+			best = _mm_min_ps(dist, best);
+			best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(c)), _mm_andnot_si128(closer, best_index));
+		}
+
+		alignas(16) int indices[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(indices), best_index);
+		std::copy(indices, indices + 4, a_indices + i);
+	}
+#endif
+
+	// Scalar tail
+	for (; i < 16; ++i) {
+		float best = std::numeric_limits<float>::max();
+		for (int c = 0; c < 4; ++c) {
+			float dr = a_texels[0][i] - a_palette[c][0];
+			float dg = a_texels[1][i] - a_palette[c][1];
+			float db = a_texels[2][i] - a_palette[c][2];
+			float dist = dr * dr + dg * dg + db * db;
+			if (dist < best) {
+				best = dist;
+				a_indices[i] = c;
+			}
+		}
+	}
+}
+
+// Endpoints span block colors along their principal axis, always in 4 color mode so BC3 color blocks decode alike.
+static void encode_bc1(const unsigned char a_block[16][4], unsigned char* a_out) {
+	float texels[3][16];
+	float mean[3]{};
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 3; ++c) {
+			texels[c][i] = a_block[i][c];
+			mean[c] += texels[c][i] / 16.0f;
+		}
+	}
+
+	float cov[6]{};
+	for (int i = 0; i < 16; ++i) {
+		float r = texels[0][i] - mean[0], g = texels[1][i] - mean[1], b = texels[2][i] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+
+	// Power iteration, few steps are plenty for 3x3 matrix.
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int step = 0; step < 4; ++step) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float len = std::max({ std::abs(x), std::abs(y), std::abs(z) });
+		if (len == 0.0f)
+			break;
+		axis[0] = x / len; axis[1] = y / len; axis[2] = z / len;
+	}
+
+	float len_sq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float lo = 0.0f, hi = 0.0f;
+	for (int i = 0; i < 16; ++i) {
+		float t = ((texels[0][i] - mean[0]) * axis[0] + (texels[1][i] - mean[1]) * axis[1] + (texels[2][i] - mean[2]) * axis[2]) / len_sq;
+		lo = std::min(lo, t);
+		hi = std::max(hi, t);
+	}
+
+	float end0[3], end1[3];
+	for (int c = 0; c < 3; ++c) {
+		end0[c] = mean[c] + axis[c] * hi;
+		end1[c] = mean[c] + axis[c] * lo;
+	}
+	std::uint16_t color0 = pack_565(end0);
+	std::uint16_t color1 = pack_565(end1);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	std::uint32_t bits{};
+	if (color0 != color1) {
+		float palette[4][3];
+		unpack_565(color0, palette[0]);
+		unpack_565(color1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+
+		int indices[16];
+		find_indices(texels, palette, indices);
+		for (int i = 0; i < 16; ++i) {
+			bits |= static_cast<std::uint32_t>(indices[i]) << (2 * i);
+		}
+	}
+
+	a_out[0] = static_cast<unsigned char>(color0);
+	a_out[1] = static_cast<unsigned char>(color0 >> 8);
+	a_out[2] = static_cast<unsigned char>(color1);
+	a_out[3] = static_cast<unsigned char>(color1 >> 8);
+	for (int i = 0; i < 4; ++i) {
+		a_out[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+	}
+}
+
+// 8 value mode between block min and max. Index 0 is first endpoint, 1 second, 2..7 interpolate from first to second.
+static void encode_bc4(const unsigned char a_values[16], unsigned char* a_out) {
+	auto [lo, hi] = std::minmax_element(a_values, a_values + 16);
+	int min = *lo, max = *hi;
+	a_out[0] = static_cast<unsigned char>(max);
+	a_out[1] = static_cast<unsigned char>(min);
+
+	std::uint64_t bits{};
+	if (max > min) {
+		for (int i = 0; i < 16; ++i) {
+			int t = ((a_values[i] - min) * 7 + (max - min) / 2) / (max - min);
+			std::uint64_t index = t == 7 ? 0 : t == 0 ? 1 : 8 - t;
+			bits |= index << (3 * i);
+		}
+	}
+	for (int i = 0; i < 6; ++i) {
+		a_out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+	}
+}
+
+static void encode_level(const unsigned char* a_pixels, int a_width, int a_height, int a_channels, BlockFormat a_format, std::size_t a_block_siz, unsigned char* a_out) {
+	int blocks_x = (a_width + 3) / 4;
+	int blocks_y = (a_height + 3) / 4;
+
+	Application::get_instance().get_jobs().parallel_for(0, blocks_y, g_bc_rows_per_job, [&](std::size_t a_begin, std::size_t a_end) {
+		unsigned char block[16][4];
+		unsigned char channel[16];
+		for (std::size_t y = a_begin; y < a_end; ++y) {
+			for (int x = 0; x < blocks_x; ++x) {
+				fetch_block(a_pixels, a_width, a_height, a_channels, x, static_cast<int>(y), block);
+				unsigned char* out = a_out + (y * blocks_x + x) * a_block_siz;
+				switch (a_format) {
+				case BlockFormat::BC1:
+					encode_bc1(block, out);
+					break;
+				case BlockFormat::BC3:
+					for (int i = 0; i < 16; ++i) {
+						channel[i] = block[i][3];
+					}
+					encode_bc4(channel, out);
+					encode_bc1(block, out + 8);
+					break;
+				case BlockFormat::BC4:
+					for (int i = 0; i < 16; ++i) {
+						channel[i] = block[i][0];
+					}
+					encode_bc4(channel, out);
+					break;
+				default: break;
+				}
+			}
+		}
+	}, "compress_texture");
+}
+
+// Box filter, last row and column are repeated for odd sizes.
+static std::vector<unsigned char> downsample(const unsigned char* a_pixels, int a_width, int a_height, int a_channels) {
+	int width = std::max(1, a_width / 2);
+	int height = std::max(1, a_height / 2);
+	std::vector<unsigned char> out(static_cast<std::size_t>(width) * height * a_channels);
+	for (int y = 0; y < height; ++y) {
+		int y0 = std::min(2 * y, a_height - 1), y1 = std::min(2 * y + 1, a_height - 1);
+		for (int x = 0; x < width; ++x) {
+			int x0 = std::min(2 * x, a_width - 1), x1 = std::min(2 * x + 1, a_width - 1);
+			for (int c = 0; c < a_channels; ++c) {
+				auto at = [&](int a_x, int a_y) { return a_pixels[(static_cast<std::size_t>(a_y) * a_width + a_x) * a_channels + c]; };
+				out[(static_cast<std::size_t>(y) * width + x) * a_channels + c] = static_cast<unsigned char>((at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1) + 2) / 4);
+			}
+		}
+	}
+	return out;
+}
+
+CompressedImage compress_image(const ImageData& a_image) {
+	if (a_image.channels != 1 && a_image.channels != 3 && a_image.channels != 4) {
+		ERROR(std::format("[COMPRESS_IMAGE] Images with {} channels can't be compressed.", a_image.channels), Error_action::throwing);
+	}
+
+	CompressedImage image;
+	image.format = BlockFormat::BC1;
+	if (a_image.channels == 1) {
+		image.format = BlockFormat::BC4;
+	}
+	else if (a_image.channels == 4) {
+		std::size_t texels = static_cast<std::size_t>(a_image.width) * a_image.height;
+		for (std::size_t i = 0; i < texels; ++i) {
+			if (a_image.pixels[i * 4 + 3] != 255) {
+				image.format = BlockFormat::BC3;
+				break;
+			}
+		}
+	}
+
+	int levels = static_cast<int>(std::bit_width(static_cast<unsigned>(std::max(a_image.width, a_image.height))));
+	image.data.resize(set_block_levels(image, a_image.width, a_image.height, levels));
+
+	const unsigned char* pixels = a_image.pixels.get();
+	std::vector<unsigned char> mip;
+	for (int i = 0; i < levels; ++i) {
+		const auto& level = image.levels[i];
+		encode_level(pixels, level.width, level.height, a_image.channels, image.format, image.get_block_size(), image.data.data() + level.offset);
+		if (i + 1 < levels) {
+			mip = downsample(pixels, level.width, level.height, a_image.channels);
+			pixels = mip.data();
+		}
+	}
+	return image;
+}
+
+TextureImage load_texture_image(const std::wstring& a_path, bool a_flip, bool a_compress) {
+	if (is_compressed_file(a_path)) {
+		return load_compressed_image(a_path, a_flip);
+	}
+	if (!a_compress) {
+		return load_image(a_path, a_flip);
+	}
+
+	fs::path src = guess_path(a_path);
+	if (src == fs::path()) {
+		ERROR(std::format("[LOAD_TEXTURE_IMAGE] Bad image path: {}", wstos(a_path)), Error_action::throwing);
+	}
+
+	std::error_code ec;
+	fs::path cached = fs::path(g_texture_cache_dir) / std::format("{:016x}{}.dds", std::hash<std::wstring>{}(src.wstring()), a_flip ? "_flip" : "");
+	if (fs::exists(cached, ec) && fs::last_write_time(cached, ec) >= fs::last_write_time(src, ec)) {
+		try {
+			return load_compressed_image(cached.wstring(), false);
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[LOAD_TEXTURE_IMAGE] Cached {} is unreadable, compressing again: {}", wstos(cached.wstring()), e.what()), Error_action::logging);
+		}
+	}
+
+	ImageData decoded = load_image(a_path, a_flip);
+	if (decoded.channels == 2) {
+		return decoded;
+	}
+
+	CompressedImage image = compress_image(decoded);
+	// Written aside and renamed, so concurrent loads of same image never read half written file.
+	try {
+		fs::create_directories(cached.parent_path());
+		fs::path tmp = cached;
+		tmp += std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+		save_dds(tmp, image);
+		fs::rename(tmp, cached);
+	}
+	catch (const std::exception& e) {
+		ERROR(std::format("[LOAD_TEXTURE_IMAGE] Couldn't cache {}: {}", wstos(cached.wstring()), e.what()), Error_action::logging);
+	}
+	return image;
+}
+}
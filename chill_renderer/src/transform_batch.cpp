@@ -0,0 +1,297 @@
+#include <cmath>
+#include <algorithm>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "chill_renderer/transform_batch.hpp"
+#include "chill_renderer/simd.hpp"
+#include "chill_renderer/application.hpp"
+
+namespace chill_renderer {
+static constexpr float g_deg_to_rad = 3.14159265358979f / 180.f;
+
+void Vec3Array::push_back(const glm::vec3& a_vec) {
+	x.push_back(a_vec.x);
+	y.push_back(a_vec.y);
+	z.push_back(a_vec.z);
+}
+
+void Vec3Array::assign(const std::vector<glm::vec3>& a_vecs) {
+	clear();
+	x.reserve(a_vecs.size());
+	y.reserve(a_vecs.size());
+	z.reserve(a_vecs.size());
+	for (const auto& vec : a_vecs) {
+		push_back(vec);
+	}
+}
+
+void Vec3Array::resize(std::size_t a_siz, const glm::vec3& a_value) {
+	x.resize(a_siz, a_value.x);
+	y.resize(a_siz, a_value.y);
+	z.resize(a_siz, a_value.z);
+}
+
+void Vec3Array::clear() noexcept {
+	x.clear();
+	y.clear();
+	z.clear();
+}
+
+void Vec3Array::set(std::size_t a_idx, const glm::vec3& a_vec) noexcept {
+	x[a_idx] = a_vec.x;
+	y[a_idx] = a_vec.y;
+	z[a_idx] = a_vec.z;
+}
+
+glm::vec3 Vec3Array::get(std::size_t a_idx) const noexcept {
+	return glm::vec3(x[a_idx], y[a_idx], z[a_idx]);
+}
+
+std::size_t Vec3Array::size() const noexcept {
+	return x.size();
+}
+
+#if defined(CHILL_SIMD_SSE)
+// Thin wrappers so one kernel serves both register widths.
+struct LanesSSE {
+	using Reg = __m128;
+	static constexpr int width = 4;
+
+	static Reg load(const float* a_ptr) { return _mm_loadu_ps(a_ptr); }
+	static Reg set1(float a_val) { return _mm_set1_ps(a_val); }
+	static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+	static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+	static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+	static Reg div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+	static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+	static Reg abs(Reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	// Rounds to nearest, default MXCSR mode.
+	static Reg round(Reg a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+	// Negates lanes where a_int (integral float) is odd.
+	static Reg negate_odd(Reg a, Reg a_int) {
+		__m128i sign = _mm_slli_epi32(_mm_cvtps_epi32(a_int), 31);
+		return _mm_xor_ps(a, _mm_castsi128_ps(sign));
+	}
+	// Stores 4 columns (x, y, z, w registers) of a_stride floats apart matrices.
+	static void store_columns(Reg x, Reg y, Reg z, Reg w, float* a_dst, std::size_t a_stride) {
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(a_dst, x);
+		_mm_storeu_ps(a_dst + a_stride, y);
+		_mm_storeu_ps(a_dst + 2 * a_stride, z);
+		_mm_storeu_ps(a_dst + 3 * a_stride, w);
+	}
+	static void store(float* a_dst, Reg a) { _mm_storeu_ps(a_dst, a); }
+	// Packs [-1, 1] lanes as snorm16, a into low and b into high half. Result is bit cast to float.
+	static Reg pack_snorm2x16(Reg a, Reg b) {
+		Reg scale = _mm_set1_ps(32767.f);
+		__m128i lo = _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_set1_epi32(0xffff));
+		__m128i hi = _mm_slli_epi32(_mm_cvtps_epi32(_mm_mul_ps(b, scale)), 16);
+		return _mm_castsi128_ps(_mm_or_si128(lo, hi));
+	}
+};
+#endif
+
+#if defined(CHILL_SIMD_AVX)
+struct LanesAVX {
+	using Reg = __m256;
+	static constexpr int width = 8;
+
+	static Reg load(const float* a_ptr) { return _mm256_loadu_ps(a_ptr); }
+	static Reg set1(float a_val) { return _mm256_set1_ps(a_val); }
+	static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+	static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+	static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+	static Reg div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+	static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+	static Reg abs(Reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+	static Reg round(Reg a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	// AVX has no 256 bit integer shifts, parity is found through halving instead.
+	static Reg negate_odd(Reg a, Reg a_int) {
+		Reg half = _mm256_mul_ps(a_int, _mm256_set1_ps(0.5f));
+		Reg odd = _mm256_cmp_ps(round(half), half, _CMP_NEQ_OQ);
+		return _mm256_xor_ps(a, _mm256_and_ps(odd, _mm256_set1_ps(-0.f)));
+	}
+	static void store_columns(Reg x, Reg y, Reg z, Reg w, float* a_dst, std::size_t a_stride) {
+		LanesSSE::store_columns(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w), a_dst, a_stride);
+		LanesSSE::store_columns(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1), a_dst + 4 * a_stride, a_stride);
+	}
+	static void store(float* a_dst, Reg a) { _mm256_storeu_ps(a_dst, a); }
+	static Reg pack_snorm2x16(Reg a, Reg b) {
+		__m128 lo = LanesSSE::pack_snorm2x16(_mm256_castps256_ps128(a), _mm256_castps256_ps128(b));
+		__m128 hi = LanesSSE::pack_snorm2x16(_mm256_extractf128_ps(a, 1), _mm256_extractf128_ps(b, 1));
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+};
+#endif
+
+// Angle is reduced in degrees (exact for reasonable angles) to r in [-90, 90], then
+// sin(x) = (-1)^k * sin(r), cos(x) = (-1)^k * cos(r) with polynomials accurate to float precision.
+template<typename L>
+static void sincos_deg(typename L::Reg a_deg, typename L::Reg& a_sin, typename L::Reg& a_cos) {
+	using Reg = typename L::Reg;
+	Reg k = L::round(L::mul(a_deg, L::set1(1.f / 180.f)));
+	Reg r = L::mul(L::sub(a_deg, L::mul(k, L::set1(180.f))), L::set1(g_deg_to_rad));
+	Reg r2 = L::mul(r, r);
+
+	Reg s = L::set1(-2.5052108e-8f);
+	s = L::add(L::mul(s, r2), L::set1(2.7557319e-6f));
+	s = L::add(L::mul(s, r2), L::set1(-1.9841270e-4f));
+	s = L::add(L::mul(s, r2), L::set1(8.3333333e-3f));
+	s = L::add(L::mul(s, r2), L::set1(-1.6666667e-1f));
+	s = L::add(L::mul(L::mul(s, r2), r), r);
+
+	Reg c = L::set1(2.0876757e-9f);
+	c = L::add(L::mul(c, r2), L::set1(-2.7557319e-7f));
+	c = L::add(L::mul(c, r2), L::set1(2.4801587e-5f));
+	c = L::add(L::mul(c, r2), L::set1(-1.3888889e-3f));
+	c = L::add(L::mul(c, r2), L::set1(4.1666667e-2f));
+	c = L::add(L::mul(c, r2), L::set1(-0.5f));
+	c = L::add(L::mul(c, r2), L::set1(1.f));
+
+	a_sin = L::negate_odd(s, k);
+	a_cos = L::negate_odd(c, k);
+}
+
+template<typename L>
+static void compose_lanes(const Vec3Array& a_pos, const Vec3Array& a_rot, const Vec3Array& a_siz, const BoundingSphere& a_local,
+	InstanceTransform* a_transforms, SphereBatch& a_spheres, std::size_t i)
+{
+	using Reg = typename L::Reg;
+	Reg half = L::set1(0.5f);
+	Reg sa, ca, sb, cb, sc, cc;
+	sincos_deg<L>(L::mul(L::load(&a_rot.x[i]), half), sa, ca);
+	sincos_deg<L>(L::mul(L::load(&a_rot.y[i]), half), sb, cb);
+	sincos_deg<L>(L::mul(L::load(&a_rot.z[i]), half), sc, cc);
+
+	// Quaternion of rotate_x * rotate_y * rotate_z from half angles
+	Reg xy_x = L::mul(sa, cb);
+	Reg xy_y = L::mul(ca, sb);
+	Reg xy_z = L::mul(sa, sb);
+	Reg xy_w = L::mul(ca, cb);
+	Reg qx = L::add(L::mul(xy_x, cc), L::mul(xy_y, sc));
+	Reg qy = L::sub(L::mul(xy_y, cc), L::mul(xy_x, sc));
+	Reg qz = L::add(L::mul(xy_z, cc), L::mul(xy_w, sc));
+	Reg qw = L::sub(L::mul(xy_w, cc), L::mul(xy_z, sc));
+
+	Reg sx = L::load(&a_siz.x[i]);
+	Reg sy = L::load(&a_siz.y[i]);
+	Reg sz = L::load(&a_siz.z[i]);
+	Reg px = L::load(&a_pos.x[i]);
+	Reg py = L::load(&a_pos.y[i]);
+	Reg pz = L::load(&a_pos.z[i]);
+
+	// InstanceTransform is two 4 float rows: position with rotation xy, scale with rotation zw.
+	float* dst = reinterpret_cast<float*>(a_transforms + i);
+	L::store_columns(px, py, pz, L::pack_snorm2x16(qx, qy), dst, 8);
+	L::store_columns(sx, sy, sz, L::pack_snorm2x16(qz, qw), dst + 4, 8);
+
+	// Rotation columns for sphere centers, full angles from half angles.
+	Reg two = L::set1(2.f);
+	Reg sa2 = L::mul(two, L::mul(sa, ca)), ca2 = L::sub(L::mul(ca, ca), L::mul(sa, sa));
+	Reg sb2 = L::mul(two, L::mul(sb, cb)), cb2 = L::sub(L::mul(cb, cb), L::mul(sb, sb));
+	Reg sc2 = L::mul(two, L::mul(sc, cc)), cc2 = L::sub(L::mul(cc, cc), L::mul(sc, sc));
+	Reg sa_sb = L::mul(sa2, sb2);
+	Reg ca_sb = L::mul(ca2, sb2);
+	Reg r0x = L::mul(cb2, cc2);
+	Reg r0y = L::add(L::mul(ca2, sc2), L::mul(sa_sb, cc2));
+	Reg r0z = L::sub(L::mul(sa2, sc2), L::mul(ca_sb, cc2));
+	Reg r1x = L::sub(L::set1(0.f), L::mul(cb2, sc2));
+	Reg r1y = L::sub(L::mul(ca2, cc2), L::mul(sa_sb, sc2));
+	Reg r1z = L::add(L::mul(sa2, cc2), L::mul(ca_sb, sc2));
+	Reg r2x = sb2;
+	Reg r2y = L::sub(L::set1(0.f), L::mul(sa2, cb2));
+	Reg r2z = L::mul(ca2, cb2);
+
+	// Sphere center is M * local center, columns of rotation are unit so radius scales by largest axis.
+	Reg lx = L::mul(L::set1(a_local.center.x), sx);
+	Reg ly = L::mul(L::set1(a_local.center.y), sy);
+	Reg lz = L::mul(L::set1(a_local.center.z), sz);
+	L::store(&a_spheres.x[i], L::add(px, L::add(L::mul(r0x, lx), L::add(L::mul(r1x, ly), L::mul(r2x, lz)))));
+	L::store(&a_spheres.y[i], L::add(py, L::add(L::mul(r0y, lx), L::add(L::mul(r1y, ly), L::mul(r2y, lz)))));
+	L::store(&a_spheres.z[i], L::add(pz, L::add(L::mul(r0z, lx), L::add(L::mul(r1z, ly), L::mul(r2z, lz)))));
+	Reg max_scale = L::max(L::abs(sx), L::max(L::abs(sy), L::abs(sz)));
+	L::store(&a_spheres.r[i], L::mul(L::set1(a_local.radius), max_scale));
+}
+
+static void compose_scalar(const Vec3Array& a_pos, const Vec3Array& a_rot, const Vec3Array& a_siz, const BoundingSphere& a_local,
+	InstanceTransform* a_transforms, SphereBatch& a_spheres, std::size_t i)
+{
+	float sa = std::sin(a_rot.x[i] * g_deg_to_rad * 0.5f), ca = std::cos(a_rot.x[i] * g_deg_to_rad * 0.5f);
+	float sb = std::sin(a_rot.y[i] * g_deg_to_rad * 0.5f), cb = std::cos(a_rot.y[i] * g_deg_to_rad * 0.5f);
+	float sc = std::sin(a_rot.z[i] * g_deg_to_rad * 0.5f), cc = std::cos(a_rot.z[i] * g_deg_to_rad * 0.5f);
+	glm::quat xy(ca * cb, sa * cb, ca * sb, sa * sb);
+	glm::quat rot(xy.w * cc - xy.z * sc, xy.x * cc + xy.y * sc, xy.y * cc - xy.x * sc, xy.z * cc + xy.w * sc);
+	glm::vec3 siz = a_siz.get(i);
+	glm::vec3 pos = a_pos.get(i);
+
+	a_transforms[i].position = pos;
+	a_transforms[i].rotation_xy = glm::packSnorm2x16(glm::vec2(rot.x, rot.y));
+	a_transforms[i].scale = siz;
+	a_transforms[i].rotation_zw = glm::packSnorm2x16(glm::vec2(rot.z, rot.w));
+
+	glm::vec3 center = pos + rot * (a_local.center * siz);
+	a_spheres.x[i] = center.x;
+	a_spheres.y[i] = center.y;
+	a_spheres.z[i] = center.z;
+	a_spheres.r[i] = a_local.radius * std::max({ std::abs(siz.x), std::abs(siz.y), std::abs(siz.z) });
+}
+
+static void compose_range(const Vec3Array& a_pos, const Vec3Array& a_rot, const Vec3Array& a_siz, const BoundingSphere& a_local,
+	InstanceTransform* a_transforms, SphereBatch& a_spheres, std::size_t a_begin, std::size_t a_end)
+{
+	std::size_t i = a_begin;
+#if defined(CHILL_SIMD_AVX)
+	for (; i + 8 <= a_end; i += 8) {
+		compose_lanes<LanesAVX>(a_pos, a_rot, a_siz, a_local, a_transforms, a_spheres, i);
+	}
+#endif
+#if defined(CHILL_SIMD_SSE)
+	for (; i + 4 <= a_end; i += 4) {
+		compose_lanes<LanesSSE>(a_pos, a_rot, a_siz, a_local, a_transforms, a_spheres, i);
+	}
+#endif
+	for (; i < a_end; ++i) {
+		compose_scalar(a_pos, a_rot, a_siz, a_local, a_transforms, a_spheres, i);
+	}
+}
+
+void compose_transforms(const Vec3Array& a_positions, const Vec3Array& a_rotations, const Vec3Array& a_sizes, const BoundingSphere& a_local_sphere,
+	InstanceTransform* a_transforms, SphereBatch& a_spheres)
+{
+	const std::size_t siz = a_positions.size();
+	a_spheres.x.resize(siz);
+	a_spheres.y.resize(siz);
+	a_spheres.z.resize(siz);
+	a_spheres.r.resize(siz);
+
+	if (siz < g_transform_parallel_min) {
+		compose_range(a_positions, a_rotations, a_sizes, a_local_sphere, a_transforms, a_spheres, 0, siz);
+		return;
+	}
+	// Grain is multiple of widest SIMD step, so only last chunk has scalar tail.
+	Application::get_instance().get_jobs().parallel_for(0, siz, g_transform_parallel_min / 2, [&](std::size_t a_begin, std::size_t a_end) {
+			compose_range(a_positions, a_rotations, a_sizes, a_local_sphere, a_transforms, a_spheres, a_begin, a_end);
+		}, "compose_transforms");
+}
+
+void compose_transform(const Vec3Array& a_positions, const Vec3Array& a_rotations, const Vec3Array& a_sizes, const BoundingSphere& a_local_sphere,
+	std::size_t a_idx, InstanceTransform* a_transforms, SphereBatch& a_spheres)
+{
+	compose_scalar(a_positions, a_rotations, a_sizes, a_local_sphere, a_transforms, a_spheres, a_idx);
+}
+
+InstanceTransform to_instance_transform(const glm::mat4& a_model_mat) {
+	glm::vec3 scale(glm::length(glm::vec3(a_model_mat[0])), glm::length(glm::vec3(a_model_mat[1])), glm::length(glm::vec3(a_model_mat[2])));
+	glm::mat3 rot(glm::vec3(a_model_mat[0]) / scale.x, glm::vec3(a_model_mat[1]) / scale.y, glm::vec3(a_model_mat[2]) / scale.z);
+	glm::quat quat = glm::quat_cast(rot);
+
+	InstanceTransform transform;
+	transform.position = glm::vec3(a_model_mat[3]);
+	transform.rotation_xy = glm::packSnorm2x16(glm::vec2(quat.x, quat.y));
+	transform.scale = scale;
+	transform.rotation_zw = glm::packSnorm2x16(glm::vec2(quat.z, quat.w));
+	return transform;
+}
+}
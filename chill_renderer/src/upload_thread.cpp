@@ -0,0 +1,109 @@
+#include <format>
+#include <exception>
+
+#include "chill_renderer/upload_thread.hpp"
+#include "chill_renderer/assert.hpp"
+
+namespace chill_renderer {
+UploadThread::UploadThread(GLFWwindow* a_share_window) {
+	// Context hints of render window are still set, only visibility differs.
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_context = glfwCreateWindow(1, 1, "upload", nullptr, a_share_window);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (m_context == nullptr) {
+		ERROR("[UPLOADTHREAD::UPLOADTHREAD] Couldn't create shared upload context.", Error_action::throwing);
+	}
+
+	m_thread = std::jthread([this](std::stop_token a_stop) { thread_loop(a_stop); });
+}
+
+UploadThread::~UploadThread() {
+	m_thread.request_stop();
+	if (m_thread.joinable())
+		m_thread.join();
+
+	// Unfinished uploads are dropped, their publish callbacks only release what they hold.
+	for (auto& upload : m_fenced) {
+		glDeleteSync(upload.fence);
+	}
+	m_fenced.clear();
+	m_queued.clear();
+	glfwDestroyWindow(m_context);
+}
+
+void UploadThread::submit(Task a_upload, Task a_publish) {
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard lock(m_mutex);
+		m_queued.push_back({ std::move(a_upload), std::move(a_publish) });
+	}
+	m_wake.notify_one();
+}
+
+std::size_t UploadThread::poll() {
+	std::size_t published{};
+	while (true) {
+		Upload upload;
+		{
+			std::lock_guard lock(m_mutex);
+			if (m_fenced.empty())
+				break;
+
+			// Fences signal in order, first unsignaled one means the rest isn't done either.
+			GLenum status = glClientWaitSync(m_fenced.front().fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			upload = std::move(m_fenced.front());
+			m_fenced.pop_front();
+		}
+
+		glDeleteSync(upload.fence);
+		try {
+			upload.publish();
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[UPLOADTHREAD::POLL] Publishing upload failed: {}", e.what()), Error_action::logging);
+		}
+		m_pending.fetch_sub(1, std::memory_order_relaxed);
+		++published;
+	}
+	return published;
+}
+
+std::size_t UploadThread::get_pending() const noexcept {
+	return m_pending.load(std::memory_order_relaxed);
+}
+
+void UploadThread::thread_loop(std::stop_token a_stop) {
+	glfwMakeContextCurrent(m_context);
+
+	while (true) {
+		Upload upload;
+		{
+			std::unique_lock lock(m_mutex);
+			if (!m_wake.wait(lock, a_stop, [this]() { return !m_queued.empty(); }))
+				break;
+
+			upload = std::move(m_queued.front());
+			m_queued.pop_front();
+		}
+
+		try {
+			upload.upload();
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[UPLOADTHREAD::THREAD_LOOP] Upload failed: {}", e.what()), Error_action::logging);
+		}
+
+		// Flush, so fence reaches GPU and render thread polling it won't wait forever.
+		upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+
+		std::lock_guard lock(m_mutex);
+		m_fenced.push_back(std::move(upload));
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+}
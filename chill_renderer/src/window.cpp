@@ -85,6 +85,9 @@ Window::Window(int a_width, int a_height, const std::string& a_title, CursorMode
 	}
 
 	glViewport(0, 0, m_width, m_height);
+	// Set on render context once, textures may be uploaded on shared context of upload thread.
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// After having window correctly initialised, setup callbacks and imgui
 	m_camera = std::make_unique<Camera>(m_window);
@@ -26,9 +26,13 @@ namespace fs = std::filesystem;
 
 int main() {
 	Application::init(1280, 720, "OpenGL", CursorMode::NORMAL);
+	// Async loads get uploaded on shared context, render thread only publishes them.
+	Application::get_instance().start_upload_thread();
 	ResourceManager& rmanager = Application::get_instance().get_rmanager();
 
 	Scene main_scene;
+	// Job timings are summed per frame for GUI, set before any job is submitted.
+	Application::get_instance().get_jobs().set_timing_hook([profiler = main_scene.get_job_profiler()](const JobTiming& a_timing) { profiler->record(a_timing); });
 	main_scene.set_window(&Application::get_instance().get_win());
 	main_scene.set_camera(&Application::get_instance().get_win().get_camera());
 
@@ -52,6 +56,11 @@ int main() {
 		{ ShaderType::FRAGMENT, gpath("shaders/instanced.frag") },
 		{ ShaderType::GEOMETRY, gpath("shaders/pass_through.geom") })
 	);
+	main_scene.push_shader("multi_batched", rmanager.new_shader(
+		{ ShaderType::VERTEX, gpath("shaders/batched.vert") },
+		{ ShaderType::FRAGMENT, gpath("shaders/multi_light.frag") },
+		{ ShaderType::GEOMETRY, gpath("shaders/pass_through.geom") })
+	);
 	main_scene.push_shader("normal_vis", rmanager.new_shader(
 		{ ShaderType::VERTEX, gpath("shaders/NormalVisualizer/normal_vis.vert") },
 		{ ShaderType::FRAGMENT, gpath("shaders/NormalVisualizer/normal_vis.frag") },
@@ -61,6 +70,10 @@ int main() {
 		{ ShaderType::VERTEX, gpath("shaders/SingleColor/single_color.vert") },
 		{ ShaderType::FRAGMENT, gpath("shaders/SingleColor/single_color.frag") })
 	);
+	main_scene.push_shader("single_batched", rmanager.new_shader(
+		{ ShaderType::VERTEX, gpath("shaders/SingleColor/single_color_batched.vert") },
+		{ ShaderType::FRAGMENT, gpath("shaders/SingleColor/single_color_batched.frag") })
+	);
 	main_scene.push_shader("skybox", rmanager.new_shader(
 		{ ShaderType::VERTEX, gpath("shaders/skybox.vert") },
 		{ ShaderType::FRAGMENT, gpath("shaders/skybox.frag") })
@@ -115,6 +128,13 @@ int main() {
 		{ ShaderType::VERTEX, gpath("shaders/ShadowMap/depth_instanced.vert") },
 		{ ShaderType::FRAGMENT, gpath("shaders/ShadowMap/depth.frag") }) 
 	);
+	main_scene.push_shader("shadow_map_batched", rmanager.new_shader(
+		{ ShaderType::VERTEX, gpath("shaders/ShadowMap/depth_batched.vert") },
+		{ ShaderType::FRAGMENT, gpath("shaders/ShadowMap/depth.frag") }) 
+	);
+	main_scene.push_shader("instance_motion", rmanager.new_shader(
+		{ ShaderType::COMPUTE, gpath("shaders/instance_motion.comp") })
+	);
 
 	// UBO
 	UniformBuffer UBO{};
@@ -150,8 +170,9 @@ int main() {
 			}, false, true),
 		.cube = rmanager.create_model({ Mesh(presets::g_skybox_data, MaterialMap()) })
 	};
+	// 4k faces are streamed in during first frames.
 	Skybox skybox_starmap{
-		.cubemap = TextureCubemap(TextureType::GENERIC,
+		.cubemap = rmanager.load_cubemap_async(TextureType::GENERIC,
 			{
 				gpath("resources/Public/skybox/Starmap/4k/right.jpg"),
 				gpath("resources/Public/skybox/Starmap/4k/left.jpg"),
@@ -190,29 +211,28 @@ int main() {
 	//main_scene.push_generic_model(planet);
 
 	// === Rock ===
-	//Model rock = rmanager.load_model(gpath("resources/Public/LearnOpenGL/rock/rock.obj"));
-	//ModelInstanced cloud(rock);
-	//Rand dice{};
-	//float R = 200.f;
-	//float displacement = 50.f;
-	//const float PI2 = 6.283f;
-	//for (int i = 0, N = 500; i < N; ++i) {
-	//	float deg = float(i) / N * PI2;
-	//	glm::vec3 obj_pos(
-	//		std::cos(deg) * R + dice.roll_f(-displacement, displacement),
-	//		dice.roll_f(-displacement, displacement) / 3, 
-	//		std::sin(deg) * R + dice.roll_f(-displacement, displacement)
-	//	);
-	//	glm::vec3 obj_rot(dice.roll_vec3(0.f, 360.f));
-	//	glm::vec3 obj_siz(dice.roll_f(0.5f, 2.f));
-
-	//	cloud.push_position(obj_pos);
-	//	cloud.push_rotation(obj_rot);
-	//	cloud.push_size(obj_siz);
-	//}
-	//cloud.populate_model_mat_buffer();
-	//cloud.populate_normal_mat_buffer();
-	//main_scene.push_model_instanced(cloud);
+	// Orbits on CPU, "GPU instance animation" in Misc moves them with instance_motion.comp instead.
+	Model rock = rmanager.load_model(gpath("resources/Public/LearnOpenGL/rock/rock.obj"), false, true);
+	ModelInstanced cloud(rock);
+	float R = 200.f;
+	float displacement = 50.f;
+	const float PI2 = 6.283f;
+	for (int i = 0, N = 500; i < N; ++i) {
+		float deg = float(i) / N * PI2;
+		glm::vec3 obj_pos(
+			std::cos(deg) * R + dice.roll_f(-displacement, displacement),
+			dice.roll_f(-displacement, displacement) / 3, 
+			std::sin(deg) * R + dice.roll_f(-displacement, displacement)
+		);
+		glm::vec3 obj_rot(dice.roll_vec3(0.f, 360.f));
+		glm::vec3 obj_siz(dice.roll_f(0.5f, 2.f));
+
+		cloud.push_position(obj_pos);
+		cloud.push_rotation(obj_rot);
+		cloud.push_size(obj_siz);
+	}
+	cloud.populate_model_mat_buffer();
+	main_scene.push_model_instanced(cloud);
 
 	// POSTPROCESS FRAMEBUFFER
 	// MSAA
@@ -228,6 +248,7 @@ int main() {
 		glfwPollEvents();
 		process_input(main_scene); 
 
+		rmanager.process_uploads();
 		main_scene.draw(); 
 		main_scene.post_process(); 
 		draw_gui(main_scene, skybox_river, skybox_starmap);
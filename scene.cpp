@@ -5,6 +5,7 @@
 #include <imgui/backend/imgui_impl_opengl3.h>
 
 #include <format>
+#include <algorithm>
 #include <random>
 
 #include "scene.hpp"
@@ -49,6 +50,69 @@ Rand::DistType& Rand::find_dist(float min, float max) {
 	return (*it).distribution;
 }
 
+// Reflective objects closer than this get dynamic cubemap, at most g_dynamic_env_max of them.
+static constexpr float g_dynamic_env_dist = 10.f;
+static constexpr std::size_t g_dynamic_env_max = 2;
+// Generic models covering at least this ratio of radius to camera distance are occluder candidates, biggest first.
+static constexpr float g_occluder_min_ratio = 0.1f;
+static constexpr std::size_t g_occluder_max = 16;
+// Generic models with this many triangles, or outlined ones, are drawn behind hardware occlusion queries.
+static constexpr std::size_t g_query_min_triangles = 5000;
+static constexpr std::uint64_t g_main_query_set = ~0ull;
+// Fixed step of pipelined update thread, orbits move by same amount per step as per frame without it.
+static constexpr std::chrono::microseconds g_update_step{ 16667 };
+
+static Model& as_model(Model& a_model) {
+	return a_model;
+}
+
+template<typename T>
+static Model& as_model(LitModel<T>& a_lit_model) {
+	return a_lit_model.model;
+}
+
+static const Model& as_model(const Model& a_model) {
+	return a_model;
+}
+
+template<typename T>
+static const Model& as_model(const LitModel<T>& a_lit_model) {
+	return a_lit_model.model;
+}
+
+// BVH user data: object type in upper 4 bits, container index in the rest.
+static std::uint32_t encode_proxy(SceneObjectType a_type, std::size_t a_idx) {
+	return (static_cast<std::uint32_t>(a_type) << 28) | static_cast<std::uint32_t>(a_idx);
+}
+
+static SceneObjectType proxy_type(std::uint32_t a_proxy_data) {
+	return static_cast<SceneObjectType>(a_proxy_data >> 28);
+}
+
+static std::size_t proxy_idx(std::uint32_t a_proxy_data) {
+	return a_proxy_data & 0x0FFFFFFF;
+}
+
+// Models without meshes have no bounds, index them as a point.
+static AABB proxy_aabb(const Model& a_model) {
+	if (a_model.get_world_aabb().is_valid())
+		return a_model.get_world_aabb();
+	AABB ret;
+	ret.expand(a_model.get_pos());
+	return ret;
+}
+
+static bool is_query_candidate(Model& a_model) {
+	if (a_model.is_outlined())
+		return true;
+
+	std::size_t triangles = 0;
+	for (const auto& mesh : a_model.get_meshes()) {
+		triangles += mesh.get_triangle_count();
+	}
+	return triangles >= g_query_min_triangles;
+}
+
 CurShaderState::CurShaderState() {
 	m_kernel[0][0] = 1.f; m_kernel[0][1] =  1.f; m_kernel[0][2] = 1.f;
 	m_kernel[1][0] = 1.f; m_kernel[1][1] = -8.f; m_kernel[1][2] = 1.f;
@@ -114,33 +178,41 @@ void Scene::set_uniforms() {
 
 	m_ubo["view"] = view_mat;
 	m_ubo["projection"] = projection_mat;
+	m_view_proj = projection_mat * view_mat;
+	m_frustum.set(m_view_proj);
 
-	m_shaders["multi"]["light_view"] = m_shadow_map.get_view_mat();
-	m_shaders["multi"]["light_projection"] = m_shadow_map.get_proj_mat();
 	m_shadow_map.activate();
-	m_shaders["multi"]["shadow_map"] = m_shadow_map.get_unit_id();
 	auto& off_win = m_shadow_map.get_offset_window();
 	off_win.activate();
-	m_shaders["multi"]["offset_window"] = off_win.get_unit_id();
-
-	m_shaders["multi"]["view_pos"] = m_camera->get_position();
-	m_shaders["multi"]["near_plane"] = m_camera->get_near_plane();
-	m_shaders["multi"]["far_plane"] = m_camera->get_far_plane();
-	m_shaders["multi"]["fog_dens"] = m_shader_state.m_fog_dens;
-	m_shaders["multi"]["fog_color"] = m_shader_state.m_fog_color;
-	m_shaders["multi"]["is_blinn_phong"] = m_shader_state.m_blinn_phong;
-	m_shaders["refl"]["view_pos"] = m_camera->get_position();
-	m_shaders["refr"]["view_pos"] = m_camera->get_position();
-	m_shaders["dynamic_env"]["view_pos"] = m_camera->get_position();
 
-	// Set light source uniforms 
+	// Spotlight follows camera
 	m_spotlight_sources[0].light.set_pos(m_camera->get_position());
 	m_spotlight_sources[0].light.set_spot_dir(m_camera->get_target()); 
-	m_shaders["multi"].set_uniform("dirlight_source", m_dirlight_sources[0].light);
-	m_shaders["multi"].set_uniform("spotlight_source", m_spotlight_sources[0].light);
-	for (size_t i = 0; i < m_pointlight_sources.size(); i++) {
-		m_shaders["multi"].set_uniform(std::format("pointlight_sources[{}]", i), m_pointlight_sources[i].light);
-	} 
+
+	// Batched variant shades the same, only reads transforms from instance buffer
+	for (const char* name : { "multi", "multi_batched" }) {
+		auto& shader = m_shaders[name];
+		shader["light_view"] = m_shadow_map.get_view_mat();
+		shader["light_projection"] = m_shadow_map.get_proj_mat();
+		shader["shadow_map"] = m_shadow_map.get_unit_id();
+		shader["offset_window"] = off_win.get_unit_id();
+
+		shader["view_pos"] = m_camera->get_position();
+		shader["near_plane"] = m_camera->get_near_plane();
+		shader["far_plane"] = m_camera->get_far_plane();
+		shader["fog_dens"] = m_shader_state.m_fog_dens;
+		shader["fog_color"] = m_shader_state.m_fog_color;
+		shader["is_blinn_phong"] = m_shader_state.m_blinn_phong;
+
+		shader.set_uniform("dirlight_source", m_dirlight_sources[0].light);
+		shader.set_uniform("spotlight_source", m_spotlight_sources[0].light);
+		for (size_t i = 0; i < m_pointlight_sources.size(); i++) {
+			shader.set_uniform(std::format("pointlight_sources[{}]", i), m_pointlight_sources[i].light);
+		} 
+	}
+	m_shaders["refl"]["view_pos"] = m_camera->get_position();
+	m_shaders["refr"]["view_pos"] = m_camera->get_position();
+	m_shaders["dynamic_env"]["view_pos"] = m_camera->get_position();
 }
 
 void Scene::push_shader(const std::string& a_name, const ShaderProgram& a_shader) {
@@ -183,7 +255,45 @@ void Scene::push_frame_buffer_post(FrameBuffer&& a_fb) {
 	m_fb_post_process = std::move(a_fb);
 }
 
+void Scene::push_pending_model(const std::shared_future<Model>& a_model, SceneObjectType a_type, const glm::vec3& a_pos) {
+	m_pending_models.push_back({ a_model, a_type, a_pos });
+}
+
+// Futures are completed by ResourceManager::process_uploads() on this thread, checking them never blocks.
+void Scene::add_loaded_models() {
+	std::erase_if(m_pending_models, [this](const PendingModel& a_pending) {
+		if (a_pending.model.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+
+		Model model;
+		try {
+			model = a_pending.model.get();
+		}
+		catch (const std::exception& e) {
+			ERROR(std::format("[SCENE::ADD_LOADED_MODELS] Model failed to load: {}", e.what()), Error_action::logging);
+			return true;
+		}
+		model.set_pos(a_pending.pos);
+
+		switch (a_pending.type) {
+		case SceneObjectType::GENERIC:	   m_generic_models.push_back(model); break;
+		case SceneObjectType::TRANSPARENT: m_transparent_models.push_back(model); break;
+		case SceneObjectType::REFLECTIVE:  m_reflective_models.push_back(model); break;
+		default: break;
+		}
+		return true;
+		});
+}
+
 void Scene::draw() {
+	for (auto& [pass, stats] : m_cull_stats) {
+		stats.reset();
+	}
+	m_job_profiler->end_frame();
+	add_loaded_models();
+	update_spatial_index();
+	m_draw_locs = get_draw_locations();
+
 	// Shadow maps 
 	draw_shadow_map();
 
@@ -194,7 +304,11 @@ void Scene::draw() {
 	glClearColor(0, 0, 0.1, 1.0);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+	m_cur_pass = RenderPass::MAIN;
+	m_query_set = g_main_query_set;
 	set_uniforms(); 
+	cull_scene();
+	occlusion_cull();
 	draw_lights();
 	transform_models();
 	draw_generic_models(); 
@@ -205,6 +319,10 @@ void Scene::draw() {
 
 	if (m_fb_post_process.get_id() != EMPTY_VBO)
 		m_fb_post_process.unbind();
+
+	// Drop query sets of views not rendered this frame, e.g. objects that stopped being reflection probes
+	std::erase_if(m_occlusion_queries, [this](const auto& a_set) { return !m_used_query_sets.contains(a_set.first); });
+	m_used_query_sets.clear();
 }
 
 void Scene::draw_lights() {
@@ -214,20 +332,47 @@ void Scene::draw_lights() {
 	auto cam_pos = m_camera->get_position();
 
 	m_spotlight_sources[0].model.set_pos(cam_pos);
-	m_shaders["single"]["color"] = m_spotlight_sources[0].light.get_color();
-	m_shaders["single"]["model"] = m_spotlight_sources[0].model.get_model_mat();
-	m_spotlight_sources[0].model.draw();
+	if (cull_model(m_spotlight_sources[0].model)) {
+		m_shaders["single"]["color"] = m_spotlight_sources[0].light.get_color();
+		m_shaders["single"]["model"] = m_spotlight_sources[0].model.get_model_mat();
+		m_spotlight_sources[0].model.draw();
+	}
 
-	m_shaders["single"]["color"] = m_dirlight_sources[0].light.get_color();
-	m_shaders["single"]["model"] = m_dirlight_sources[0].model.get_model_mat();
-	m_dirlight_sources[0].model.draw();
+	if (cull_model(m_dirlight_sources[0].model)) {
+		m_shaders["single"]["color"] = m_dirlight_sources[0].light.get_color();
+		m_shaders["single"]["model"] = m_dirlight_sources[0].model.get_model_mat();
+		m_dirlight_sources[0].model.draw();
+	}
 
 	m_pointlight_sources[0].model.set_pos(cam_pos);
-	for (auto& lit_model : m_pointlight_sources) {
+	auto& visible = m_visible[SceneObjectType::POINTLIGHT];
+	for (std::size_t i = 0; i < m_pointlight_sources.size(); ++i) {
+		if (!visible[i])
+			continue;
+		auto& lit_model = m_pointlight_sources[i];
+		if (m_shader_state.m_auto_instancing) {
+			m_instance_batches.push(lit_model.model, lit_model.light.get_color());
+			continue;
+		}
 		m_shaders["single"]["color"] = lit_model.light.get_color();
 		m_shaders["single"]["model"] = lit_model.model.get_model_mat();
 		lit_model.model.draw(); 
 	} 
+	if (!m_shader_state.m_auto_instancing)
+		return;
+
+	// Gizmos share one mesh, only color differs
+	m_batch_singles.clear();
+	m_batch_single_colors.clear();
+	m_instance_batches.build(m_batch_singles, &m_batch_single_colors);
+	for (std::size_t i = 0; i < m_batch_singles.size(); ++i) {
+		m_shaders["single"]["color"] = m_batch_single_colors[i];
+		m_shaders["single"]["model"] = m_batch_singles[i]->get_model_mat();
+		m_batch_singles[i]->draw();
+	}
+	m_shaders["single_batched"].use();
+	m_instance_batches.draw(m_shaders["single_batched"]);
+	m_instance_batches.clear();
 } 
 
 void Scene::draw_skybox() {
@@ -240,25 +385,59 @@ void Scene::draw_skybox() {
 	glDepthFunc(GL_LESS); 
 }
 
+// Not recorded on job system, occlusion queries and outlines interleave GL calls with draws.
 void Scene::draw_generic_models() {
-	for (auto& gen_obj : m_generic_models) { 
-		m_shaders["multi"].set_uniform("material", m_default_material);
-		m_shaders["multi"]["model"] = gen_obj.get_model_mat();
-		m_shaders["multi"]["normal_mat"] = gen_obj.get_normal_mat();
+	auto& visible = m_visible[SceneObjectType::GENERIC];
+	OcclusionQueries* queries = nullptr;
+	if (m_shader_state.m_occlusion_queries) {
+		queries = &m_occlusion_queries[m_query_set];
+		queries->begin_frame(m_generic_models.size());
+		m_used_query_sets.insert(m_query_set);
+	}
 
-		if (gen_obj.is_outlined()) {
-			m_shaders["single"]["color"] = gen_obj.get_outline_color();
-			gen_obj.draw_outline(m_shaders["multi"], m_shaders["single"], "model", "material");
+	for (std::size_t i = 0; i < m_generic_models.size(); ++i) { 
+		if (!visible[i]) {
+			if (queries)
+				queries->invalidate(i);
+			continue;
 		}
-		else {
-			m_shaders["multi"].use();
-			gen_obj.draw(m_shaders["multi"], "material"); 
+		auto& gen_obj = m_generic_models[i];
+
+		// GPU drops the draw if object's box was hidden last frame
+		bool conditional = queries && is_query_candidate(gen_obj);
+		if (m_shader_state.m_auto_instancing && !conditional && !gen_obj.is_outlined()) {
+			m_instance_batches.push(gen_obj);
+			continue;
 		}
+
+		draw_generic_model(i, queries);
 	} 
 
+	if (m_shader_state.m_auto_instancing) {
+		m_batch_singles.clear();
+		m_instance_batches.build(m_batch_singles);
+		m_shaders["multi"].use();
+		for (auto* model : m_batch_singles) {
+			m_shaders["multi"].set_uniform("material", m_default_material);
+			m_shaders["multi"]["model"] = model->get_model_mat();
+			m_shaders["multi"]["normal_mat"] = model->get_normal_mat();
+			model->draw(m_shaders["multi"], "material");
+		}
+		m_shaders["multi_batched"].use();
+		m_shaders["multi_batched"].set_uniform("material", m_default_material);
+		m_instance_batches.draw(m_shaders["multi_batched"], "material");
+		m_instance_batches.clear();
+	}
+
+	if (queries)
+		draw_occlusion_queries(*queries, visible);
+
 	if (m_shader_state.m_type == CurShaderType::NORMAL_VIS) {
 		m_shaders["normal_vis"].use();
-		for (auto& gen_obj : m_generic_models) { 
+		for (std::size_t i = 0; i < m_generic_models.size(); ++i) { 
+			if (!visible[i])
+				continue;
+			auto& gen_obj = m_generic_models[i];
 			m_shaders["normal_vis"]["model"] = gen_obj.get_model_mat();
 			m_shaders["normal_vis"]["normal_mat"] = gen_obj.get_normal_mat();
 			m_shaders["normal_vis"]["normal_color"] = m_shader_state.m_normal_color;
@@ -268,8 +447,82 @@ void Scene::draw_generic_models() {
 	}
 }
 
+// Draws generic model with its outline, expensive ones behind their occlusion query if a_queries is given.
+void Scene::draw_generic_model(std::size_t a_idx, OcclusionQueries* a_queries) {
+	auto& gen_obj = m_generic_models[a_idx];
+	bool conditional = a_queries && is_query_candidate(gen_obj);
+	m_shaders["multi"].set_uniform("material", m_default_material);
+	m_shaders["multi"]["model"] = gen_obj.get_model_mat();
+	m_shaders["multi"]["normal_mat"] = gen_obj.get_normal_mat();
+	if (conditional)
+		a_queries->begin_conditional(a_idx);
+
+	if (gen_obj.is_outlined()) {
+		m_shaders["single"]["color"] = gen_obj.get_outline_color();
+		gen_obj.draw_outline(m_shaders["multi"], m_shaders["single"], "model", "material");
+	}
+	else {
+		m_shaders["multi"].use();
+		gen_obj.draw(m_shaders["multi"], "material"); 
+	}
+
+	if (conditional)
+		a_queries->end_conditional();
+}
+
+// Draw world boxes of expensive generic models against depth of this pass. Results are used by next frame.
+void Scene::draw_occlusion_queries(OcclusionQueries& a_queries, const std::vector<std::uint8_t>& a_visible) {
+	glm::vec3 cam_pos = m_camera->get_position();
+	float near_plane = m_camera->get_near_plane();
+	bool started = false;
+	for (std::size_t i = 0; i < m_generic_models.size(); ++i) {
+		auto& gen_obj = m_generic_models[i];
+		if (!a_visible[i] || !is_query_candidate(gen_obj) || !a_queries.needs_query(i))
+			continue;
+
+		AABB box = gen_obj.get_world_aabb();
+		if (!box.is_valid()) {
+			a_queries.invalidate(i);
+			continue;
+		}
+		// Outline is scaled copy of model around its position
+		if (gen_obj.is_outlined()) {
+			glm::vec3 pos = gen_obj.get_pos();
+			float thickness = gen_obj.get_outline_thickness();
+			box.expand(pos + (box.min - pos) * thickness);
+			box.expand(pos + (box.max - pos) * thickness);
+		}
+		// Near plane would clip faces of box around camera and query would report it hidden
+		if (glm::all(glm::greaterThanEqual(cam_pos, box.min - near_plane)) && glm::all(glm::lessThanEqual(cam_pos, box.max + near_plane))) {
+			a_queries.invalidate(i);
+			continue;
+		}
+
+		if (!started) {
+			m_shaders["single"].use();
+			glEnable(GL_DEPTH_TEST);
+			glDisable(GL_CULL_FACE);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glDepthMask(GL_FALSE);
+			started = true;
+		}
+		// Query cube spans -0.5..0.5, extent is half of box size.
+		m_shaders["single"]["model"] = glm::scale(glm::translate(glm::mat4(1.0f), box.get_center()), 2.0f * box.get_extent());
+		a_queries.begin_query(i);
+		m_query_box.draw();
+		a_queries.end_query();
+	}
+
+	if (started) {
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_TRUE);
+	}
+}
+
 void Scene::draw_instanced_models() {
 	for (auto& inst_model : m_instanced_models) {
+		if (cull_instanced_model(inst_model) == 0)
+			continue;
 		m_shaders["multi_instanced"].use();
 		m_shaders["multi_instanced"]["view_pos"] = m_camera->get_position();
 		m_shaders["multi_instanced"].set_uniform("material", m_default_material);
@@ -279,47 +532,56 @@ void Scene::draw_instanced_models() {
 	} 
 }
 
+// Faces are culled and recorded in parallel, render thread only replays them. Instanced models and skybox
+// are drawn directly, their culling and draws are GPU side already. So are outlined models and models behind
+// occlusion queries, each face keeps its own query set.
 void Scene::set_reflective_cubemap(Model& a_refl_obj, FrameBuffer& a_fb_refl_cubemap) { 
+	static const std::array<glm::vec3, 6> s_targets = {
+		glm::vec3(1.0, 0.0, 0.0), glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0),
+		glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, 0.0, -1.0),
+	};
+	static const std::array<glm::vec3, 6> s_ups = {
+		glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1),
+		glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0),
+	};
+
 	// Save scene state
 	Camera* m_camera_cp = m_camera;
 	int window_width_cp = m_window->get_width();
 	int window_height_cp = m_window->get_height();
+	RenderPass pass_cp = m_cur_pass;
+	std::uint64_t query_set_cp = m_query_set;
+
+	// Light gizmos follow camera, same as in draw_lights()
+	glm::vec3 refl_pos = a_refl_obj.get_pos();
+	m_spotlight_sources[0].model.set_pos(refl_pos);
+	m_pointlight_sources[0].light.set_pos(refl_pos);
+	m_pointlight_sources[0].model.set_pos(refl_pos);
+
+	std::vector<Camera> refl_cams(6, *m_camera);
+	for (int i = 0; i < 6; ++i) {
+		refl_cams[i].set_position(refl_pos);
+		refl_cams[i].set_fov(90);
+		refl_cams[i].set_target(s_targets[i]);
+		refl_cams[i].set_up(s_ups[i]);
+	}
+	float width = a_fb_refl_cubemap.get_width();
+	float height = a_fb_refl_cubemap.get_height();
+	Application::get_instance().get_jobs().parallel_for(0, 6, 1, [this, &refl_cams, width, height](std::size_t a_begin, std::size_t a_end) {
+			for (std::size_t i = a_begin; i < a_end; ++i) {
+				record_reflection_face(m_refl_faces[i], refl_cams[i], width, height);
+			}
+		}, "record_reflection_face");
 
-	Camera refl_cam = *m_camera;
-	refl_cam.set_position(a_refl_obj.get_pos());
-	refl_cam.set_fov(90);
 	m_window->set_width(a_fb_refl_cubemap.get_width());
 	m_window->set_height(a_fb_refl_cubemap.get_height());
-	m_camera = &refl_cam;
+	m_cur_pass = RenderPass::REFLECTION;
 
 	glViewport(0, 0, a_fb_refl_cubemap.get_width(), a_fb_refl_cubemap.get_height());
 	for (int i = 0; i < 6; ++i) {
-		switch (GL_TEXTURE_CUBE_MAP_POSITIVE_X + i) {
-		case GL_TEXTURE_CUBE_MAP_POSITIVE_X: 
-			refl_cam.set_target(glm::vec3(1.0, 0.0, 0.0)); 
-			refl_cam.set_up(glm::vec3(0, -1, 0));
-			break;
-		case GL_TEXTURE_CUBE_MAP_NEGATIVE_X: 
-			refl_cam.set_target(glm::vec3(-1.0, 0.0, 0.0)); 
-			refl_cam.set_up(glm::vec3(0, -1, 0));
-			break;
-		case GL_TEXTURE_CUBE_MAP_POSITIVE_Y: 
-			refl_cam.set_target(glm::vec3(0.0, 1.0, 0.0)); 
-			refl_cam.set_up(glm::vec3(0, 0, 1));
-			break;
-		case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y: 
-			refl_cam.set_target(glm::vec3(0.0, -1.0, 0.0)); 
-			refl_cam.set_up(glm::vec3(0, 0, -1));
-			break;
-		case GL_TEXTURE_CUBE_MAP_POSITIVE_Z: 
-			refl_cam.set_target(glm::vec3(0.0, 0.0, 1.0)); 
-			refl_cam.set_up(glm::vec3(0, -1, 0));
-			break;
-		case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z: 
-			refl_cam.set_target(glm::vec3(0.0, 0.0, -1.0)); 
-			refl_cam.set_up(glm::vec3(0, -1, 0));
-			break;
-		}
+		auto& face = m_refl_faces[i];
+		m_camera = &refl_cams[i];
+		m_cull_stats[m_cur_pass].add(face.visible, face.total);
 
 		a_fb_refl_cubemap.attach_cubemap_face(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i); 
 		a_fb_refl_cubemap.bind(); 
@@ -327,22 +589,153 @@ void Scene::set_reflective_cubemap(Model& a_refl_obj, FrameBuffer& a_fb_refl_cub
 		glClearColor(0.1, 0.1, 0.1, 1.0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
 		set_uniforms(); 
-		draw_lights();
-		draw_generic_models(); 
+		m_query_set = query_set_cp | i;
+		face.opaque.execute();
+		draw_reflection_face_models(face);
 		draw_instanced_models();
 		draw_skybox(); 
-		draw_transparent_models();
+		face.transparent.execute();
 	}
 	a_fb_refl_cubemap.unbind();
 
 	// Restore scene state
 	m_camera = m_camera_cp;
+	m_cur_pass = pass_cp;
+	m_query_set = query_set_cp;
 	m_window->set_width(window_width_cp);
 	m_window->set_height(window_height_cp);
 	glViewport(0, 0, window_width_cp, window_height_cp);
 	set_uniforms(); 
 }
 
+// Runs on job system, so scene is only read and everything written belongs to a_face.
+void Scene::record_reflection_face(ReflectionFace& a_face, const Camera& a_camera, float a_width, float a_height) {
+	Frustum frustum(a_camera.get_projection_matrix(a_width, a_height) * a_camera.get_look_at());
+
+	// Same culling as cull_scene(), into face's own visibility
+	a_face.total = 0;
+	for (const auto& [type, proxies] : m_bvh_proxies) {
+		a_face.visible_flags[type].assign(proxies.size(), 0);
+		a_face.total += proxies.size();
+	}
+	m_bvh.query_frustum(frustum, a_face.inside, a_face.intersecting);
+	for (auto proxy_data : a_face.inside) {
+		a_face.visible_flags[proxy_type(proxy_data)][proxy_idx(proxy_data)] = 1;
+	}
+	a_face.batch.clear();
+	a_face.batch.reserve(a_face.intersecting.size());
+	for (auto proxy_data : a_face.intersecting) {
+		a_face.batch.push(get_scene_object(proxy_data).get_world_sphere());
+	}
+	a_face.visible = a_face.inside.size() + cull_spheres(frustum, a_face.batch, a_face.batch_flags);
+	for (std::size_t i = 0; i < a_face.intersecting.size(); ++i) {
+		if (a_face.batch_flags[i])
+			a_face.visible_flags[proxy_type(a_face.intersecting[i])][proxy_idx(a_face.intersecting[i])] = 1;
+	}
+
+	const auto& single = m_shaders.at("single");
+	const auto& multi = m_shaders.at("multi");
+	const DrawLocations& locs = m_draw_locs;
+
+	// Lights
+	CommandBuffer& opaque = a_face.opaque;
+	opaque.clear();
+	opaque.use_program(single);
+	auto record_light = [&opaque, &locs](auto& a_lit_model) {
+		opaque.set_uniform(locs.single_color, a_lit_model.light.get_color());
+		opaque.set_uniform(locs.single_model, a_lit_model.model.get_model_mat());
+		opaque.draw(a_lit_model.model);
+	};
+	auto cull_light = [&a_face, &frustum](const Model& a_model) {
+		bool visible = frustum.intersects(a_model.get_world_sphere());
+		a_face.visible += visible;
+		a_face.total++;
+		return visible;
+	};
+	if (cull_light(m_spotlight_sources[0].model))
+		record_light(m_spotlight_sources[0]);
+	if (cull_light(m_dirlight_sources[0].model))
+		record_light(m_dirlight_sources[0]);
+	const auto& pointlight_visible = a_face.visible_flags[SceneObjectType::POINTLIGHT];
+	for (std::size_t i = 0; i < m_pointlight_sources.size(); ++i) {
+		if (pointlight_visible[i])
+			record_light(m_pointlight_sources[i]);
+	}
+
+	// Generic models
+	opaque.use_program(multi);
+	const auto& generic_visible = a_face.visible_flags[SceneObjectType::GENERIC];
+	bool queries = m_shader_state.m_occlusion_queries;
+	a_face.direct.clear();
+	for (std::size_t i = 0; i < m_generic_models.size(); ++i) {
+		if (!generic_visible[i])
+			continue;
+		auto& gen_obj = m_generic_models[i];
+		if (gen_obj.is_outlined() || (queries && is_query_candidate(gen_obj))) {
+			a_face.direct.push_back(i);
+			continue;
+		}
+		opaque.set_material(m_default_material, locs.material);
+		opaque.set_uniform(locs.multi_model, gen_obj.get_model_mat());
+		opaque.set_uniform(locs.multi_normal_mat, gen_obj.get_normal_mat());
+		opaque.draw(gen_obj, locs.material);
+	}
+
+	// Transparent models from furthest to nearest
+	glm::vec3 cam_pos = a_camera.get_position();
+	const auto& transparent_visible = a_face.visible_flags[SceneObjectType::TRANSPARENT];
+	a_face.transparent_order.clear();
+	for (std::size_t i = 0; i < m_transparent_models.size(); ++i) {
+		if (transparent_visible[i])
+			a_face.transparent_order.emplace_back(glm::length2(m_transparent_models[i].get_pos() - cam_pos), i);
+	}
+	std::sort(a_face.transparent_order.begin(), a_face.transparent_order.end(), std::greater<>());
+
+	CommandBuffer& transparent = a_face.transparent;
+	transparent.clear();
+	transparent.use_program(multi);
+	transparent.set_state(ShaderState::FACE_CULLING, false);
+	for (const auto& [dist, idx] : a_face.transparent_order) {
+		auto& trans_obj = m_transparent_models[idx];
+		transparent.set_uniform(locs.multi_model, trans_obj.get_model_mat());
+		transparent.set_uniform(locs.multi_normal_mat, trans_obj.get_normal_mat());
+		transparent.draw(trans_obj, locs.material);
+	}
+}
+
+// Same as draw_generic_models() for models recording left out, query set of face is selected by caller.
+void Scene::draw_reflection_face_models(ReflectionFace& a_face) {
+	const auto& visible = a_face.visible_flags[SceneObjectType::GENERIC];
+	OcclusionQueries* queries = nullptr;
+	if (m_shader_state.m_occlusion_queries) {
+		queries = &m_occlusion_queries[m_query_set];
+		queries->begin_frame(m_generic_models.size());
+		m_used_query_sets.insert(m_query_set);
+		for (std::size_t i = 0; i < visible.size(); ++i) {
+			if (!visible[i])
+				queries->invalidate(i);
+		}
+	}
+
+	for (auto idx : a_face.direct) {
+		draw_generic_model(idx, queries);
+	}
+
+	if (queries)
+		draw_occlusion_queries(*queries, visible);
+}
+
+Scene::DrawLocations Scene::get_draw_locations() {
+	DrawLocations locs;
+	locs.multi_model = m_shaders["multi"]["model"].get_location();
+	locs.multi_normal_mat = m_shaders["multi"]["normal_mat"].get_location();
+	locs.single_model = m_shaders["single"]["model"].get_location();
+	locs.single_color = m_shaders["single"]["color"].get_location();
+	locs.shadow_model = m_shaders["shadow_map"]["model"].get_location();
+	locs.material = m_shaders["multi"].get_material_locations("material");
+	return locs;
+}
+
 void Scene::draw_reflective_models(const FrameBuffer& a_fb_last) {
 	if (m_fb_refl_cubemap.get_id() == EMPTY_VBO) {
 		FrameBuffer fb_refl_cubemap(2048, 2048);
@@ -354,10 +747,24 @@ void Scene::draw_reflective_models(const FrameBuffer& a_fb_last) {
 		m_fb_refl_cubemap = std::move(fb_refl_cubemap);
 	}
 
+	// Pick nearest reflective objects for dynamic environment mapping
+	m_bvh.query_nearest(m_camera->get_position(), g_dynamic_env_max, g_dynamic_env_dist, m_refl_probes, [](std::uint32_t a_proxy_data) {
+		return proxy_type(a_proxy_data) == SceneObjectType::REFLECTIVE;
+		});
+
 	m_shaders["dynamic_env"].use();
-	for (auto& refl_obj : m_reflective_models) {
-		if (glm::length(m_camera->get_position() - refl_obj.get_pos()) < 10) {
+	auto& visible = m_visible[SceneObjectType::REFLECTIVE];
+	for (std::size_t i = 0; i < m_reflective_models.size(); ++i) {
+		// Culled objects don't need their cubemap rendered either
+		if (!visible[i])
+			continue;
+		auto& refl_obj = m_reflective_models[i];
+		bool is_probe = std::find(m_refl_probes.begin(), m_refl_probes.end(), encode_proxy(SceneObjectType::REFLECTIVE, i)) != m_refl_probes.end();
+		if (is_probe) {
+			// Low bits select cubemap face
+			m_query_set = static_cast<std::uint64_t>(encode_proxy(SceneObjectType::REFLECTIVE, i)) << 3;
 			set_reflective_cubemap(refl_obj, m_fb_refl_cubemap);
+			m_query_set = g_main_query_set;
 			m_fb_refl_cubemap.activate_color(); 
 		}
 		else {
@@ -373,17 +780,22 @@ void Scene::draw_reflective_models(const FrameBuffer& a_fb_last) {
 	a_fb_last.bind();
 }
 
-// Sort from furthest to nearest only when camera moves
+// Sort visible objects from furthest to nearest. Only draw order is sorted, models keep their place.
 void Scene::sort_transparent_models() {
-	static glm::vec3 prev_cam_pos(0, 0, 0);
-	if (auto cam_pos = m_camera->get_position(); cam_pos != prev_cam_pos) {
-		prev_cam_pos = cam_pos;
-		m_pointlight_sources[0].light.set_pos(cam_pos);
-		m_pointlight_sources[0].model.set_pos(cam_pos);
-		std::sort(m_transparent_models.begin(), m_transparent_models.end(), [&cam_pos](const Model& trans_obj1, const Model& trans_obj2) {
-			return glm::length2(trans_obj1.get_pos() - cam_pos) > glm::length2(trans_obj2.get_pos() - cam_pos);
-			});
-	} 
+	auto cam_pos = m_camera->get_position();
+	m_pointlight_sources[0].light.set_pos(cam_pos);
+	m_pointlight_sources[0].model.set_pos(cam_pos);
+
+	auto& visible = m_visible[SceneObjectType::TRANSPARENT];
+	m_transparent_order.clear();
+	for (std::size_t i = 0; i < m_transparent_models.size(); ++i) {
+		if (visible[i])
+			m_transparent_order.push_back(i);
+	}
+
+	std::sort(m_transparent_order.begin(), m_transparent_order.end(), [this, &cam_pos](std::size_t idx1, std::size_t idx2) {
+		return glm::length2(m_transparent_models[idx1].get_pos() - cam_pos) > glm::length2(m_transparent_models[idx2].get_pos() - cam_pos);
+		});
 }
 
 void Scene::draw_transparent_models() {
@@ -391,7 +803,8 @@ void Scene::draw_transparent_models() {
 
 	m_shaders["multi"].set_state(ShaderState::FACE_CULLING, false);
 	m_shaders["multi"].use();
-	for (auto& trans_obj : m_transparent_models) {
+	for (std::size_t i : m_transparent_order) {
+		auto& trans_obj = m_transparent_models[i];
 		m_shaders["multi"]["model"] = trans_obj.get_model_mat();
 		m_shaders["multi"]["normal_mat"] = trans_obj.get_normal_mat();
 		trans_obj.draw(m_shaders["multi"], "material");
@@ -412,17 +825,24 @@ void Scene::draw_shadow_map() {
 	m_shadow_map.set_view(m_dirlight_sources[0].model.get_pos(), glm::vec3(0.f, 0.f, 0.1f));
 	m_shadow_map.bind();
 
-	auto lamb_draw_models = [m_this = this](auto& objs) {
-			for (auto& obj : objs) {
-				m_this->m_shaders["shadow_map"]["model"] = obj.get_model_mat();
-				obj.draw();
+	// Cull against light frustum
+	m_cur_pass = RenderPass::SHADOW;
+	m_frustum.set(m_shadow_map.get_proj_mat() * m_shadow_map.get_view_mat());
+	cull_scene();
+
+	auto lamb_draw_model = [m_this = this](Model& obj) {
+			if (m_this->m_shader_state.m_auto_instancing) {
+				m_this->m_instance_batches.push(obj);
+				return;
 			}
+			m_this->m_shaders["shadow_map"]["model"] = obj.get_model_mat();
+			obj.draw();
 		};
-	auto lamb_draw_litmodels = [m_this = this](auto& litobjs) {
+	auto lamb_draw_litmodels = [m_this = this, &lamb_draw_model](auto& litobjs) {
 			for (auto& litobj : litobjs) {
-				auto& obj = litobj.model;
-				m_this->m_shaders["shadow_map"]["model"] = obj.get_model_mat();
-				obj.draw();
+				if (!m_this->cull_model(litobj.model))
+					continue;
+				lamb_draw_model(litobj.model);
 			}
 		};
 
@@ -437,18 +857,75 @@ void Scene::draw_shadow_map() {
 	m_shaders["shadow_map"]["light_view"] = m_shadow_map.get_view_mat();
 	m_shaders["shadow_map"]["light_projection"] = m_shadow_map.get_proj_mat();
 
-	lamb_draw_litmodels(m_pointlight_sources);
+	// Indexed groups are recorded, or keyed into own batches, on job system while few lights are handled here
+	auto lamb_record_models = [m_this = this, model_loc = m_draw_locs.shadow_model](std::size_t slot, auto& objs, const std::vector<std::uint8_t>& visible) {
+			if (m_this->m_shader_state.m_auto_instancing) {
+				auto& batches = m_this->m_shadow_batches[slot];
+				batches.clear();
+				for (std::size_t i = 0; i < objs.size(); ++i) {
+					if (visible[i])
+						batches.push(as_model(objs[i]));
+				}
+				return;
+			}
+			auto& commands = m_this->m_shadow_commands[slot];
+			commands.clear();
+			for (std::size_t i = 0; i < objs.size(); ++i) {
+				if (!visible[i])
+					continue;
+				commands.set_uniform(model_loc, as_model(objs[i]).get_model_mat());
+				commands.draw(as_model(objs[i]));
+			}
+		};
+	auto& pointlight_visible = m_visible[SceneObjectType::POINTLIGHT];
+	auto& generic_visible = m_visible[SceneObjectType::GENERIC];
+	auto& transparent_visible = m_visible[SceneObjectType::TRANSPARENT];
+	auto& reflective_visible = m_visible[SceneObjectType::REFLECTIVE];
+
+	JobSystem& jobs = Application::get_instance().get_jobs();
+	JobCounter counter;
+	jobs.submit([&]() { lamb_record_models(0, m_pointlight_sources, pointlight_visible); }, &counter, "record_shadow");
+	jobs.submit([&]() { lamb_record_models(1, m_generic_models, generic_visible); }, &counter, "record_shadow");
+	jobs.submit([&]() { lamb_record_models(2, m_transparent_models, transparent_visible); }, &counter, "record_shadow");
+	jobs.submit([&]() { lamb_record_models(3, m_reflective_models, reflective_visible); }, &counter, "record_shadow");
 	lamb_draw_litmodels(m_dirlight_sources);
 	lamb_draw_litmodels(m_spotlight_sources);
-	lamb_draw_models(m_generic_models);
-	lamb_draw_models(m_transparent_models);
-	lamb_draw_models(m_reflective_models);
+	jobs.wait(counter);
+
+	if (!m_shader_state.m_auto_instancing) {
+		for (const auto& commands : m_shadow_commands) {
+			commands.execute();
+		}
+	}
+	else {
+		// Depth only pass, models sharing meshes within a group land in one batch. Streaming touches GL, so
+		// batches are built here.
+		m_batch_singles.clear();
+		m_instance_batches.build(m_batch_singles);
+		for (auto& batches : m_shadow_batches) {
+			batches.build(m_batch_singles);
+		}
+		for (auto* model : m_batch_singles) {
+			m_shaders["shadow_map"]["model"] = model->get_model_mat();
+			model->draw();
+		}
+		m_shaders["shadow_map_batched"].use();
+		m_shaders["shadow_map_batched"]["light_view"] = m_shadow_map.get_view_mat();
+		m_shaders["shadow_map_batched"]["light_projection"] = m_shadow_map.get_proj_mat();
+		m_instance_batches.draw(m_shaders["shadow_map_batched"]);
+		m_instance_batches.clear();
+		for (auto& batches : m_shadow_batches) {
+			batches.draw(m_shaders["shadow_map_batched"]);
+			batches.clear();
+		}
+	}
 
 	m_shaders["shadow_map_instanced"].use();
 	m_shaders["shadow_map_instanced"]["light_view"] = m_shadow_map.get_view_mat();
 	m_shaders["shadow_map_instanced"]["light_projection"] = m_shadow_map.get_proj_mat();
 	for (auto& instobj : m_instanced_models) {
-		instobj.draw();
+		if (cull_instanced_model(instobj) > 0)
+			instobj.draw();
 	}
 
 	// glCullFace(GL_BACK);
@@ -457,36 +934,164 @@ void Scene::draw_shadow_map() {
 }
 
 void Scene::transform_models() { 
+	if (m_shader_state.m_pipelined_update != m_update_thread.joinable()) {
+		if (m_shader_state.m_pipelined_update)
+			start_update_thread();
+		else
+			stop_update_thread();
+	}
+
+	if (m_update_thread.joinable() && m_snapshots.consume()) {
+		const auto& snapshot = m_snapshots.get_read();
+		std::size_t simulated = std::ranges::count_if(m_instanced_models, [](const ModelInstanced& a_inst) { return !a_inst.is_animated(); });
+		bool stale = simulated != snapshot.instanced.size();
+		for (const auto& instances : snapshot.instanced) {
+			if (stale)
+				break;
+			auto& inst_model = m_instanced_models[instances.model_idx];
+			stale = inst_model.is_animated() || inst_model.get_instance_count() != instances.transforms.size();
+			if (!stale)
+				inst_model.set_transforms(instances.transforms, instances.spheres);
+		}
+		// Instances were changed on render thread, simulation restarts from their current state.
+		if (stale) {
+			stop_update_thread();
+			start_update_thread();
+		}
+	}
+
 	for (auto& inst_model : m_instanced_models) {
-		auto positions = inst_model.get_positions();
-		auto& rotations = inst_model.get_rotations();
-		const float diff = AI_DEG_TO_RAD(0.1f);
-		static float alfa = 0.f;
-		const std::size_t N = positions.size();
-		const float R = 200.f;
-		const float PI2 = 6.283f;
-		using EngType = std::default_random_engine;
-		using DistType = std::normal_distribution<>;
-		EngType eng;
-		eng.seed();
-		DistType dist(0.f, 1.0f); 
-		for (std::size_t i = 0; i < positions.size(); ++i) {
-			float deg = float(i) / N * PI2;
-			positions[i].x += R * (cos(deg + alfa) - cos(deg + alfa - diff));
-			positions[i].z += R * (sin(deg + alfa) - sin(deg + alfa - diff));
-
-			rotations[i].x += dist(eng);
+		// Switching back leaves instances where CPU orbit stopped, their vectors aren't touched while animated.
+		if (m_shader_state.m_gpu_instance_motion != inst_model.is_animated()) {
+			if (m_shader_state.m_gpu_instance_motion)
+				inst_model.set_motions(orbit_motions(inst_model), glm::vec3(0.0f));
+			else
+				inst_model.populate_model_mat_buffer();
 		}
-		alfa += diff;
-		if (alfa > PI2) {
-			alfa = 0.f;
+
+		// Constant CPU cost, motion is evaluated by compute shader.
+		if (inst_model.is_animated()) {
+			inst_model.animate(m_shaders["instance_motion"], static_cast<float>(glfwGetTime()));
+			continue;
 		}
-		inst_model.push_positions(positions);
+		if (m_update_thread.joinable())
+			continue;
+
+		step_orbit(inst_model.get_positions(), inst_model.get_rotations(), m_orbit_alfa);
 		inst_model.populate_model_mat_buffer();
-		inst_model.populate_normal_mat_buffer();
 	}
 } 
 
+void Scene::step_orbit(Vec3Array& a_positions, Vec3Array& a_rotations, float& a_alfa) {
+	const float diff = AI_DEG_TO_RAD(0.1f);
+	const std::size_t N = a_positions.size();
+	const float R = 200.f;
+	const float PI2 = 6.283f;
+	using EngType = std::default_random_engine;
+	using DistType = std::normal_distribution<>;
+	EngType eng;
+	eng.seed();
+	DistType dist(0.f, 1.0f); 
+	for (std::size_t i = 0; i < a_positions.size(); ++i) {
+		float deg = float(i) / N * PI2;
+		a_positions.x[i] += R * (cos(deg + a_alfa) - cos(deg + a_alfa - diff));
+		a_positions.z[i] += R * (sin(deg + a_alfa) - sin(deg + a_alfa - diff));
+
+		a_rotations.x[i] += dist(eng);
+	}
+	a_alfa += diff;
+	if (a_alfa > PI2) {
+		a_alfa = 0.f;
+	}
+}
+
+// GPU counterpart of step_orbit(), instances keep their distance from orbit center and speed of one step per update step.
+std::vector<InstanceMotion> Scene::orbit_motions(ModelInstanced& a_inst_model) {
+	a_inst_model.populate_model_mat_buffer();
+	const auto& positions = a_inst_model.get_positions();
+	const auto& rotations = a_inst_model.get_rotations();
+	const auto& sizes = a_inst_model.get_size();
+	const float speed = AI_DEG_TO_RAD(0.1f) * 1e6f / g_update_step.count();
+
+	std::vector<InstanceMotion> motions(positions.size());
+	for (std::size_t i = 0; i < motions.size(); ++i) {
+		glm::vec3 pos = positions.get(i);
+		motions[i].radius = glm::length(glm::vec2(pos.x, pos.z));
+		motions[i].phase = std::atan2(pos.z, pos.x);
+		motions[i].angular_speed = speed;
+		motions[i].height = pos.y;
+		motions[i].tumble_axis = rotations.get(i) + glm::vec3(0.0f, 0.01f, 0.0f);
+		motions[i].tumble_speed = 1.0f;
+		motions[i].size = sizes.get(i);
+	}
+	return motions;
+}
+
+// Simulated instances are copied out, render thread only applies published snapshots until stop_update_thread().
+void Scene::start_update_thread() {
+	m_orbit_states.clear();
+	for (std::size_t i = 0; i < m_instanced_models.size(); ++i) {
+		auto& inst_model = m_instanced_models[i];
+		if (inst_model.is_animated())
+			continue;
+
+		// Evens out instance vectors, so they can be composed without model.
+		inst_model.populate_model_mat_buffer();
+		m_orbit_states.push_back(OrbitState{ 
+			.model_idx = i, 
+			.positions = inst_model.get_positions(), 
+			.rotations = inst_model.get_rotations(), 
+			.sizes = inst_model.get_size(), 
+			.local_sphere = BoundingSphere(inst_model.get_model_base().get_aabb()) 
+		});
+	}
+
+	// Drop snapshot left from previous run.
+	m_snapshots.consume();
+	m_update_thread = std::jthread([this](std::stop_token a_stop) { update_loop(a_stop); });
+}
+
+void Scene::stop_update_thread() {
+	if (!m_update_thread.joinable())
+		return;
+
+	m_update_thread.request_stop();
+	m_update_thread.join();
+
+	// Simulation continues on render thread where update thread left it.
+	for (auto& state : m_orbit_states) {
+		auto& inst_model = m_instanced_models[state.model_idx];
+		if (inst_model.is_animated() || inst_model.get_positions().size() != state.positions.size())
+			continue;
+
+		inst_model.get_positions() = std::move(state.positions);
+		inst_model.get_rotations() = std::move(state.rotations);
+	}
+	m_orbit_states.clear();
+}
+
+void Scene::update_loop(std::stop_token a_stop) {
+	using clock = std::chrono::steady_clock;
+	auto next_step = clock::now();
+	while (!a_stop.stop_requested()) {
+		auto& snapshot = m_snapshots.get_write();
+		snapshot.instanced.resize(m_orbit_states.size());
+		for (std::size_t i = 0; i < m_orbit_states.size(); ++i) {
+			auto& state = m_orbit_states[i];
+			auto& instances = snapshot.instanced[i];
+			step_orbit(state.positions, state.rotations, m_orbit_alfa);
+			instances.model_idx = state.model_idx;
+			instances.transforms.resize(state.positions.size());
+			compose_transforms(state.positions, state.rotations, state.sizes, state.local_sphere, instances.transforms.data(), instances.spheres);
+		}
+		m_snapshots.publish();
+
+		// Steps missed during spike are dropped instead of run back to back.
+		next_step = std::max(next_step + g_update_step, clock::now());
+		std::this_thread::sleep_until(next_step);
+	}
+}
+
 Window* Scene::get_window() {
 	return m_window;
 }
@@ -539,6 +1144,179 @@ std::map<std::string, ShaderProgram>& Scene::get_shaders() {
 	return m_shaders;
 }
 
+const std::map<RenderPass, CullingStats>& Scene::get_culling_stats() const {
+	return m_cull_stats;
+}
+
+std::shared_ptr<JobProfiler> Scene::get_job_profiler() const {
+	return m_job_profiler;
+}
+
+// Pick nearest generic, transparent or reflective model whose world box is hit by the ray.
+Model* Scene::pick_model(const glm::vec3& a_origin, const glm::vec3& a_dir, float a_max_dist) {
+	m_bvh.query_ray(a_origin, a_dir, a_max_dist, m_ray_hits);
+
+	Model* nearest = nullptr;
+	float nearest_dist = a_max_dist;
+	glm::vec3 inv_dir = 1.0f / a_dir;
+	for (const auto& hit : m_ray_hits) {
+		// Fat box entry is lower bound of real distance, so nothing further can be closer.
+		if (hit.distance > nearest_dist)
+			break;
+		if (proxy_type(hit.user_data) == SceneObjectType::POINTLIGHT)
+			continue;
+
+		Model& model = get_scene_object(hit.user_data);
+		float dist{};
+		if (model.get_world_aabb().intersects_ray(a_origin, inv_dir, nearest_dist, dist) && dist <= nearest_dist) {
+			nearest = &model;
+			nearest_dist = dist;
+		}
+	}
+	return nearest;
+}
+
+// Keep proxies in sync with containers. Containers are edited directly (GUI), so a size change rebuilds
+// proxies of that type, otherwise proxies are moved which is no-op while object stays in its fat box.
+template<typename T>
+void Scene::sync_spatial_index(SceneObjectType a_type, const std::vector<T>& a_models) {
+	auto& proxies = m_bvh_proxies[a_type];
+	if (proxies.size() != a_models.size()) {
+		for (int proxy : proxies) {
+			m_bvh.destroy_proxy(proxy);
+		}
+		proxies.clear();
+		for (std::size_t i = 0; i < a_models.size(); ++i) {
+			proxies.push_back(m_bvh.create_proxy(proxy_aabb(as_model(a_models[i])), encode_proxy(a_type, i)));
+		}
+		return;
+	}
+
+	for (std::size_t i = 0; i < a_models.size(); ++i) {
+		m_bvh.move_proxy(proxies[i], proxy_aabb(as_model(a_models[i])));
+	}
+}
+
+void Scene::update_spatial_index() {
+	sync_spatial_index(SceneObjectType::GENERIC, m_generic_models);
+	sync_spatial_index(SceneObjectType::TRANSPARENT, m_transparent_models);
+	sync_spatial_index(SceneObjectType::REFLECTIVE, m_reflective_models);
+	sync_spatial_index(SceneObjectType::POINTLIGHT, m_pointlight_sources);
+}
+
+// Set visibility of indexed objects for current pass frustum. Subtrees fully inside frustum are accepted
+// without tests, objects crossing frustum planes get batched sphere test.
+void Scene::cull_scene() {
+	std::size_t total = 0;
+	for (auto& [type, proxies] : m_bvh_proxies) {
+		m_visible[type].assign(proxies.size(), 0);
+		total += proxies.size();
+	}
+
+	m_bvh.query_frustum(m_frustum, m_bvh_inside, m_bvh_intersecting);
+	for (auto proxy_data : m_bvh_inside) {
+		m_visible[proxy_type(proxy_data)][proxy_idx(proxy_data)] = 1;
+	}
+
+	m_cull_batch.clear();
+	m_cull_batch.reserve(m_bvh_intersecting.size());
+	for (auto proxy_data : m_bvh_intersecting) {
+		m_cull_batch.push(get_scene_object(proxy_data).get_world_sphere());
+	}
+	std::size_t visible_siz = m_bvh_inside.size() + cull_spheres(m_frustum, m_cull_batch, m_cull_flags);
+	for (std::size_t i = 0; i < m_bvh_intersecting.size(); ++i) {
+		if (m_cull_flags[i])
+			m_visible[proxy_type(m_bvh_intersecting[i])][proxy_idx(m_bvh_intersecting[i])] = 1;
+	}
+
+	m_cull_stats[m_cur_pass].add(visible_siz, total);
+}
+
+// Rasterize biggest visible generic models into software depth buffer and drop indexed objects
+// whose world boxes end up behind them.
+void Scene::occlusion_cull() {
+	if (!m_shader_state.m_occlusion_culling)
+		return;
+
+	glm::vec3 cam_pos = m_camera->get_position();
+	m_occluders.clear();
+	auto& generic_visible = m_visible[SceneObjectType::GENERIC];
+	for (std::size_t i = 0; i < m_generic_models.size(); ++i) {
+		if (!generic_visible[i])
+			continue;
+
+		const BoundingSphere& sphere = m_generic_models[i].get_world_sphere();
+		float dist = std::max(glm::length(sphere.center - cam_pos), sphere.radius);
+		float ratio = sphere.radius / dist;
+		if (ratio >= g_occluder_min_ratio)
+			m_occluders.emplace_back(ratio, encode_proxy(SceneObjectType::GENERIC, i));
+	}
+	if (m_occluders.empty())
+		return;
+
+	std::sort(m_occluders.begin(), m_occluders.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+	if (m_occluders.size() > g_occluder_max)
+		m_occluders.resize(g_occluder_max);
+
+	m_occlusion_buffer.clear();
+	m_occlusion_buffer.set_view_proj(m_view_proj);
+	for (const auto& [ratio, proxy_data] : m_occluders) {
+		Model& model = get_scene_object(proxy_data);
+		glm::mat4 model_mat = model.get_model_mat();
+		for (const auto& mesh : model.get_meshes()) {
+			const auto& occluder = mesh.get_occluder();
+			if (occluder && mesh.get_visibility() && !mesh.get_wireframe() && mesh.get_draw_mode() == BufferDrawType::TRIANGLES)
+				m_occlusion_buffer.add_occluder(model_mat, occluder->positions, occluder->indicies);
+		}
+	}
+	if (m_occlusion_buffer.get_triangle_count() == 0)
+		return;
+	m_occlusion_buffer.rasterize();
+
+	std::size_t occluded = 0;
+	for (auto& [type, visible] : m_visible) {
+		for (std::size_t i = 0; i < visible.size(); ++i) {
+			std::uint32_t proxy_data = encode_proxy(type, i);
+			if (!visible[i] || std::ranges::any_of(m_occluders, [proxy_data](const auto& o) { return o.second == proxy_data; }))
+				continue;
+
+			if (!m_occlusion_buffer.test_aabb(get_scene_object(proxy_data).get_world_aabb())) {
+				visible[i] = 0;
+				occluded++;
+			}
+		}
+	}
+
+	auto& stats = m_cull_stats[m_cur_pass];
+	stats.visible -= occluded;
+	stats.culled += occluded;
+	stats.occluded += occluded;
+}
+
+Model& Scene::get_scene_object(std::uint32_t a_proxy_data) {
+	std::size_t idx = proxy_idx(a_proxy_data);
+	switch (proxy_type(a_proxy_data)) {
+	case SceneObjectType::GENERIC:	   return m_generic_models[idx];
+	case SceneObjectType::TRANSPARENT: return m_transparent_models[idx];
+	case SceneObjectType::REFLECTIVE:  return m_reflective_models[idx];
+	case SceneObjectType::POINTLIGHT:  return m_pointlight_sources[idx].model;
+	}
+	ERROR(std::format("[SCENE::GET_SCENE_OBJECT] Bad proxy data: {}", a_proxy_data), Error_action::throwing);
+	return m_generic_models[idx];
+}
+
+std::size_t Scene::cull_instanced_model(ModelInstanced& a_inst_model) {
+	std::size_t visible_siz = a_inst_model.cull(m_frustum);
+	m_cull_stats[m_cur_pass].add(visible_siz, a_inst_model.get_instance_count());
+	return visible_siz;
+}
+
+bool Scene::cull_model(const Model& a_model) {
+	bool visible = m_frustum.intersects(a_model.get_world_sphere());
+	m_cull_stats[m_cur_pass].add(visible, 1);
+	return visible;
+}
+
 void process_input(Scene& a_scene) {
 	Window& win = *a_scene.get_window();
 	Camera& cam = *a_scene.get_camera();
@@ -750,9 +1528,8 @@ void draw_gui(Scene& scene, Skybox& skybox1, Skybox& skybox2) {
 					if (choice) {
 						path = ResourceManager::dialog_import_model();
 						if (path != L"") {
-							Model new_model = Application::get_instance().get_rmanager().load_model(path, invert_UVs, true);
-							new_model.set_pos(cam.get_position() + cam.get_target() * glm::vec3(2.5));
-							generic_models.push_back(new_model);
+							auto new_model = Application::get_instance().get_rmanager().load_model_async(path, invert_UVs, true);
+							scene.push_pending_model(new_model, SceneObjectType::GENERIC, cam.get_position() + cam.get_target() * glm::vec3(2.5));
 						}
 					}
 					ImGui::EndPopup();
@@ -795,9 +1572,8 @@ void draw_gui(Scene& scene, Skybox& skybox1, Skybox& skybox2) {
 					if (choice) {
 						path = ResourceManager::dialog_import_model();
 						if (path != L"") {
-							Model new_model = Application::get_instance().get_rmanager().load_model(path, invert_UVs, true);
-							new_model.set_pos(cam.get_position() + cam.get_target() * glm::vec3(2.5));
-							transparent_models.push_back(new_model);
+							auto new_model = Application::get_instance().get_rmanager().load_model_async(path, invert_UVs, true);
+							scene.push_pending_model(new_model, SceneObjectType::TRANSPARENT, cam.get_position() + cam.get_target() * glm::vec3(2.5));
 						}
 					}
 					ImGui::EndPopup();
@@ -823,9 +1599,8 @@ void draw_gui(Scene& scene, Skybox& skybox1, Skybox& skybox2) {
 				if (ImGui::Button("Create model")) {
 					auto path = ResourceManager::dialog_import_model();
 					if (path != L"") {
-						Model new_model = Application::get_instance().get_rmanager().load_model(path, false, true);
-						new_model.set_pos(cam.get_position() + cam.get_target() * glm::vec3(2.5));
-						reflective_models.push_back(new_model);
+						auto new_model = Application::get_instance().get_rmanager().load_model_async(path, false, true);
+						scene.push_pending_model(new_model, SceneObjectType::REFLECTIVE, cam.get_position() + cam.get_target() * glm::vec3(2.5));
 					}
 				} 
 				if (ImGui::Button("Clear models")) {
@@ -998,6 +1773,36 @@ void draw_gui(Scene& scene, Skybox& skybox1, Skybox& skybox2) {
 		// Performance
 		ImGui::SeparatorText("Misc");
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / im_io->Framerate, im_io->Framerate);
+		for (const auto& [pass, stats] : scene.get_culling_stats()) {
+			const char* pass_name = "";
+			switch (pass) {
+			case RenderPass::SHADOW:	 pass_name = "Shadow"; break;
+			case RenderPass::MAIN:		 pass_name = "Main"; break;
+			case RenderPass::REFLECTION: pass_name = "Reflection"; break;
+			}
+			ImGui::Text("%s pass culling: %zu visible, %zu culled (%zu occluded)", pass_name, stats.visible, stats.culled, stats.occluded);
+		}
+		for (const auto& [name, entry] : scene.get_job_profiler()->get_frame()) {
+			ImGui::Text("Job %s: %zu runs, %.3f ms", name.c_str(), entry.count, entry.ms);
+		}
+		ImGui::Checkbox("Occlusion culling", &scene.get_shader_state().m_occlusion_culling);
+		ImGui::Checkbox("Occlusion queries", &scene.get_shader_state().m_occlusion_queries);
+		ImGui::Checkbox("Automatic instancing", &scene.get_shader_state().m_auto_instancing);
+		ImGui::Checkbox("Pipelined update", &scene.get_shader_state().m_pipelined_update);
+		ImGui::Checkbox("GPU instance animation", &scene.get_shader_state().m_gpu_instance_motion);
+		bool compress_textures = Application::get_instance().get_rmanager().is_compressing_textures();
+		if (ImGui::Checkbox("Compress loaded textures", &compress_textures))
+			Application::get_instance().get_rmanager().set_texture_compression(compress_textures);
+		ImGui::Text("Pending loads: %zu", Application::get_instance().get_rmanager().get_pending_loads());
+		MemoryStats mem = Application::get_instance().get_rmanager().get_memory_stats();
+		auto mib = [](std::size_t a_bytes) { return a_bytes / (1024.0 * 1024.0); };
+		ImGui::Text("GPU memory: %.1f MiB (peak %.1f MiB, budget %.1f MiB)", mib(mem.current), mib(mem.peak), mib(mem.budget));
+		ImGui::Text("Textures %.1f, meshes %.1f, instances %.1f, render buffers %.1f MiB",
+			mib(mem.per_type[static_cast<std::size_t>(ResourceType::TEXTURES)]), mib(mem.per_type[static_cast<std::size_t>(ResourceType::MESHES)]),
+			mib(mem.per_type[static_cast<std::size_t>(ResourceType::INSTANCED_ARRAYS)]), mib(mem.per_type[static_cast<std::size_t>(ResourceType::RENDER_BUFFERS)]));
+		if (Model* looked_at = scene.pick_model(cam.get_position(), cam.get_target(), cam.get_far_plane())) {
+			ImGui::Text("Looking at: %s", wstos(looked_at->get_filename()).c_str());
+		}
 		ImGui::Text("Camera front vector: (%.2f, %.2f, %.2f)", cam.get_target()[0], cam.get_target()[1], cam.get_target()[2]);
 		ImGui::Text("Camera right vector: (%.2f, %.2f, %.2f)", cam.get_right()[0], cam.get_right()[1], cam.get_right()[2]);
 		ImGui::Text("Camera up vector: (%.2f, %.2f, %.2f)", cam.get_up()[0], cam.get_up()[1], cam.get_up()[2]);
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <memory>
 #include <random>
+#include <set>
+#include <thread>
 
 #include "chill_renderer/buffers.hpp"
 #include "chill_renderer/model.hpp"
@@ -13,6 +17,13 @@
 #include "chill_renderer/application.hpp"
 #include "chill_renderer/shaders.hpp"
 #include "chill_renderer/shadows.hpp"
+#include "chill_renderer/bounds.hpp"
+#include "chill_renderer/bvh.hpp"
+#include "chill_renderer/occlusion.hpp"
+#include "chill_renderer/occlusion_queries.hpp"
+#include "chill_renderer/instance_batches.hpp"
+#include "chill_renderer/command_buffer.hpp"
+#include "chill_renderer/triple_buffer.hpp"
 
 using namespace chill_renderer;
 
@@ -76,6 +87,19 @@ enum class CurShaderType {
 	NORMAL_VIS,
 };
 
+enum class SceneObjectType {
+	GENERIC,
+	TRANSPARENT,
+	REFLECTIVE,
+	POINTLIGHT,
+};
+
+enum class RenderPass {
+	SHADOW,
+	MAIN,
+	REFLECTION,
+};
+
 struct CurShaderState {
 	CurShaderState();
 
@@ -90,11 +114,19 @@ struct CurShaderState {
 	float m_gamma = 2.2f;
 	int m_MSAA_samples = 4;
 	bool m_blinn_phong = true;
+	bool m_occlusion_culling = true;
+	bool m_occlusion_queries = true;
+	bool m_auto_instancing = true;
+	bool m_pipelined_update = false;
+	bool m_gpu_instance_motion = false;
 };
 
 class Scene {
 public:
 	Scene() = default;
+	Scene(const Scene& a_scene) = delete;
+
+	Scene& operator=(const Scene& a_scene) = delete;
 
 	void draw();
 	void draw_lights();
@@ -132,6 +164,8 @@ public:
 	void push_model_instanced(const ModelInstanced& a_mod_inst);
 	void push_uniform_buffer(const UniformBuffer& a_ubo);
 	void push_frame_buffer_post(FrameBuffer&& a_fb);
+	// Model is added to list of a_type at a_pos once loaded, see ResourceManager::load_model_async.
+	void push_pending_model(const std::shared_future<Model>& a_model, SceneObjectType a_type, const glm::vec3& a_pos);
 
 	Window* get_window();
 	Camera* get_camera();
@@ -147,14 +181,64 @@ public:
 	std::vector<LitModel<SpotLight>>& get_spotlight_sources();
 	std::vector<LitModel<DirLight>>& get_dirlight_sources();
 	std::map<std::string, ShaderProgram>& get_shaders();
+	const std::map<RenderPass, CullingStats>& get_culling_stats() const;
+	// Shared with job system timing hook, so jobs may outlive scene.
+	std::shared_ptr<JobProfiler> get_job_profiler() const;
+	Model* pick_model(const glm::vec3& a_origin, const glm::vec3& a_dir, float a_max_dist);
 
 private:
+	// Uniform locations looked up once per frame, so command buffers can be recorded off render thread
+	struct DrawLocations {
+		int multi_model = -1;
+		int multi_normal_mat = -1;
+		int single_model = -1;
+		int single_color = -1;
+		int shadow_model = -1;
+		MaterialLocations material{};
+	};
+
+	// Reflection cubemap face culled and recorded on job system
+	struct ReflectionFace {
+		std::size_t visible{};
+		std::size_t total{};
+		std::map<SceneObjectType, std::vector<std::uint8_t>> visible_flags{};
+		std::vector<std::uint32_t> inside{};
+		std::vector<std::uint32_t> intersecting{};
+		SphereBatch batch{};
+		std::vector<std::uint8_t> batch_flags{};
+		std::vector<std::pair<float, std::size_t>> transparent_order{};
+		// Generic models drawn on render thread, outline stencil state and occlusion queries aren't recorded
+		std::vector<std::size_t> direct{};
+		CommandBuffer opaque{};
+		CommandBuffer transparent{};
+	};
+
+	template<typename T>
+	void sync_spatial_index(SceneObjectType a_type, const std::vector<T>& a_models);
+	void update_spatial_index();
+	void add_loaded_models();
+	void cull_scene();
+	void occlusion_cull();
+	void draw_generic_model(std::size_t a_idx, OcclusionQueries* a_queries);
+	void draw_occlusion_queries(OcclusionQueries& a_queries, const std::vector<std::uint8_t>& a_visible);
+	bool cull_model(const Model& a_model);
+	std::size_t cull_instanced_model(ModelInstanced& a_inst_model);
+	Model& get_scene_object(std::uint32_t a_proxy_data);
 	void sort_transparent_models();
 	void set_reflective_cubemap(Model& a_refl_obj, FrameBuffer& a_fb_refl_cubemap);
+	void record_reflection_face(ReflectionFace& a_face, const Camera& a_camera, float a_width, float a_height);
+	void draw_reflection_face_models(ReflectionFace& a_face);
+	DrawLocations get_draw_locations();
+	static void step_orbit(Vec3Array& a_positions, Vec3Array& a_rotations, float& a_alfa);
+	static std::vector<InstanceMotion> orbit_motions(ModelInstanced& a_inst_model);
+	void start_update_thread();
+	void stop_update_thread();
+	void update_loop(std::stop_token a_stop);
 
 	Window* m_window = nullptr;
 	Camera* m_camera = nullptr;
 	Model m_basic_plane = Application::get_instance().get_rmanager().create_model({ Mesh(presets::g_plane_data, MaterialMap()) });
+	Model m_query_box = Application::get_instance().get_rmanager().create_model({ Mesh(presets::g_cube_data, MaterialMap()) });
 	Skybox m_skybox{};
 	CurShaderState m_shader_state{};
 	MaterialMap m_default_material{};
@@ -170,4 +254,72 @@ private:
 	std::vector<Model> m_transparent_models{};
 	std::vector<Model> m_reflective_models{};
 	std::vector<ModelInstanced> m_instanced_models{};
+
+	// Models still loading in background
+	struct PendingModel {
+		std::shared_future<Model> model{};
+		SceneObjectType type{};
+		glm::vec3 pos{};
+	};
+	std::vector<PendingModel> m_pending_models{};
+
+	// Frustum culling
+	RenderPass m_cur_pass{ RenderPass::MAIN };
+	Frustum m_frustum{};
+	SphereBatch m_cull_batch{};
+	std::vector<std::uint8_t> m_cull_flags{};
+	std::map<RenderPass, CullingStats> m_cull_stats{};
+	std::shared_ptr<JobProfiler> m_job_profiler = std::make_shared<JobProfiler>();
+	std::map<SceneObjectType, std::vector<std::uint8_t>> m_visible{};
+
+	// Occlusion culling
+	glm::mat4 m_view_proj = glm::mat4(1.0f);
+	OcclusionBuffer m_occlusion_buffer{};
+	std::vector<std::pair<float, std::uint32_t>> m_occluders{};
+
+	// Hardware occlusion queries of main pass
+	std::uint64_t m_query_set{};
+	std::map<std::uint64_t, OcclusionQueries> m_occlusion_queries{};
+	std::set<std::uint64_t> m_used_query_sets{};
+
+	// Repeated models drawn as transient instanced batches, rebuilt in every pass
+	InstanceBatches m_instance_batches{};
+	std::vector<Model*> m_batch_singles{};
+	std::vector<glm::vec3> m_batch_single_colors{};
+
+	// Parallel recorded draws
+	DrawLocations m_draw_locs{};
+	std::array<ReflectionFace, 6> m_refl_faces{};
+	std::array<CommandBuffer, 4> m_shadow_commands{};
+	std::array<InstanceBatches, 4> m_shadow_batches{};
+
+	// Spatial index
+	DynamicBVH m_bvh{};
+	std::map<SceneObjectType, std::vector<int>> m_bvh_proxies{};
+	std::vector<std::uint32_t> m_bvh_inside{};
+	std::vector<std::uint32_t> m_bvh_intersecting{};
+	std::vector<std::uint32_t> m_refl_probes{};
+	std::vector<std::size_t> m_transparent_order{};
+	std::vector<RayHit> m_ray_hits{};
+
+	// Frame pipeline, simulation owned by update thread while it runs
+	struct OrbitState {
+		std::size_t model_idx{};
+		Vec3Array positions{};
+		Vec3Array rotations{};
+		Vec3Array sizes{};
+		BoundingSphere local_sphere{};
+	};
+	struct InstancesSnapshot {
+		std::size_t model_idx{};
+		std::vector<InstanceTransform> transforms{};
+		SphereBatch spheres{};
+	};
+	struct SceneSnapshot {
+		std::vector<InstancesSnapshot> instanced{};
+	};
+	float m_orbit_alfa = 0.f;
+	std::vector<OrbitState> m_orbit_states{};
+	TripleBuffer<SceneSnapshot> m_snapshots{};
+	std::jthread m_update_thread{}; // Last, so it is joined before state it uses is destroyed.
 };
@@ -1,11 +1,29 @@
  #version 430 core
 
 layout (location = 0) in vec3 aPos;
-layout (location = 4) in mat4 aModelMat;
+layout (location = 4) in uint aInstanceIdx;
+
+struct InstanceTransform {
+	vec3 position;
+	uint rotation_xy;
+	vec3 scale;
+	uint rotation_zw;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceTransforms {
+	InstanceTransform instances[];
+};
 
 uniform mat4 light_view;
 uniform mat4 light_projection;
 
+vec3 quat_rotate(vec4 q, vec3 v) {
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main() { 
-	gl_Position = light_projection * light_view * aModelMat * vec4(aPos, 1.0);
+	InstanceTransform inst = instances[aInstanceIdx];
+	vec4 rotation = normalize(vec4(unpackSnorm2x16(inst.rotation_xy), unpackSnorm2x16(inst.rotation_zw)));
+	vec3 world_pos = inst.position + quat_rotate(rotation, inst.scale * aPos);
+	gl_Position = light_projection * light_view * vec4(world_pos, 1.0);
 }
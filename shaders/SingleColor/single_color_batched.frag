@@ -0,0 +1,9 @@
+#version 430 core
+
+out vec4 FragColor;
+
+flat in vec3 fs_Color;
+
+void main() {
+    FragColor = vec4(fs_Color, 1.0);
+}
@@ -0,0 +1,41 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+
+layout (std140, binding = 0) uniform CameraMatrices {
+	uniform mat4 view;
+	uniform mat4 projection; 
+};
+
+// Matches InstanceTransform in transform_batch.hpp.
+struct InstanceTransform {
+	vec3 position;
+	uint rotation_xy;
+	vec3 scale;
+	uint rotation_zw;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceTransforms {
+	InstanceTransform instances[];
+};
+
+layout (std430, binding = 1) readonly buffer InstanceColors {
+	vec4 colors[];
+};
+
+flat out vec3 fs_Color;
+
+uniform int instance_offset;
+
+vec3 quat_rotate(vec4 q, vec3 v) {
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() {
+	int idx = instance_offset + gl_InstanceID;
+	InstanceTransform inst = instances[idx];
+	vec4 rotation = normalize(vec4(unpackSnorm2x16(inst.rotation_xy), unpackSnorm2x16(inst.rotation_zw)));
+	vec3 world_pos = inst.position + quat_rotate(rotation, inst.scale * aPos);
+	fs_Color = colors[idx].rgb;
+	gl_Position = projection * view * vec4(world_pos, 1.0);
+}
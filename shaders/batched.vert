@@ -0,0 +1,51 @@
+ #version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+
+layout (std140, binding = 0) uniform CameraMatrices {
+	uniform mat4 view;
+	uniform mat4 projection; 
+};
+
+// Matches InstanceTransform in transform_batch.hpp, rotation is quaternion packed as snorm16.
+struct InstanceTransform {
+	vec3 position;
+	uint rotation_xy;
+	vec3 scale;
+	uint rotation_zw;
+};
+
+// Filled per pass by InstanceBatches, each batch starts at instance_offset.
+layout (std430, binding = 0) readonly buffer InstanceTransforms {
+	InstanceTransform instances[];
+};
+
+out VS_OUT {
+	vec3 gs_Normal;
+	vec2 gs_TexCoord;
+	vec3 gs_FragPos; 
+} vs_out; 
+
+uniform int instance_offset;
+
+vec3 quat_rotate(vec4 q, vec3 v) {
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() { 
+	InstanceTransform inst = instances[instance_offset + gl_InstanceID];
+	vec4 rotation = normalize(vec4(unpackSnorm2x16(inst.rotation_xy), unpackSnorm2x16(inst.rotation_zw)));
+	vec3 world_pos = inst.position + quat_rotate(rotation, inst.scale * aPos);
+
+	// Normal matrix is rotation * inverse(scale), uniform scale only changes length.
+	vec3 normal = aNormal;
+	if (inst.scale.x != inst.scale.y || inst.scale.y != inst.scale.z)
+		normal /= inst.scale;
+	vs_out.gs_Normal = normalize(quat_rotate(rotation, normal));
+	vs_out.gs_TexCoord = aTexCoord;
+	vs_out.gs_FragPos = world_pos;
+	gl_Position = view * vec4(world_pos, 1.0);
+	gl_PointSize = 0.3;
+}
@@ -0,0 +1,58 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <print>
+#include <string>
+#include <filesystem>
+
+#include "chill_renderer/application.hpp"
+#include "chill_renderer/cooked_asset.hpp"
+
+using namespace chill_renderer;
+namespace fs = std::filesystem;
+
+// Cooks model and its textures into single file loaded by ResourceManager::load_model().
+// Usage: chill_cook <model> [output.chill] [--flip-uvs]
+int main(int argc, char** argv) {
+	fs::path in_path;
+	fs::path out_path;
+	bool flip_UVs = false;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--flip-uvs")
+			flip_UVs = true;
+		else if (in_path.empty())
+			in_path = arg;
+		else if (out_path.empty())
+			out_path = arg;
+	}
+
+	if (in_path.empty()) {
+		std::println(stderr, "Usage: chill_cook <model> [output{}] [--flip-uvs]", fs::path(g_cooked_extension).string());
+		return 1;
+	}
+	if (out_path.empty()) {
+		out_path = in_path;
+		out_path.replace_extension(g_cooked_extension);
+	}
+
+	// Importer and texture encoder run on job system of application, its window is never shown.
+	glfwInit();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	Application::init(1, 1, "chill_cook");
+
+	try {
+		ModelImport import = Model::import_file(in_path.wstring(), flip_UVs, false);
+		if (import.meshes.empty()) {
+			std::println(stderr, "{} has no meshes.", in_path.string());
+			return 1;
+		}
+		cook_model(import, out_path);
+		std::println("{} -> {} ({} meshes, {} materials)", in_path.string(), out_path.string(), import.meshes.size(), import.materials.size());
+	}
+	catch (const std::exception& e) {
+		std::println(stderr, "{}", e.what());
+		return 1;
+	}
+	return 0;
+}